@@ -0,0 +1,136 @@
+// Compares lexing and parsing a generated module with loading its AST image,
+// either mapped at its preferred offset as is or, while another image holds
+// that offset, copied and relocated into a symbol table that already holds
+// other names. Last, the image is mapped once its file is touched, which has
+// the loader hash its nodes.
+//
+// Usage: ASTImageBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/ASTImage.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::size_t lexAndParse(std::string_view src) {
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    lang::Arena arena(lang::megaBytes(4));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult.tokens);
+    return parser.parseModuleAST().module->decls.size();
+}
+
+std::size_t load(const char *path, std::string_view src, bool &mapped,
+                 const char *otherName = nullptr) {
+    lang::SymbolTable symbols;
+    if (otherName != nullptr) {
+        symbols.intern(otherName);
+    }
+    lang::Arena arena(lang::kiloBytes(32));
+    lang::TypeContext typeCtx(arena);
+    auto image = lang::ASTImage::load(path, src, arena, typeCtx, symbols);
+    if (!image) {
+        std::fprintf(stderr, "error: %s\n",
+                     llvm::toString(image.takeError()).c_str());
+        std::exit(EXIT_FAILURE);
+    }
+    mapped = image->isMapped();
+    return image->getModule().decls.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    std::string image;
+    {
+        lang::SymbolTable symbols;
+        lang::Lexer lexer(symbols, src);
+        const lang::LexResult lexResult = lexer.lexAll();
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, lexResult.tokens);
+        lang::ASTWriter writer;
+        image = writer.writeModuleAST(*parser.parseModuleAST().module,
+                                      symbols);
+    }
+
+    char path[] = "/tmp/ASTImageBench-XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0 || write(fd, image.data(), image.size()) !=
+                      static_cast<ssize_t>(image.size())) {
+        std::fprintf(stderr, "error: could not write %s\n", path);
+        return EXIT_FAILURE;
+    }
+    lang::ASTWriter::stampFile(fd, image);
+
+    const std::size_t numDecls = lexAndParse(src);
+    bool mapped = false;
+    std::size_t numLoaded = load(path, src, mapped);
+    bool relocated = false;
+    std::size_t numRelocated = 0;
+    {
+        // NOTE: The first image keeps the preferred offset taken
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::SymbolTable symbols;
+        const lang::ASTImage held = llvm::cantFail(
+            lang::ASTImage::load(path, src, arena, typeCtx, symbols));
+        numRelocated = load(path, src, relocated, "other");
+        relocated = !relocated;
+    }
+    if (!mapped || !relocated || numLoaded != numDecls ||
+        numRelocated != numDecls) {
+        std::fprintf(stderr, "error: the loaded modules differ\n");
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("input: %zu functions, %.1f MiB of source, %.1f MiB of "
+                "image\n",
+                numDecls, static_cast<double>(src.size()) / (1024 * 1024),
+                static_cast<double>(image.size()) / (1024 * 1024));
+
+    const double parseMs = bench::bestOf(10, [&] { lexAndParse(src); });
+    std::printf("lex and parse:  %8.2f ms\n", parseMs);
+
+    const double mappedMs =
+        bench::bestOf(10, [&] { numLoaded = load(path, src, mapped); });
+    std::printf("load (mapped):  %8.2f ms (%.1fx)\n", mappedMs,
+                parseMs / mappedMs);
+
+    {
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::SymbolTable symbols;
+        const lang::ASTImage held = llvm::cantFail(
+            lang::ASTImage::load(path, src, arena, typeCtx, symbols));
+        const double relocatedMs = bench::bestOf(10, [&] {
+            numLoaded = load(path, src, relocated, "other");
+        });
+        std::printf("load (copied):  %8.2f ms (%.1fx)\n", relocatedMs,
+                    parseMs / relocatedMs);
+    }
+
+    // NOTE: Touching the file makes the loader hash the nodes, as it would
+    // for an image altered since it was written
+    futimens(fd, nullptr);
+    close(fd);
+    const double hashedMs =
+        bench::bestOf(10, [&] { numLoaded = load(path, src, mapped); });
+    std::printf("load (hashed):  %8.2f ms (%.1fx)\n", hashedMs,
+                parseMs / hashedMs);
+
+    unlink(path);
+
+    return EXIT_SUCCESS;
+}
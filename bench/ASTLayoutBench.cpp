@@ -0,0 +1,110 @@
+// Measures the memory taken by the AST of a generated module, and the time it
+// takes to parse it, to walk every node of it and to run the semantic passes
+// over it, which all depend on how the AST lays out its nodes.
+//
+// Usage: ASTLayoutBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/ASTVisitor.h"
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/TypeChecker.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+/// @brief Counts the nodes of a module, which only costs their traversal
+class NodeCounter : public lang::ConstASTVisitor<NodeCounter> {
+    friend class lang::ASTVisitor<NodeCounter, true>;
+
+  public:
+    std::size_t countNodes(const lang::ModuleAST &module) {
+        numNodes = 0;
+        for (const lang::DeclAST *decl : module.decls) {
+            walk(*decl);
+        }
+        return numNodes;
+    }
+
+  private:
+    std::size_t numNodes = 0;
+
+    template <typename T> bool enter(const T &) {
+        ++numNodes;
+        return true;
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    lang::Arena arena(lang::kiloBytes(32));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, tokens);
+    const lang::ParseResult result = parser.parseModuleAST();
+    if (result.hasErrors()) {
+        std::fprintf(stderr, "error: the module does not parse\n");
+        return EXIT_FAILURE;
+    }
+
+    NodeCounter counter;
+    const std::size_t numNodes = counter.countNodes(*result.module);
+    const double numTokens = static_cast<double>(tokens.size());
+    std::printf("input: %zu tokens, %zu nodes\n", tokens.size(), numNodes);
+    std::printf("nodes: ExprAST %zu bytes, StmtAST %zu bytes, "
+                "BinaryExprAST %zu bytes, LocalStmtAST %zu bytes\n",
+                sizeof(lang::ExprAST), sizeof(lang::StmtAST),
+                sizeof(lang::BinaryExprAST), sizeof(lang::LocalStmtAST));
+    const std::size_t astSize = arena.totalRequested() + arena.totalWasted();
+    std::printf("AST: %zu allocations, %.1f MiB (%.1f bytes/token)\n",
+                arena.totalAllocations(),
+                static_cast<double>(astSize) / (1024 * 1024),
+                static_cast<double>(astSize) / numTokens);
+
+    const double parseMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        const lang::ParseResult result = parser.parseModuleAST();
+    });
+
+    std::size_t walked = 0;
+    const double walkMs = bench::bestOf(10, [&] {
+        walked += counter.countNodes(*result.module);
+    });
+
+    const double semaMs = bench::bestOf(5, [&] {
+        lang::CFA cfa;
+        lang::Resolver resolver;
+        lang::TypeChecker typeChecker(typeCtx);
+        lang::ModuleAST &module = *result.module;
+        const bool ok = !cfa.analyzeModuleAST(module).hasErrors() &&
+                        !resolver.resolveModuleAST(module).hasErrors() &&
+                        !typeChecker.analyzeModuleAST(module).hasErrors();
+        walked += ok ? 0 : 1;
+    });
+
+    std::printf("parse:          %8.2f ms (%5.1f ns/token)\n", parseMs,
+                parseMs * 1e6 / numTokens);
+    std::printf("walk all nodes: %8.2f ms (%5.1f ns/node)\n", walkMs,
+                walkMs * 1e6 / static_cast<double>(numNodes));
+    std::printf("sema:           %8.2f ms (%5.1f ns/node)\n", semaMs,
+                semaMs * 1e6 / static_cast<double>(numNodes));
+
+    if (walked != numNodes * 10) {
+        std::fprintf(stderr, "error: the walks or the passes failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
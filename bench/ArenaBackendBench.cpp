@@ -0,0 +1,118 @@
+// Times parsing and the semantic passes over a large generated module, with
+// the AST allocated in blocks, in a reserved range, and in a reserved range
+// backed by transparent huge pages. The first run of every backend faults its
+// pages in, and so do later runs, as the blocks and ranges freed by the
+// previous ones are decommitted before they are reused.
+//
+// Usage: ArenaBackendBench [number of functions]
+
+#include "Bench.h"
+
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/TypeChecker.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+#include <fstream>
+#include <optional>
+
+namespace {
+
+/// @brief Returns the number of bytes of anonymous memory of the process
+/// backed by transparent huge pages
+std::size_t getAnonHugePages() {
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string key;
+    std::size_t kiloBytes = 0;
+    while (smaps >> key) {
+        if (key == "AnonHugePages:") {
+            smaps >> kiloBytes;
+            break;
+        }
+    }
+    return kiloBytes * 1024;
+}
+
+struct Stats {
+    double parseMs = 0;
+    double semaMs = 0;
+    std::size_t committed = 0;
+    std::size_t reserved = 0;
+    std::size_t hugePages = 0;
+};
+
+Stats runPipeline(std::string_view src, lang::ArenaBackend backend) {
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+
+    lang::Arena arena(lang::Arena::getInitialSize(src.size(), backend),
+                      backend);
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult.tokens);
+    std::optional<lang::ParseResult> result;
+    const double parseMs =
+        bench::bestOf(1, [&] { result = parser.parseModuleAST(); });
+
+    std::size_t numErrors = result->errors.size();
+    const double semaMs = bench::bestOf(1, [&] {
+        lang::CFA cfa;
+        lang::Resolver resolver;
+        lang::TypeChecker typeChecker(typeCtx);
+        lang::ModuleAST &module = *result->module;
+        numErrors += cfa.analyzeModuleAST(module).errors.size() +
+                     resolver.resolveModuleAST(module).errors.size() +
+                     typeChecker.analyzeModuleAST(module).errors.size();
+    });
+    if (numErrors != 0) {
+        std::fprintf(stderr, "error: the module does not compile\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    return {parseMs, semaMs, arena.totalCommitted(), arena.totalReserved(),
+            getAnonHugePages()};
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 200000));
+
+    std::printf("input: %.1f MiB\n",
+                static_cast<double>(src.size()) / (1024 * 1024));
+
+    const struct {
+        const char *name;
+        lang::ArenaBackend backend;
+    } configs[] = {
+        {"blocks", lang::ArenaBackend::Blocks},
+        {"reserved", lang::ArenaBackend::Reserved},
+        {"reserved, huge pages", lang::ArenaBackend::ReservedHugePages},
+    };
+
+    const auto mib = [](std::size_t bytes) {
+        return static_cast<double>(bytes) / (1024 * 1024);
+    };
+    for (const auto &config : configs) {
+        const Stats first = runPipeline(src, config.backend);
+        Stats best = runPipeline(src, config.backend);
+        for (int i = 0; i < 4; ++i) {
+            const Stats stats = runPipeline(src, config.backend);
+            if (stats.parseMs + stats.semaMs < best.parseMs + best.semaMs) {
+                best = stats;
+            }
+        }
+        std::printf("%s: %.1f MiB committed of %.1f MiB reserved, %.1f MiB "
+                    "in huge pages\n",
+                    config.name, mib(first.committed), mib(first.reserved),
+                    mib(first.hugePages));
+        std::printf("  first run: parse %8.2f ms, sema %8.2f ms\n",
+                    first.parseMs, first.semaMs);
+        std::printf("  best run:  parse %8.2f ms, sema %8.2f ms (%.2f ms)\n",
+                    best.parseMs, best.semaMs, best.parseMs + best.semaMs);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// Measures the bytes that the arena wastes and the time it takes to allocate
+// the AST of a generated module, with a small first block and with the first
+// block sized after the input, and to allocate a stream of small objects of
+// the sizes and alignments of AST nodes. Also measures the bytes that the
+// parser rolls back on a module in which every function has a statement that
+// fails to parse, and every fourth function fails to parse as a whole.
+//
+// Usage: ArenaBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+struct Stats {
+    std::size_t allocations = 0;
+    std::size_t allocated = 0;
+    std::size_t requested = 0;
+    std::size_t wasted = 0;
+    std::size_t rolledBack = 0;
+};
+
+Stats getStats(const lang::Arena &arena) {
+    return {arena.totalAllocations(), arena.totalCommitted(),
+            arena.totalRequested(), arena.totalWasted(),
+            arena.totalRolledBack()};
+}
+
+void printStats(const char *name, const Stats &stats, double ms) {
+    const auto mib = [](std::size_t bytes) {
+        return static_cast<double>(bytes) / (1024 * 1024);
+    };
+    std::printf("%-24s %9zu allocs, %7.1f MiB in blocks, %7.1f MiB "
+                "requested, %6.2f MiB wasted, %6.2f MiB rolled back, "
+                "%8.2f ms\n",
+                name, stats.allocations, mib(stats.allocated),
+                mib(stats.requested), mib(stats.wasted),
+                mib(stats.rolledBack), ms);
+}
+
+/// @brief Node of 12 bytes aligned to 4 bytes, like most statements
+struct SmallNode {
+    std::uint32_t words[3];
+};
+
+/// @brief Node of 28 bytes aligned to 4 bytes, like binary expressions
+struct LargeNode {
+    std::uint32_t words[7];
+};
+
+/// @brief Node of 16 bytes aligned to 8 bytes, like the nodes of lists
+struct PointerNode {
+    void *data;
+    void *next;
+};
+
+/// @brief Returns the given module with a statement that fails to parse in
+/// every function, and a missing semicolon that fails every fourth function
+/// @note The statement ends with the two semicolons that the parser skips to
+/// when it recovers, and the parser skips the function after a failed one.
+std::string injectErrors(const std::string &src) {
+    std::string result;
+    result.reserve(src.size() * 2);
+    std::size_t numFunctions = 0;
+    for (std::size_t begin = 0; begin < src.size();) {
+        const std::size_t end = src.find('\n', begin) + 1;
+        const std::string_view line(src.data() + begin, end - begin);
+        if (line == "    var y = x;\n" && numFunctions++ % 4 == 0) {
+            result += "    var y = x\n";
+        } else {
+            if (line == "        y = y + 1;\n") {
+                result += "        y = (y + 1; 0; 0;\n";
+            }
+            result += line;
+        }
+        begin = end;
+    }
+    return result;
+}
+
+Stats allocNodes(std::size_t numNodes) {
+    lang::Arena arena(lang::kiloBytes(32));
+    for (std::size_t i = 0; i < numNodes; ++i) {
+        switch (i % 3) {
+        case 0:
+            arena.alloc<SmallNode>();
+            break;
+        case 1:
+            arena.alloc<LargeNode>();
+            break;
+        default:
+            arena.alloc<PointerNode>();
+            break;
+        }
+    }
+    return getStats(arena);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+
+    std::printf("input: %.1f MiB, %zu tokens\n",
+                static_cast<double>(src.size()) / (1024 * 1024),
+                lexResult.tokens.size());
+
+    const struct {
+        const char *name;
+        std::size_t size;
+    } configs[] = {
+        {"parse, 32 KiB first", lang::kiloBytes(32)},
+        {"parse, sized to input", lang::Arena::getInitialSize(src.size())},
+    };
+
+    for (const auto &config : configs) {
+        Stats stats;
+        const double ms = bench::bestOf(5, [&] {
+            lang::Arena arena(config.size);
+            lang::TypeContext typeCtx(arena);
+            lang::Parser parser(arena, typeCtx, lexResult.tokens);
+            if (parser.parseModuleAST().hasErrors()) {
+                std::fprintf(stderr, "error: the module does not parse\n");
+                std::exit(EXIT_FAILURE);
+            }
+            stats = getStats(arena);
+        });
+        printStats(config.name, stats, ms);
+    }
+
+    const std::string badSrc = injectErrors(src);
+    lang::Lexer badLexer(symbols, badSrc);
+    const lang::LexResult badLexResult = badLexer.lexAll();
+    Stats badStats;
+    const double badMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::Arena::getInitialSize(badSrc.size()));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, badLexResult.tokens);
+        if (!parser.parseModuleAST().hasErrors()) {
+            std::fprintf(stderr, "error: the module parses without errors\n");
+            std::exit(EXIT_FAILURE);
+        }
+        badStats = getStats(arena);
+    });
+    printStats("parse, with errors", badStats, badMs);
+
+    const std::size_t numNodes = 10'000'000;
+    Stats stats;
+    const double ms =
+        bench::bestOf(5, [&] { stats = allocNodes(numNodes); });
+    printStats("10M small nodes", stats, ms);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+// Times 32 threads building linked lists in the arenas of an ArenaGroup,
+// rolling back some allocations on the way, against one thread building the
+// same lists in a single arena, and the time taken by the group to merge the
+// arenas into a parent. ArenaGroupTest checks the lists and the statistics.
+//
+// Usage: ArenaGroupBench [number of list nodes per thread]
+
+#include "Bench.h"
+
+#include "Alloc/ArenaGroup.h"
+#include "Alloc/ArenaRef.h"
+
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t numThreads = 32;
+
+/// @brief Node of a list, followed by an array of up to 15 words
+struct ListNode {
+    std::uint64_t value;
+    lang::ArenaRef<ListNode> next;
+    lang::ArenaRef<std::uint32_t> words;
+    std::uint32_t numWords;
+};
+
+std::uint64_t nextRandom(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/// @brief Builds a list of the given number of nodes from the given seed,
+/// and allocates and rolls back a few nodes every 64 nodes
+ListNode *buildList(lang::Arena &arena, std::uint64_t seed,
+                    std::size_t count) {
+    std::uint64_t state = seed * 0x9e3779b97f4a7c15 + 1;
+    ListNode *head = nullptr;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i % 64 == 63) {
+            const lang::Arena::Mark mark = arena.mark();
+            for (std::uint64_t j = nextRandom(state) % 8; j != 0; --j) {
+                arena.alloc<ListNode>(ListNode{j, head, nullptr, 0});
+            }
+            arena.rollback(mark);
+        }
+        const std::uint64_t value = nextRandom(state);
+        const auto numWords = static_cast<std::uint32_t>(value % 16);
+        std::uint32_t *words = arena.allocArray<std::uint32_t>(numWords);
+        for (std::uint32_t j = 0; j < numWords; ++j) {
+            words[j] = static_cast<std::uint32_t>(value >> j);
+        }
+        head = arena.alloc<ListNode>(ListNode{value, head, words, numWords});
+    }
+    return head;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count = bench::parseSizeArg(argc, argv, 100000);
+
+    std::printf("input: %zu threads, %zu list nodes per thread\n",
+                numThreads, count);
+
+    lang::Arena parent(lang::kiloBytes(32));
+    parent.enableTypeStats();
+    std::vector<ListNode *> heads(numThreads, nullptr);
+    {
+        lang::ArenaGroup group(parent, numThreads);
+        const double parallelMs = bench::bestOf(1, [&] {
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (std::size_t i = 0; i < numThreads; ++i) {
+                threads.emplace_back([&, i] {
+                    heads[i] = buildList(group.getWorker(i), i, count);
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        });
+        const double mergeMs = bench::bestOf(1, [&] { group.merge(); });
+        std::printf("%zu threads: %8.2f ms, merge: %6.3f ms\n", numThreads,
+                    parallelMs, mergeMs);
+    }
+
+    lang::Arena single(lang::kiloBytes(32));
+    single.enableTypeStats();
+    const double singleMs = bench::bestOf(1, [&] {
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            buildList(single, i, count);
+        }
+    });
+    std::printf("1 thread:   %8.2f ms\n", singleMs);
+    std::printf("merged: %zu allocations, %zu bytes requested, %zu bytes "
+                "rolled back\n",
+                parent.totalAllocations(), parent.totalRequested(),
+                parent.totalRolledBack());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#ifndef LANG_BENCH_H
+#define LANG_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace bench {
+
+/// @brief Generates a valid module with the given number of functions
+/// @note Every function mixes comments, locals, arithmetic, control flow and
+/// calls to the previous function, so the module goes through lexing, parsing
+/// and semantic analysis without errors.
+inline std::string generateModule(std::size_t numFunctions) {
+    std::string src;
+    src.reserve(numFunctions * 320);
+    for (std::size_t i = 0; i < numFunctions; ++i) {
+        const std::string n = std::to_string(i);
+        const std::string k = std::to_string(i % 1000);
+        src += "// f" + n + " mixes arithmetic, control flow and calls\n";
+        src += "fn f" + n + "(a: number, b: number): number {\n";
+        src += "    let x = a * " + k + ".5 + (b - " + k + ") / 3;\n";
+        src += "    var y = x;\n";
+        src += "    while y < " + k + "00 {\n";
+        src += "        y = y + 1;\n";
+        src += "        if y > " + k + "0 {\n";
+        src += "            break;\n";
+        src += "        }\n";
+        src += "    }\n";
+        src += "    if x >= y && a != b {\n";
+        if (i != 0) {
+            src += "        f" + std::to_string(i - 1) + "(x, y);\n";
+        } else {
+            src += "        y = x;\n";
+        }
+        src += "    } else {\n";
+        src += "        y = -y;\n";
+        src += "    }\n";
+        src += "    return y * 2 + x;\n";
+        src += "}\n\n";
+    }
+    return src;
+}
+
+/// @brief Parses the first command line argument as a size, if any
+inline std::size_t parseSizeArg(int argc, char **argv, std::size_t fallback) {
+    if (argc < 2) {
+        return fallback;
+    }
+    return std::strtoull(argv[1], nullptr, 10);
+}
+
+/// @brief Runs f the given number of times and returns the fastest run in
+/// milliseconds
+template <typename F> double bestOf(int runs, F &&f) {
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(
+            best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+} // namespace bench
+
+#endif // LANG_BENCH_H
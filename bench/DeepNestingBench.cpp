@@ -0,0 +1,118 @@
+// Measures parsing and the semantic passes on functions nested 100k levels
+// deep in every way the grammar allows, which overflowed the native stack when
+// the parser and the visitors recursed, next to the flat module of
+// generateModule for comparison.
+//
+// Usage: DeepNestingBench [nesting depth]
+
+#include "Bench.h"
+
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/TypeChecker.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+std::string repeat(const char *s, std::size_t n) {
+    std::string out;
+    for (std::size_t i = 0; i < n; ++i) {
+        out += s;
+    }
+    return out;
+}
+
+/// @brief Wraps the given statement into a function
+std::string function(const std::string &stmt) {
+    return "fn main(a: number): number {\n    var x = a;\n    " + stmt +
+           "\n    return x;\n}\n";
+}
+
+/// @brief Parses the given module and runs the semantic passes over it,
+/// reporting the time of both, or returns false if any of them fails
+bool run(const char *name, const std::string &src) {
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    bool ok = true;
+    double parseMs = 1e300;
+    double semaMs = 1e300;
+    for (int i = 0; i < 5 && ok; ++i) {
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        lang::ModuleAST *module = nullptr;
+        const double iterParseMs = bench::bestOf(1, [&] {
+            const lang::ParseResult result = parser.parseModuleAST();
+            ok = !result.hasErrors();
+            module = result.module;
+        });
+        parseMs = std::min(parseMs, iterParseMs);
+        if (!ok) {
+            break;
+        }
+
+        const double iterSemaMs = bench::bestOf(1, [&] {
+            lang::CFA cfa;
+            lang::Resolver resolver;
+            lang::TypeChecker typeChecker(typeCtx);
+            ok = !cfa.analyzeModuleAST(*module).hasErrors() &&
+                 !resolver.resolveModuleAST(*module).hasErrors() &&
+                 !typeChecker.analyzeModuleAST(*module).hasErrors();
+        });
+        semaMs = std::min(semaMs, iterSemaMs);
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "error: %s did not go through sema\n", name);
+        return false;
+    }
+
+    const double numTokens = static_cast<double>(tokens.size());
+    std::printf("%-12s %8zu tokens: parse %8.2f ms (%5.1f ns/token), "
+                "sema %8.2f ms (%5.1f ns/token)\n",
+                name, tokens.size(), parseMs, parseMs * 1e6 / numTokens,
+                semaMs, semaMs * 1e6 / numTokens);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t depth = bench::parseSizeArg(argc, argv, 100000);
+
+    std::printf("depth: %zu\n", depth);
+
+    const struct {
+        const char *name;
+        std::string src;
+    } inputs[] = {
+        {"parentheses", function("x = " + repeat("(", depth) + "a" +
+                                 repeat(")", depth) + ";")},
+        {"unary minus", function("x = " + repeat("-", depth) + "a;")},
+        {"binary rhs", function("x = a" + repeat(" + (a", depth) +
+                                repeat(")", depth) + ";")},
+        {"calls",
+         function(repeat("main(", depth) + "a" + repeat(")", depth) + ";")},
+        {"blocks",
+         function(repeat("{ ", depth) + "x = a;" + repeat(" }", depth))},
+        {"ifs", function(repeat("if x < a { ", depth) + "x = a;" +
+                         repeat(" }", depth))},
+        {"whiles", function(repeat("while x < a { ", depth) + "break;" +
+                            repeat(" }", depth))},
+        {"else ifs", function("if x < a { x = a; }" +
+                              repeat(" else if x < a { x = a; }", depth))},
+        {"flat", bench::generateModule(depth / 10)},
+    };
+
+    for (const auto &input : inputs) {
+        if (!run(input.name, input.src)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+// Measures the parsing throughput of long chains of binary operators, which
+// stress the operator precedence lookup, and of the same chains behind a
+// syntax error, which stress the skipping of tokens up to a sync set.
+//
+// Usage: ExprParserBench [number of statements]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+/// @brief Generates a function whose statements each assign a chain of 64
+/// operands joined by every binary operator, optionally preceded by a
+/// misplaced token the parser has to recover from
+std::string generateChains(std::size_t numStatements, bool withErrors) {
+    static const char *const ops[] = {" + ", " * ",  " - ",  " / ",
+                                      " < ", " <= ", " > ",  " >= ",
+                                      " && ", " == ", " != ", " || "};
+    std::string src = "fn chains(a: number, b: number): number {\n";
+    for (std::size_t i = 0; i < numStatements; ++i) {
+        src += withErrors ? "    a = ) a" : "    a = a";
+        for (std::size_t j = 1; j < 64; ++j) {
+            src += ops[(i + j) % 12];
+            src += j % 2 == 0 ? "a" : "(b - 1)";
+        }
+        src += ";\n";
+    }
+    src += "    return a;\n}\n";
+    return src;
+}
+
+void run(const char *name, const std::string &src) {
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    std::size_t numErrors = 0;
+    const double parseMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        numErrors = parser.parseModuleAST().errors.size();
+    });
+
+    const double numTokens = static_cast<double>(tokens.size());
+    std::printf("%-8s %zu tokens, %zu errors: %8.2f ms (%6.1f Mtok/s)\n",
+                name, tokens.size(), numErrors, parseMs,
+                numTokens / parseMs / 1000);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t numStatements = bench::parseSizeArg(argc, argv, 20000);
+
+    run("valid", generateChains(numStatements, false));
+    run("errors", generateChains(numStatements, true));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Compares type checking a generated module by walking its AST with type
+// checking its function bodies lowered to flat arrays of nodes in post-order,
+// and measures what the lowering itself costs.
+//
+// Usage: FlatASTBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/FlatAST.h"
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/TypeChecker.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+/// @brief Returns the type the tree holds for the given flat node
+lang::Type *treeType(const lang::FlatAST &flat, std::uint32_t index) {
+    switch (flat.kinds[index]) {
+    case lang::FlatKind::Param:
+    case lang::FlatKind::Local:
+        return flat.getNode<lang::LocalStmtAST>(index).type;
+    default:
+        return lang::isFlatExpr(flat.kinds[index])
+                   ? flat.getNode<lang::ExprAST>(index).type.get()
+                   : nullptr;
+    }
+}
+
+bool sameErrors(const lang::TypeCheckerResult &lhs,
+                const lang::TypeCheckerResult &rhs) {
+    if (lhs.errors.size() != rhs.errors.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.errors.size(); ++i) {
+        if (lhs.errors[i].kind != rhs.errors[i].kind ||
+            lhs.errors[i].span.data() != rhs.errors[i].span.data()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+
+    lang::Arena arena(lang::megaBytes(4));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult.tokens);
+    const lang::ParseResult result = parser.parseModuleAST();
+    lang::ModuleAST &module = *result.module;
+
+    lang::CFA cfa;
+    lang::Resolver resolver;
+    if (result.hasErrors() || cfa.analyzeModuleAST(module).hasErrors() ||
+        resolver.resolveModuleAST(module).hasErrors()) {
+        std::fprintf(stderr, "error: the module does not resolve\n");
+        return EXIT_FAILURE;
+    }
+
+    lang::ASTFlattener flattener;
+    lang::FlatAST flat = flattener.flattenModuleAST(module);
+    const double numNodes = flat.size();
+
+    lang::TypeChecker treeChecker(typeCtx);
+    const lang::TypeCheckerResult expected =
+        treeChecker.analyzeModuleAST(module);
+    std::vector<lang::Type *> treeTypes;
+    for (std::uint32_t i = 0; i < flat.size(); ++i) {
+        treeTypes.push_back(treeType(flat, i));
+    }
+
+    lang::TypeChecker flatChecker(typeCtx);
+    const lang::TypeCheckerResult actual = flatChecker.analyzeFlatAST(flat);
+    if (!sameErrors(expected, actual) || flat.types != treeTypes) {
+        std::fprintf(stderr, "error: the type checkers disagree\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("input: %zu functions, %.0f flat nodes (%zu bytes/node)\n",
+                flat.functions.size(), numNodes,
+                sizeof(lang::FlatKind) + sizeof(lang::FlatAST::Operands) +
+                    sizeof(lang::Type *) + sizeof(void *));
+
+    const double treeMs = bench::bestOf(10, [&] {
+        lang::TypeChecker typeChecker(typeCtx);
+        (void)typeChecker.analyzeModuleAST(module);
+    });
+
+    const double lowerMs = bench::bestOf(10, [&] {
+        lang::ASTFlattener flattener;
+        flat = flattener.flattenModuleAST(module);
+    });
+
+    const double flatMs = bench::bestOf(10, [&] {
+        lang::TypeChecker typeChecker(typeCtx);
+        (void)typeChecker.analyzeFlatAST(flat);
+    });
+
+    std::printf("tree type check: %8.2f ms (%5.1f ns/node)\n", treeMs,
+                treeMs * 1e6 / numNodes);
+    std::printf("lowering:        %8.2f ms (%5.1f ns/node)\n", lowerMs,
+                lowerMs * 1e6 / numNodes);
+    std::printf("flat type check: %8.2f ms (%5.1f ns/node, %.2fx)\n", flatMs,
+                flatMs * 1e6 / numNodes, treeMs / flatMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+// Compares running the control flow analysis, the resolution and the type
+// checking of a generated module one after another, which walks the AST three
+// times, with running them fused in a single walk.
+//
+// Usage: FusedSemaBench [number of functions]
+
+#include "Bench.h"
+
+#include "Analysis/Sema.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+std::size_t countErrors(const lang::SemaResult &result) {
+    return result.cfa.errors.size() + result.resolve.errors.size() +
+           result.typeChecker.errors.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+
+    lang::Arena arena(lang::megaBytes(4));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult.tokens);
+    const lang::ParseResult result = parser.parseModuleAST();
+    if (result.hasErrors()) {
+        std::fprintf(stderr, "error: the module does not parse\n");
+        return EXIT_FAILURE;
+    }
+    lang::ModuleAST &module = *result.module;
+
+    std::size_t numErrors = 0;
+    const double separateMs = bench::bestOf(10, [&] {
+        lang::CFA cfa;
+        lang::Resolver resolver;
+        lang::TypeChecker typeChecker(typeCtx);
+        numErrors += cfa.analyzeModuleAST(module).errors.size() +
+                     resolver.resolveModuleAST(module).errors.size() +
+                     typeChecker.analyzeModuleAST(module).errors.size();
+    });
+
+    const double fusedMs = bench::bestOf(10, [&] {
+        lang::Sema sema(typeCtx);
+        numErrors += countErrors(sema.analyzeModuleAST(module));
+    });
+
+    if (numErrors != 0) {
+        std::fprintf(stderr, "error: the module does not type check\n");
+        return EXIT_FAILURE;
+    }
+
+    const double numTokens = static_cast<double>(lexResult.tokens.size());
+    std::printf("input: %zu functions, %zu tokens\n", module.decls.size(),
+                lexResult.tokens.size());
+    std::printf("separate passes: %8.2f ms (%5.1f ns/token)\n", separateMs,
+                separateMs * 1e6 / numTokens);
+    std::printf("fused pass:      %8.2f ms (%5.1f ns/token, %.2fx)\n", fusedMs,
+                fusedMs * 1e6 / numTokens, separateMs / fusedMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// Counts the allocations from the global heap of every phase of the compiler
+// over a generated module, and the time that the phase takes. Code generation
+// runs over a module of its own, made of the statements that it supports.
+//
+// Usage: HeapAllocBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/FlatAST.h"
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/Sema.h"
+#include "Analysis/TypeChecker.h"
+#include "Codegen/Codegen.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+#include <new>
+
+namespace {
+
+std::size_t numHeapAllocs = 0;
+std::size_t numHeapBytes = 0;
+
+/// @brief Generates a module of functions made of loops, ifs and breaks,
+/// which code generation supports
+std::string generateCodegenModule(std::size_t numFunctions) {
+    std::string src;
+    src.reserve(numFunctions * 160);
+    for (std::size_t i = 0; i < numFunctions; ++i) {
+        const std::string k = std::to_string(i % 1000);
+        src += "fn g" + std::to_string(i) + "(): void {\n";
+        src += "    while 1 < " + k + " {\n";
+        src += "        if " + k + " > 2 {\n";
+        src += "            break;\n";
+        src += "        } else {\n";
+        src += "            break;\n";
+        src += "        }\n";
+        src += "    }\n";
+        src += "}\n\n";
+    }
+    return src;
+}
+
+/// @brief Runs a phase once, and reports its heap allocations and time
+template <typename F> void measure(const char *name, F &&phase) {
+    const std::size_t allocs = numHeapAllocs;
+    const std::size_t bytes = numHeapBytes;
+    const double ms = bench::bestOf(1, phase);
+    std::printf("%-20s %9zu heap allocs, %8.1f KiB, %8.2f ms\n", name,
+                numHeapAllocs - allocs,
+                static_cast<double>(numHeapBytes - bytes) / 1024, ms);
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    ++numHeapAllocs;
+    numHeapBytes += size;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+int main(int argc, char **argv) {
+    const std::size_t numFunctions = bench::parseSizeArg(argc, argv, 50000);
+    const std::string src = bench::generateModule(numFunctions);
+
+    std::printf("input: %zu functions\n", numFunctions);
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    std::optional<lang::LexResult> lexResult;
+    measure("lex", [&] { lexResult = lexer.lexAll(); });
+
+    lang::Arena arena(lang::Arena::getInitialSize(src.size()));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult->tokens);
+    std::optional<lang::ParseResult> result;
+    measure("parse", [&] { result = parser.parseModuleAST(); });
+    lang::ModuleAST &module = *result->module;
+
+    std::size_t numErrors = result->errors.size();
+    measure("cfa", [&] {
+        lang::CFA cfa;
+        numErrors += cfa.analyzeModuleAST(module).errors.size();
+    });
+    measure("resolve", [&] {
+        lang::Resolver resolver;
+        numErrors += resolver.resolveModuleAST(module).errors.size();
+    });
+    measure("type check", [&] {
+        lang::TypeChecker typeChecker(typeCtx);
+        numErrors += typeChecker.analyzeModuleAST(module).errors.size();
+    });
+    measure("type check (flat)", [&] {
+        lang::ASTFlattener flattener;
+        lang::FlatAST flat = flattener.flattenModuleAST(module);
+        lang::TypeChecker typeChecker(typeCtx);
+        numErrors += typeChecker.analyzeFlatAST(flat).errors.size();
+    });
+    measure("fused sema", [&] {
+        lang::Sema sema(typeCtx);
+        const lang::SemaResult semaResult = sema.analyzeModuleAST(module);
+        numErrors += semaResult.cfa.errors.size() +
+                     semaResult.resolve.errors.size() +
+                     semaResult.typeChecker.errors.size();
+    });
+
+    const std::string codegenSrc = generateCodegenModule(numFunctions);
+    lang::Lexer codegenLexer(symbols, codegenSrc);
+    const lang::LexResult codegenLexResult = codegenLexer.lexAll();
+    lang::Parser codegenParser(arena, typeCtx, codegenLexResult.tokens);
+    const lang::ParseResult codegenResult = codegenParser.parseModuleAST();
+    lang::Sema sema(typeCtx);
+    const lang::SemaResult semaResult =
+        sema.analyzeModuleAST(*codegenResult.module);
+    numErrors += codegenResult.errors.size() + semaResult.cfa.errors.size() +
+                 semaResult.resolve.errors.size() +
+                 semaResult.typeChecker.errors.size();
+    if (numErrors != 0) {
+        std::fprintf(stderr, "error: the modules do not compile\n");
+        return EXIT_FAILURE;
+    }
+
+    measure("codegen", [&] {
+        lang::Codegen codegen;
+        codegen.generateModule(*codegenResult.module);
+    });
+
+    return EXIT_SUCCESS;
+}
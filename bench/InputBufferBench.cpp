@@ -0,0 +1,104 @@
+// Compares loading and lexing a file through an llvm::MemoryBuffer with the
+// bounded lexer against loading it through an InputBuffer, either memory
+// mapped or read into the heap, with the padded lexer. Every configuration is
+// timed with a warm page cache and with the file evicted from it before each
+// run, when the kernel honours the eviction.
+//
+// Usage: InputBufferBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+#include "Support/InputBuffer.h"
+
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+void evict(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+std::size_t lexMemoryBuffer(const char *path) {
+    const auto file = llvm::MemoryBuffer::getFile(path);
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, file.get()->getBuffer());
+    return lexer.lexAll().tokens.size();
+}
+
+std::size_t lexMapped(const char *path) {
+    const auto file = lang::InputBuffer::open(path);
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, file->getBuffer(), lang::getHostScanISA(),
+                      true);
+    return lexer.lexAll().tokens.size();
+}
+
+std::size_t lexRead(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    const auto file = lang::InputBuffer::read(fd);
+    close(fd);
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, file->getBuffer(), lang::getHostScanISA(),
+                      true);
+    return lexer.lexAll().tokens.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    char path[] = "/tmp/InputBufferBench-XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0 || write(fd, src.data(), src.size()) !=
+                      static_cast<ssize_t>(src.size())) {
+        std::fprintf(stderr, "error: could not write %s\n", path);
+        return EXIT_FAILURE;
+    }
+    // NOTE: Dirty pages cannot be evicted, so they are flushed first
+    fsync(fd);
+    close(fd);
+
+    const std::size_t numTokens = lexMemoryBuffer(path);
+    if (lexMapped(path) != numTokens || lexRead(path) != numTokens) {
+        std::fprintf(stderr, "error: token counts differ\n");
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("input: %.1f MiB, %zu tokens\n",
+                static_cast<double>(src.size()) / (1024 * 1024), numTokens);
+
+    const struct {
+        const char *name;
+        std::size_t (*run)(const char *);
+    } configs[] = {
+        {"llvm::MemoryBuffer (bounded)", lexMemoryBuffer},
+        {"InputBuffer mmap (padded)", lexMapped},
+        {"InputBuffer read (padded)", lexRead},
+    };
+
+    for (const auto &config : configs) {
+        const double warmMs = bench::bestOf(5, [&] { config.run(path); });
+        double coldMs = 0;
+        for (int i = 0; i < 5; ++i) {
+            evict(path);
+            coldMs += bench::bestOf(1, [&] { config.run(path); }) / 5;
+        }
+        std::printf("%-30s warm %8.2f ms, cold %8.2f ms\n", config.name,
+                    warmMs, coldMs);
+    }
+
+    unlink(path);
+
+    return EXIT_SUCCESS;
+}
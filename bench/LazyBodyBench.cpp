@@ -0,0 +1,83 @@
+// Compares parsing every function body upfront with deferring the bodies,
+// both when only the signatures are needed and when every body is parsed on
+// first access afterwards.
+//
+// Usage: LazyBodyBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+namespace {
+
+std::size_t countStmts(const lang::ModuleAST &module) {
+    std::size_t numStmts = 0;
+    for (const lang::DeclAST *decl : module.decls) {
+        const auto *function = static_cast<const lang::FunctionDeclAST *>(decl);
+        for ([[maybe_unused]] const lang::StmtAST *stmt :
+             function->getBody(module.bodyParser)->stmts) {
+            ++numStmts;
+        }
+    }
+    return numStmts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    std::printf("input: %.1f MiB, %zu tokens\n",
+                static_cast<double>(src.size()) / (1024 * 1024),
+                tokens.size());
+
+    // NOTE: Every configuration uses arena blocks large enough to be mapped
+    // afresh, so they all pay the same cost for touching new pages,
+    // whatever state the previous runs left the heap in
+    const auto parseEager = [&] {
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        return countStmts(*parser.parseModuleAST().module);
+    };
+
+    const std::size_t eagerStmts = parseEager();
+    const double eagerMs = bench::bestOf(5, parseEager);
+
+    const double signaturesMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        parser.setDeferBodies(true);
+        const lang::ParseResult result = parser.parseModuleAST();
+    });
+
+    std::size_t lazyStmts = 0;
+    const double lazyMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::megaBytes(4));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        parser.setDeferBodies(true);
+        lazyStmts = countStmts(*parser.parseModuleAST().module);
+    });
+
+    if (lazyStmts != eagerStmts) {
+        std::fprintf(stderr, "error: deferred bodies differ\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("eager bodies:                   %8.2f ms\n", eagerMs);
+    std::printf("deferred bodies, signatures:    %8.2f ms (%.2fx)\n",
+                signaturesMs, eagerMs / signaturesMs);
+    std::printf("deferred bodies, all accessed:  %8.2f ms (%.2fx)\n", lazyMs,
+                eagerMs / lazyMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+// Compares decoding the number literals of a literal heavy module with
+// std::stof on a copied std::string, as codegen used to, with decodeNumber,
+// and checks that decodeNumber agrees with std::strtod on every literal, and
+// on literals too large, too small or subnormal for a double.
+//
+// Usage: NumberLiteralBench [number of literals]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+
+#include <random>
+
+int main(int argc, char **argv) {
+    const std::size_t numLiterals = bench::parseSizeArg(argc, argv, 2000000);
+
+    std::mt19937 rng(42);
+    std::string src;
+    src.reserve(numLiterals * 16);
+    for (std::size_t i = 0; i < numLiterals; ++i) {
+        const std::uint32_t integer = rng() >> (rng() % 32);
+        src += std::to_string(integer);
+        if (i % 4 != 0) {
+            src += '.';
+            src += std::to_string(rng() % 1000000);
+        }
+        src += i % 8 == 7 ? ";\n" : " + ";
+    }
+
+    lang::SymbolTable symbols;
+    const lang::LexResult result = lang::Lexer(symbols, src).lexAll();
+    std::vector<std::string_view> literals;
+    for (std::size_t i = 0; i < result.tokens.size(); ++i) {
+        if (result.tokens.getKind(i) == lang::TokenKind::Number) {
+            literals.push_back(result.tokens.getSpan(i));
+        }
+    }
+
+    // NOTE: Literals that overflow, underflow or are subnormal, which
+    // std::stof throws on, so they are checked but not timed
+    const std::string zeros(400, '0');
+    const std::string extremes[] = {
+        "1" + zeros,
+        "1" + zeros + ".5",
+        "0." + zeros + "1",
+        zeros + "." + zeros + "1",
+        "0." + zeros.substr(78) + "1",
+    };
+    std::vector<std::string_view> checked = literals;
+    checked.insert(checked.end(), std::begin(extremes), std::end(extremes));
+
+    for (const std::string_view literal : checked) {
+        const std::string copy(literal);
+        if (lang::decodeNumber(literal) != std::strtod(copy.c_str(), nullptr)) {
+            std::fprintf(stderr, "error: %s decoded incorrectly\n",
+                         copy.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::printf("input: %zu literals\n", literals.size());
+
+    double sum = 0;
+    const double stofMs = bench::bestOf(5, [&] {
+        for (const std::string_view literal : literals) {
+            sum += std::stof(std::string(literal));
+        }
+    });
+    const double decodeMs = bench::bestOf(5, [&] {
+        for (const std::string_view literal : literals) {
+            sum += lang::decodeNumber(literal);
+        }
+    });
+
+    const double n = static_cast<double>(literals.size());
+    std::printf("std::stof(std::string):  %8.2f ms (%6.1f ns/literal)\n",
+                stofMs, stofMs * 1e6 / n);
+    std::printf("decodeNumber:            %8.2f ms (%6.1f ns/literal)\n",
+                decodeMs, decodeMs * 1e6 / n);
+    std::printf("checksum: %g\n", sum);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+// Measures how chunked parallel lexing scales from 1 to 16 threads, and checks
+// that every thread count produces the same tokens as the serial lexer.
+//
+// Usage: ParallelLexBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+
+#include <thread>
+
+namespace {
+
+bool sameTokens(const lang::TokenBuffer &lhs, const lang::TokenBuffer &rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs.getKind(i) != rhs.getKind(i) ||
+            lhs.getSymbol(i) != rhs.getSymbol(i) ||
+            lhs.getOffset(i) != rhs.getOffset(i) ||
+            lhs.getLength(i) != rhs.getLength(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 150000));
+
+    lang::SymbolTable serialSymbols;
+    lang::Lexer serialLexer(serialSymbols, src);
+    const lang::LexResult expected = serialLexer.lexAll();
+
+    std::printf("input: %.1f MiB, %zu tokens, %u hardware thread(s)\n",
+                static_cast<double>(src.size()) / (1024 * 1024),
+                expected.tokens.size(), std::thread::hardware_concurrency());
+
+    const double serialMs = bench::bestOf(5, [&] {
+        lang::SymbolTable symbols;
+        lang::Lexer lexer(symbols, src);
+        const lang::LexResult result = lexer.lexAll();
+    });
+    std::printf("serial lexAll:  %8.2f ms\n", serialMs);
+
+    for (const unsigned threads : {1U, 2U, 4U, 8U, 16U}) {
+        lang::SymbolTable checkSymbols;
+        lang::Lexer checkLexer(checkSymbols, src);
+        if (!sameTokens(checkLexer.lexAllParallel(threads).tokens,
+                        expected.tokens)) {
+            std::printf("%2u thread(s): token mismatch\n", threads);
+            return EXIT_FAILURE;
+        }
+
+        const double ms = bench::bestOf(5, [&] {
+            lang::SymbolTable symbols;
+            lang::Lexer lexer(symbols, src);
+            const lang::LexResult result = lexer.lexAllParallel(threads);
+        });
+        std::printf("%2u thread(s):   %8.2f ms (%.2fx)\n", threads, ms,
+                    serialMs / ms);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// Measures how parsing the top-level functions in parallel scales from 1 to 16
+// threads, and checks that every thread count produces the same AST as the
+// serial parser.
+//
+// Usage: ParallelParseBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/ASTPrinter.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+#include <thread>
+
+namespace {
+
+std::string printModule(const lang::TokenBuffer &tokens, unsigned threads) {
+    lang::Arena arena(lang::kiloBytes(32));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, tokens);
+    const lang::ParseResult result = parser.parseModuleASTParallel(threads);
+
+    std::string out;
+    llvm::raw_string_ostream os(out);
+    lang::ASTPrinter(os).visit(*result.module);
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    std::printf("input: %.1f MiB, %zu tokens, %u hardware thread(s)\n",
+                static_cast<double>(src.size()) / (1024 * 1024), tokens.size(),
+                std::thread::hardware_concurrency());
+
+    const std::string expected = printModule(tokens, 1);
+
+    const double serialMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        const lang::ParseResult result = parser.parseModuleAST();
+    });
+    std::printf("serial parseModuleAST: %8.2f ms\n", serialMs);
+
+    for (const unsigned threads : {1U, 2U, 4U, 8U, 16U}) {
+        if (printModule(tokens, threads) != expected) {
+            std::printf("%2u thread(s): AST mismatch\n", threads);
+            return EXIT_FAILURE;
+        }
+
+        const double ms = bench::bestOf(5, [&] {
+            lang::Arena arena(lang::kiloBytes(32));
+            lang::TypeContext typeCtx(arena);
+            lang::Parser parser(arena, typeCtx, tokens);
+            const lang::ParseResult result =
+                parser.parseModuleASTParallel(threads);
+        });
+        std::printf("%2u thread(s):          %8.2f ms (%.2fx)\n", threads, ms,
+                    serialMs / ms);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+// Compares the time taken to relex a large module after a one character edit
+// with the time taken to lex it again. RelexTest checks the relexed tokens.
+//
+// Usage: RelexBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+
+#include <random>
+
+int main(int argc, char **argv) {
+    std::mt19937 rng(42);
+
+    std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+    lang::SymbolTable symbols;
+    lang::LexResult result = lang::Lexer(symbols, src).lexAll();
+
+    std::printf("input: %.1f MiB, %zu tokens\n",
+                static_cast<double>(src.size()) / (1024 * 1024),
+                result.tokens.size());
+
+    const double lexMs = bench::bestOf(5, [&] {
+        lang::SymbolTable fullSymbols;
+        const lang::LexResult full = lang::Lexer(fullSymbols, src).lexAll();
+    });
+
+    // NOTE: Each edit builds on the previous one, so the previous result can
+    // be moved into relex instead of being copied
+    constexpr int numEdits = 100;
+    double relexMs = 0;
+    for (int i = 0; i < numEdits; ++i) {
+        const std::size_t offset =
+            std::uniform_int_distribution<std::size_t>(0, src.size())(rng);
+        const std::vector<lang::TextEdit> edits = {{offset, 0, "x"}};
+        std::string edited = lang::applyTextEdits(src, edits);
+        relexMs += bench::bestOf(1, [&] {
+            result =
+                lang::Lexer(symbols, edited).relex(std::move(result), edits);
+        });
+        src = std::move(edited);
+    }
+    relexMs /= numEdits;
+
+    std::printf("full lex:                  %8.2f ms\n", lexMs);
+    std::printf("relex after 1 char edit:   %8.2f ms (%.1fx faster)\n",
+                relexMs, lexMs / relexMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+// Compares the memory used per token by a std::vector<Token> and by a
+// TokenBuffer, and the parsing throughput of the streaming parser against the
+// parser iterating over a TokenBuffer by index.
+//
+// Usage: TokenBufferBench [number of functions]
+
+#include "Bench.h"
+
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+int main(int argc, char **argv) {
+    const std::string src =
+        bench::generateModule(bench::parseSizeArg(argc, argv, 50000));
+
+    lang::SymbolTable symbols;
+    std::vector<lang::Token> vector;
+    lang::Lexer vectorLexer(symbols, src);
+    while (const auto token = vectorLexer.next()) {
+        vector.push_back(*token);
+    }
+
+    lang::Lexer bufferLexer(symbols, src);
+    const lang::LexResult lexResult = bufferLexer.lexAll();
+    const lang::TokenBuffer &tokens = lexResult.tokens;
+
+    const double numTokens = static_cast<double>(tokens.size());
+    std::printf("input: %.1f MiB, %zu tokens\n",
+                static_cast<double>(src.size()) / (1024 * 1024),
+                tokens.size());
+    std::printf("memory per token: std::vector<Token> %zu B (%.2f B reserved), "
+                "TokenBuffer %zu B (%.2f B reserved)\n",
+                sizeof(lang::Token),
+                static_cast<double>(vector.capacity() * sizeof(lang::Token)) /
+                    numTokens,
+                sizeof(std::uint8_t) + sizeof(lang::Symbol) +
+                    2 * sizeof(std::uint32_t),
+                static_cast<double>(tokens.getMemoryUsage()) / numTokens);
+
+    const double lexMs = bench::bestOf(5, [&] {
+        lang::SymbolTable symbols;
+        lang::Lexer lexer(symbols, src);
+        const lang::LexResult result = lexer.lexAll();
+    });
+
+    const double streamMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::SymbolTable symbols;
+        lang::Lexer lexer(symbols, src);
+        lang::Parser parser(arena, typeCtx, lexer);
+        const lang::ParseResult result = parser.parseModuleAST();
+    });
+
+    const double bufferMs = bench::bestOf(5, [&] {
+        lang::Arena arena(lang::kiloBytes(32));
+        lang::TypeContext typeCtx(arena);
+        lang::Parser parser(arena, typeCtx, tokens);
+        const lang::ParseResult result = parser.parseModuleAST();
+    });
+
+    std::printf("lex into TokenBuffer:       %8.2f ms\n", lexMs);
+    std::printf("lex + parse (streaming):    %8.2f ms (%6.1f Mtok/s)\n",
+                streamMs, numTokens / streamMs / 1000);
+    std::printf("parse (TokenBuffer):        %8.2f ms (%6.1f Mtok/s)\n",
+                bufferMs, numTokens / bufferMs / 1000);
+    std::printf("lex + parse (TokenBuffer):  %8.2f ms\n", lexMs + bufferMs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// Times type checking of a module in which every function calls up to 16
+// others, with the signatures of the functions made on every reference and
+// cached in their declarations, by walking the AST and over the flat AST.
+// Also times the lookups of nested pointer types in the TypeContext, and
+// counts the distinct hashes of pointer types nested up to 200 deep.
+//
+// Usage: TypeInternBench [number of functions]
+
+#include "Bench.h"
+
+#include "AST/FlatAST.h"
+#include "Analysis/Sema.h"
+#include "Analysis/TypeChecker.h"
+#include "Lex/Lexer.h"
+#include "Parse/Parser.h"
+
+#include <unordered_set>
+
+namespace {
+
+constexpr std::size_t callsPerFunction = 16;
+
+/// @brief Generates a module of functions of two parameters, each of which
+/// calls the functions before it, up to callsPerFunction of them
+std::string generateCallModule(std::size_t numFunctions) {
+    std::string src;
+    src.reserve(numFunctions * (80 + 16 * callsPerFunction));
+    for (std::size_t i = 0; i < numFunctions; ++i) {
+        src += "fn f" + std::to_string(i);
+        src += "(a: number, b: number): number {\n";
+        src += "    let x = a + b;\n";
+        for (std::size_t k = 1; k <= std::min(i, callsPerFunction); ++k) {
+            src += "    f" + std::to_string(i - k) + "(x, b);\n";
+        }
+        src += "    return x;\n";
+        src += "}\n\n";
+    }
+    return src;
+}
+
+/// @brief Clears the signatures cached in the declarations of the module
+void clearSignatures(lang::ModuleAST &module) {
+    for (lang::DeclAST *decl : module.decls) {
+        static_cast<lang::FunctionDeclAST *>(decl)->type = nullptr;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t numFunctions = bench::parseSizeArg(argc, argv, 50000);
+    const std::string src = generateCallModule(numFunctions);
+
+    std::printf("input: %zu functions, %zu calls each\n", numFunctions,
+                callsPerFunction);
+
+    lang::SymbolTable symbols;
+    lang::Lexer lexer(symbols, src);
+    const lang::LexResult lexResult = lexer.lexAll();
+    lang::Arena arena(lang::Arena::getInitialSize(src.size()));
+    lang::TypeContext typeCtx(arena);
+    lang::Parser parser(arena, typeCtx, lexResult.tokens);
+    lang::ParseResult result = parser.parseModuleAST();
+    lang::ModuleAST &module = *result.module;
+
+    lang::Sema sema(typeCtx);
+    const lang::SemaResult semaResult = sema.analyzeModuleAST(module);
+    if (!result.errors.empty() || !semaResult.cfa.errors.empty() ||
+        !semaResult.resolve.errors.empty() ||
+        !semaResult.typeChecker.errors.empty()) {
+        std::fprintf(stderr, "error: the module does not compile\n");
+        return EXIT_FAILURE;
+    }
+
+    lang::ASTFlattener flattener;
+    lang::FlatAST flat = flattener.flattenModuleAST(module);
+
+    const auto measure = [&](const char *name, bool cold, auto &&check) {
+        std::size_t rolledBack = 0;
+        const double ms = bench::bestOf(5, [&] {
+            if (cold) {
+                clearSignatures(module);
+            }
+            const std::size_t before = arena.totalRolledBack();
+            lang::TypeChecker typeChecker(typeCtx);
+            if (check(typeChecker).hasErrors()) {
+                std::fprintf(stderr, "error: the module does not compile\n");
+                std::exit(EXIT_FAILURE);
+            }
+            rolledBack = arena.totalRolledBack() - before;
+        });
+        std::printf("%-28s %8.2f ms, %8.1f KiB of signatures rolled back\n",
+                    name, ms, static_cast<double>(rolledBack) / 1024);
+    };
+    const auto checkTree = [&](lang::TypeChecker &typeChecker) {
+        return typeChecker.analyzeModuleAST(module);
+    };
+    const auto checkFlat = [&](lang::TypeChecker &typeChecker) {
+        return typeChecker.analyzeFlatAST(flat);
+    };
+    measure("type check, cold signatures", true, checkTree);
+    measure("type check, warm signatures", false, checkTree);
+    measure("type check (flat), cold", true, checkFlat);
+    measure("type check (flat), warm", false, checkFlat);
+
+    // NOTE: Every lookup finds a type made already, which rolls back the
+    // fresh one
+    constexpr std::size_t maxDepth = 200;
+    std::vector<lang::Type *> pointers = {typeCtx.getTypeNumber()};
+    for (std::size_t depth = 1; depth <= maxDepth; ++depth) {
+        pointers.push_back(typeCtx.make<lang::PointerType>(pointers.back()));
+    }
+    constexpr std::size_t numLookups = 1000000;
+    std::size_t numMismatches = 0;
+    const double lookupMs = bench::bestOf(3, [&] {
+        for (std::size_t i = 0; i < numLookups; ++i) {
+            const std::size_t depth = i % 64;
+            numMismatches += typeCtx.make<lang::PointerType>(
+                                 pointers[depth]) != pointers[depth + 1];
+        }
+    });
+    std::unordered_set<std::size_t> hashes;
+    for (const lang::Type *type : pointers) {
+        hashes.insert(lang::HashType()(type));
+    }
+    if (numMismatches != 0) {
+        std::fprintf(stderr, "error: a pointer type was made twice\n");
+        return EXIT_FAILURE;
+    }
+    std::printf("%zu lookups of pointer types nested up to 64 deep: %.2f ms\n",
+                numLookups, lookupMs);
+    std::printf("%zu distinct hashes of %zu pointer types nested up to %zu "
+                "deep\n",
+                hashes.size(), pointers.size(), maxDepth);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#ifndef LANG_ARENA_ARRAY_H
+#define LANG_ARENA_ARRAY_H
+
+#include "Alloc/Arena.h"
+#include "Alloc/ArenaRef.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace lang {
+
+/// @brief Immutable array whose elements are stored contiguously in an arena
+/// @note The array does not own its elements, so copying it only copies the
+/// 32-bit reference and length it is made of. Arrays are built once their
+/// elements are known, typically from a scratch vector that is reused across
+/// arrays.
+template <typename T> class ArenaArray {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_destructible_v<T>,
+                  "T must be trivially copyable and destructible");
+
+  public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    ArenaArray() noexcept : mData(nullptr), mSize(0) {}
+
+    /// @brief Refers to the given number of elements already stored in an
+    /// arena
+    ArenaArray(ArenaRef<T> data, std::uint32_t size) noexcept
+        : mData(data), mSize(size) {}
+
+    /// @brief Copies the given elements into the given arena
+    ArenaArray(Arena &arena, const T *first, std::size_t size)
+        : mData(nullptr), mSize(static_cast<std::uint32_t>(size)) {
+        assert(size <= UINT32_MAX && "array too large");
+        if (size != 0) {
+            T *data = arena.allocArray<T>(size);
+            std::memcpy(data, first, size * sizeof(T));
+            mData = data;
+        }
+    }
+
+    /// @brief Copies the elements of the given contiguous range into the
+    /// given arena
+    template <typename Range>
+    ArenaArray(Arena &arena, const Range &range)
+        : ArenaArray(arena, std::data(range), std::size(range)) {}
+
+    /// @brief Returns the reference to the elements, which is null for an
+    /// empty array
+    [[nodiscard]] const ArenaRef<T> &getData() const noexcept { return mData; }
+
+    [[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+    [[nodiscard]] std::size_t size() const noexcept { return mSize; }
+
+    [[nodiscard]] iterator begin() noexcept { return mData.get(); }
+    [[nodiscard]] const_iterator begin() const noexcept { return mData.get(); }
+    [[nodiscard]] iterator end() noexcept { return begin() + mSize; }
+    [[nodiscard]] const_iterator end() const noexcept {
+        return begin() + mSize;
+    }
+
+    [[nodiscard]] T &operator[](std::size_t i) {
+        assert(i < mSize);
+        return begin()[i];
+    }
+    [[nodiscard]] const T &operator[](std::size_t i) const {
+        assert(i < mSize);
+        return begin()[i];
+    }
+
+    T &front() { return (*this)[0]; }
+    [[nodiscard]] const T &front() const { return (*this)[0]; }
+    T &back() { return (*this)[mSize - 1]; }
+    [[nodiscard]] const T &back() const { return (*this)[mSize - 1]; }
+
+  private:
+    ArenaRef<T> mData;
+    std::uint32_t mSize;
+};
+
+template <typename Range>
+ArenaArray(Arena &, const Range &) -> ArenaArray<std::remove_cv_t<
+    std::remove_pointer_t<decltype(std::data(std::declval<const Range &>()))>>>;
+
+} // namespace lang
+
+#endif // LANG_ARENA_ARRAY_H
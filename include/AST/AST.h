@@ -1,15 +1,30 @@
 #ifndef LANG_AST_H
 #define LANG_AST_H
 
-#include "ADT/NonOwningList.h"
+#include "ADT/ArenaArray.h"
+
+#include "Alloc/ArenaRef.h"
+
+#include "Support/SourceSpan.h"
+#include "Support/SymbolTable.h"
 
 #include "Typing/Type.h"
 
+#include <cassert>
+#include <cstdint>
 #include <string_view>
 #include <variant>
 
 namespace lang {
 
+// NOTE: Nodes refer to their children, their types and their declarations
+// through 32-bit ArenaRefs, and to their text through SourceSpans into the
+// source buffer of their module, which halves the size of most nodes compared
+// to pointers and std::string_views. Both convert back on access, so that
+// passes read nodes as if they held pointers.
+
+template <typename T> using NodeArray = ArenaArray<ArenaRef<T>>;
+
 // == UnOpKind ==
 
 enum class UnOpKind : int {
@@ -40,7 +55,7 @@ std::string binOpKindToString(BinOpKind kind);
 
 // == ExprAST ==
 
-enum class ExprASTKind {
+enum class ExprASTKind : std::uint8_t {
     Number,
     Identifier,
     Unary,
@@ -52,15 +67,15 @@ enum class ExprASTKind {
 
 struct ExprAST {
     ExprASTKind kind;
-    std::string_view span;
-    Type *type;
-    ExprAST(ExprASTKind kind, std::string_view span)
+    SourceSpan span;
+    ArenaRef<Type> type;
+    ExprAST(ExprASTKind kind, SourceSpan span)
         : kind(kind), span(span), type(nullptr) {}
 };
 
 // == StmtAST ==
 
-enum class StmtASTKind {
+enum class StmtASTKind : std::uint8_t {
     Expr,
     Break,
     Return,
@@ -73,149 +88,209 @@ enum class StmtASTKind {
 
 struct StmtAST {
     StmtASTKind kind;
-    std::string_view span;
-    StmtAST(StmtASTKind kind, std::string_view span) : kind(kind), span(span) {}
+    SourceSpan span;
+    StmtAST(StmtASTKind kind, SourceSpan span) : kind(kind), span(span) {}
 };
 
 // == DeclAST ==
 
-enum class DeclASTKind {
+enum class DeclASTKind : std::uint8_t {
     Function,
 };
 
 struct DeclAST {
     DeclASTKind kind;
-    std::string_view ident;
-    DeclAST(DeclASTKind kind, std::string_view ident)
+    SourceSpan ident;
+    DeclAST(DeclASTKind kind, SourceSpan ident)
         : kind(kind), ident(ident) {}
 };
 
 // == ModuleAST ==
 
+class DeferredBodyParser;
+
 struct ModuleAST {
     std::string_view ident;
-    NonOwningList<DeclAST *> decls;
-    ModuleAST(std::string_view ident, NonOwningList<DeclAST *> decls)
-        : ident(ident), decls(decls) {}
+    /// @brief Buffer that the spans of the nodes are offsets into
+    std::string_view source;
+    NodeArray<DeclAST> decls;
+    /// @brief Parser of the function bodies whose parsing was deferred, null
+    /// if none was
+    DeferredBodyParser *bodyParser;
+    ModuleAST(std::string_view ident, std::string_view source,
+              NodeArray<DeclAST> decls,
+              DeferredBodyParser *bodyParser = nullptr)
+        : ident(ident), source(source), decls(decls), bodyParser(bodyParser) {
+    }
 };
 
 // === Expressions ===
 
 struct NumberExprAST : public ExprAST {
-    explicit NumberExprAST(std::string_view span)
-        : ExprAST(ExprASTKind::Number, span) {}
+    /// @brief Value of the literal, decoded once by the parser
+    double value;
+    NumberExprAST(SourceSpan span, double value)
+        : ExprAST(ExprASTKind::Number, span), value(value) {}
 };
 
 struct UnaryExprAST : public ExprAST {
     UnOpKind op;
-    ExprAST *expr;
-    UnaryExprAST(std::string_view span, UnOpKind op, ExprAST *expr)
+    ArenaRef<ExprAST> expr;
+    UnaryExprAST(SourceSpan span, UnOpKind op, ExprAST *expr)
         : ExprAST(ExprASTKind::Unary, span), op(op), expr(expr) {}
 };
 
 struct BinaryExprAST : public ExprAST {
     BinOpKind op;
-    ExprAST *lhs;
-    ExprAST *rhs;
-    BinaryExprAST(std::string_view span, BinOpKind op, ExprAST *lhs,
-                  ExprAST *rhs)
+    ArenaRef<ExprAST> lhs;
+    ArenaRef<ExprAST> rhs;
+    BinaryExprAST(SourceSpan span, BinOpKind op, ExprAST *lhs, ExprAST *rhs)
         : ExprAST(ExprASTKind::Binary, span), op(op), lhs(lhs), rhs(rhs) {}
 };
 
 struct CallExprAST : public ExprAST {
-    ExprAST *callee;
-    NonOwningList<ExprAST *> args;
-    CallExprAST(std::string_view span, ExprAST *callee,
-                NonOwningList<ExprAST *> args)
+    ArenaRef<ExprAST> callee;
+    NodeArray<ExprAST> args;
+    CallExprAST(SourceSpan span, ExprAST *callee, NodeArray<ExprAST> args)
         : ExprAST(ExprASTKind::Call, span), callee(callee), args(args) {}
 };
 
 struct IndexExprAST : public ExprAST {
-    ExprAST *base;
-    ExprAST *index;
+    ArenaRef<ExprAST> base;
+    ArenaRef<ExprAST> index;
     // NOLINTNEXTLINE
-    IndexExprAST(std::string_view span, ExprAST *base, ExprAST *index)
+    IndexExprAST(SourceSpan span, ExprAST *base, ExprAST *index)
         : ExprAST(ExprASTKind::Index, span), base(base), index(index) {}
 };
 
 struct GroupedExprAST : public ExprAST {
-    ExprAST *expr;
-    GroupedExprAST(std::string_view span, ExprAST *expr)
+    ArenaRef<ExprAST> expr;
+    GroupedExprAST(SourceSpan span, ExprAST *expr)
         : ExprAST(ExprASTKind::Grouped, span), expr(expr) {}
 };
 
 // === Statements ===
 
 struct ExprStmtAST : public StmtAST {
-    ExprAST *expr;
-    ExprStmtAST(std::string_view span, ExprAST *expr)
+    ArenaRef<ExprAST> expr;
+    ExprStmtAST(SourceSpan span, ExprAST *expr)
         : StmtAST(StmtASTKind::Expr, span), expr(expr) {}
 };
 
 struct BreakStmtAST : public StmtAST {
-    StmtAST *target;
-    explicit BreakStmtAST(std::string_view span)
+    ArenaRef<StmtAST> target;
+    explicit BreakStmtAST(SourceSpan span)
         : StmtAST(StmtASTKind::Break, span), target(nullptr) {}
 };
 
 struct ReturnStmtAST : public StmtAST {
-    ExprAST *expr;
-    ReturnStmtAST(std::string_view span, ExprAST *expr)
+    ArenaRef<ExprAST> expr;
+    ReturnStmtAST(SourceSpan span, ExprAST *expr)
         : StmtAST(StmtASTKind::Return, span), expr(expr) {}
 };
 
 struct LocalStmtAST : public StmtAST {
     bool isConst;
-    Type *type;
-    ExprAST *init;
-    LocalStmtAST(bool isConst, std::string_view ident, Type *type,
+    Symbol symbol;
+    ArenaRef<Type> type;
+    ArenaRef<ExprAST> init;
+    LocalStmtAST(bool isConst, SourceSpan ident, Symbol symbol, Type *type,
                  ExprAST *init)
-        : StmtAST(StmtASTKind::Local, ident), isConst(isConst), type(type),
-          init(init) {}
+        : StmtAST(StmtASTKind::Local, ident), isConst(isConst), symbol(symbol),
+          type(type), init(init) {}
 };
 
 struct AssignStmtAST : public StmtAST {
-    ExprAST *lhs;
-    ExprAST *rhs;
-    AssignStmtAST(std::string_view span, ExprAST *lhs, ExprAST *rhs)
+    ArenaRef<ExprAST> lhs;
+    ArenaRef<ExprAST> rhs;
+    AssignStmtAST(SourceSpan span, ExprAST *lhs, ExprAST *rhs)
         : StmtAST(StmtASTKind::Assign, span), lhs(lhs), rhs(rhs) {}
 };
 
 struct BlockStmtAST : public StmtAST {
-    NonOwningList<StmtAST *> stmts;
-    BlockStmtAST(std::string_view span, NonOwningList<StmtAST *> stmts)
+    NodeArray<StmtAST> stmts;
+    BlockStmtAST(SourceSpan span, NodeArray<StmtAST> stmts)
         : StmtAST(StmtASTKind::Block, span), stmts(stmts) {}
 };
 
 struct IfStmtAST : public StmtAST {
-    ExprAST *cond;
-    BlockStmtAST *thenStmt;
-    StmtAST *elseStmt;
-    IfStmtAST(std::string_view span, ExprAST *cond, BlockStmtAST *thenStmt,
+    ArenaRef<ExprAST> cond;
+    ArenaRef<BlockStmtAST> thenStmt;
+    ArenaRef<StmtAST> elseStmt;
+    IfStmtAST(SourceSpan span, ExprAST *cond, BlockStmtAST *thenStmt,
               StmtAST *elseStmt)
         : StmtAST(StmtASTKind::If, span), cond(cond), thenStmt(thenStmt),
           elseStmt(elseStmt) {}
 };
 
 struct WhileStmtAST : public StmtAST {
-    ExprAST *cond;
-    BlockStmtAST *body;
-    WhileStmtAST(std::string_view span, ExprAST *cond, BlockStmtAST *body)
+    ArenaRef<ExprAST> cond;
+    ArenaRef<BlockStmtAST> body;
+    WhileStmtAST(SourceSpan span, ExprAST *cond, BlockStmtAST *body)
         : StmtAST(StmtASTKind::While, span), cond(cond), body(body) {}
 };
 
 /// === Declarations ===
 
+struct FunctionDeclAST;
+
+class ASTWriter;
+
+/// @brief Parses the bodies of functions whose parsing was deferred
+class DeferredBodyParser {
+  public:
+    /// @brief Parses the body of the given function, which spans the tokens
+    /// from bodyBegin to bodyEnd
+    virtual BlockStmtAST *parseBody(const FunctionDeclAST &node) = 0;
+
+  protected:
+    ~DeferredBodyParser() = default;
+};
+
 struct FunctionDeclAST : public DeclAST {
-    NonOwningList<LocalStmtAST *> params;
-    Type *retType;
-    BlockStmtAST *body;
-    Type *type;
-    FunctionDeclAST(std::string_view ident,
-                    NonOwningList<LocalStmtAST *> params, Type *retType,
+    Symbol symbol;
+    NodeArray<LocalStmtAST> params;
+    ArenaRef<Type> retType;
+    /// @brief Signature of the function, cached by the type checker on the
+    /// first reference to the function
+    /// @note Like every type of the AST, it belongs to the TypeContext that
+    /// the AST was parsed or loaded with, which is the only one that the AST
+    /// may be type checked against.
+    ArenaRef<Type> type;
+    /// @brief Range of the tokens of a deferred body
+    std::uint32_t bodyBegin;
+    std::uint32_t bodyEnd;
+    FunctionDeclAST(SourceSpan ident, Symbol symbol,
+                    NodeArray<LocalStmtAST> params, Type *retType,
                     BlockStmtAST *body)
-        : DeclAST(DeclASTKind::Function, ident), params(params),
-          retType(retType), body(body), type(nullptr) {}
+        : DeclAST(DeclASTKind::Function, ident), symbol(symbol),
+          params(params), retType(retType), type(nullptr), bodyBegin(0),
+          bodyEnd(0), body(body) {}
+    FunctionDeclAST(SourceSpan ident, Symbol symbol,
+                    NodeArray<LocalStmtAST> params, Type *retType,
+                    std::uint32_t bodyBegin, std::uint32_t bodyEnd)
+        : DeclAST(DeclASTKind::Function, ident), symbol(symbol),
+          params(params), retType(retType), type(nullptr),
+          bodyBegin(bodyBegin), bodyEnd(bodyEnd), body(nullptr) {}
+
+    /// @brief Returns the body, parsing it on the first call with the given
+    /// parser, the ModuleAST::bodyParser of the module, if its parsing was
+    /// deferred
+    [[nodiscard]] BlockStmtAST *getBody(DeferredBodyParser *parser) const {
+        if (body == nullptr) {
+            assert(parser != nullptr && "deferred body without a parser");
+            body = parser->parseBody(*this);
+        }
+        return body;
+    }
+
+    /// @brief Returns whether the body has been parsed
+    [[nodiscard]] bool hasParsedBody() const { return body != nullptr; }
+
+  private:
+    friend class ASTWriter;
+
+    mutable ArenaRef<BlockStmtAST> body;
 };
 
 /// === Identifier Expressions ===
@@ -223,9 +298,33 @@ struct FunctionDeclAST : public DeclAST {
 using IdentifierDecl = std::variant<LocalStmtAST *, FunctionDeclAST *>;
 
 struct IdentifierExprAST : public ExprAST {
-    IdentifierDecl decl;
-    explicit IdentifierExprAST(std::string_view span)
-        : ExprAST(ExprASTKind::Identifier, span) {}
+    Symbol symbol;
+    IdentifierExprAST(SourceSpan span, Symbol symbol)
+        : ExprAST(ExprASTKind::Identifier, span), symbol(symbol) {}
+
+    /// @brief Returns the declaration the identifier resolved to, which is a
+    /// null local before resolution
+    [[nodiscard]] IdentifierDecl getDecl() const {
+        if (function != nullptr) {
+            return function.get();
+        }
+        return local.get();
+    }
+
+    void setDecl(IdentifierDecl decl) {
+        auto *const *localDecl = std::get_if<LocalStmtAST *>(&decl);
+        auto *const *functionDecl = std::get_if<FunctionDeclAST *>(&decl);
+        local = localDecl != nullptr ? *localDecl : nullptr;
+        function = functionDecl != nullptr ? *functionDecl : nullptr;
+    }
+
+  private:
+    friend class ASTWriter;
+
+    // NOTE: A variant would take a pointer and a tag, where two references
+    // take 8 bytes
+    ArenaRef<LocalStmtAST> local;
+    ArenaRef<FunctionDeclAST> function;
 };
 
 } // namespace lang
@@ -0,0 +1,225 @@
+#ifndef LANG_AST_IMAGE_H
+#define LANG_AST_IMAGE_H
+
+#include "AST/ASTVisitor.h"
+
+#include "Typing/TypeContext.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lang {
+
+// NOTE: An AST image holds the nodes of a module laid out as in memory,
+// followed by tables that list where the nodes refer to each other, to types
+// and to symbols. The nodes refer to each other through the offsets they get
+// when the image is mapped at its preferred offset of the ArenaSpace, near its
+// top, where a process that has not loaded an image yet has nothing. Loading
+// the image there thus maps it as is, and only the references to types and,
+// in a symbol table that is not fresh, to symbols are rewritten, which copies
+// the pages they are on. The nodes that refer to types are thus laid out
+// last, together. Elsewhere, the references between nodes are relocated too.
+// Spans are offsets into the source, which the image checks by size and hash,
+// so they stay valid as is.
+
+// == ASTWriter ==
+
+/// @brief Encodes a module into an AST image
+class ASTWriter : public ConstASTVisitor<ASTWriter> {
+    friend class ASTVisitor<ASTWriter, true>;
+
+  public:
+    /// @brief Reference to a type, at the given position of the nodes
+    struct TypeRef {
+        std::uint32_t position;
+        std::uint32_t type;
+    };
+
+    /// @brief Returns the image of the given module, whose symbols are
+    /// interned in the given table
+    /// @note Deferred bodies are parsed as they are written.
+    [[nodiscard]] std::string writeModuleAST(const ModuleAST &module,
+                                             const SymbolTable &symbols);
+
+    /// @brief Gives the file open with the given descriptor, which starts
+    /// with the given image, the time at which the image was written as its
+    /// modification time, so that loading the image skips hashing its nodes
+    /// until the file is written again
+    /// @note Does nothing if the descriptor does not refer to a regular file
+    /// at least as large as the image.
+    static void stampFile(int fd, std::string_view image);
+
+  private:
+    /// @brief Bit set in the positions of the typed nodes, which are laid
+    /// out after the others once all are written
+    static constexpr std::uint32_t typedBit = std::uint32_t(1) << 31;
+
+    std::string nodes;
+    /// @brief Nodes that refer to a type
+    std::string typedNodes;
+    /// @brief Positions of the references between nodes
+    std::vector<std::uint32_t> nodeRefs;
+    std::vector<TypeRef> typeRefs;
+    /// @brief Positions of the symbols
+    std::vector<std::uint32_t> symbolRefs;
+    /// @brief Kind, number of children and children of every type, children
+    /// first
+    std::vector<std::uint32_t> typeWords;
+    std::unordered_map<const Type *, std::uint32_t> typeIndices;
+    /// @brief Positions of the nodes whose parent is not written yet
+    std::vector<std::uint32_t> values;
+    /// @brief Positions of the locals, loops and functions, which nodes refer
+    /// to besides their children
+    std::unordered_map<const void *, std::uint32_t> declPositions;
+    /// @brief References to declarations written after the reference
+    std::vector<std::pair<std::uint32_t, const void *>> pendingRefs;
+
+    template <typename T>
+    std::uint32_t copyNode(const T &node, bool typed = false);
+
+    template <typename T, typename F>
+    static std::uint32_t getPosition(std::uint32_t position, const T &node,
+                                     const F &field) {
+        return position +
+               static_cast<std::uint32_t>(
+                   reinterpret_cast<const char *>(&field) -
+                   reinterpret_cast<const char *>(&node));
+    }
+
+    template <typename F>
+    void writeField(std::uint32_t position, const F &value) {
+        char *data = (position & typedBit) != 0
+                         ? typedNodes.data() + (position & ~typedBit)
+                         : nodes.data() + position;
+        std::memcpy(data, &value, sizeof(F));
+    }
+
+    template <typename T, typename U>
+    void writeRef(std::uint32_t position, const T &node,
+                  const ArenaRef<U> &field, std::uint32_t target);
+
+    template <typename T, typename U>
+    void writeDeclRef(std::uint32_t position, const T &node,
+                      const ArenaRef<U> &field);
+
+    template <typename T>
+    void writeType(std::uint32_t position, const T &node,
+                   const ArenaRef<Type> &field);
+
+    template <typename T>
+    void writeSymbol(std::uint32_t position, const T &node,
+                     const Symbol &field) {
+        symbolRefs.push_back(getPosition(position, node, field));
+    }
+
+    /// @brief Writes the given number of nodes on top of the values as an
+    /// array, and returns its position
+    std::uint32_t writeArray(std::size_t size);
+
+    std::uint32_t getTypeIndex(const Type *type);
+
+    std::uint32_t popValue() {
+        const std::uint32_t value = values.back();
+        values.pop_back();
+        return value;
+    }
+
+    using ASTVisitor::leave;
+
+    // NOTE: Nodes are written on leave, after their children, whose positions
+    // they pop from the values
+
+    void leave(const FunctionDeclAST &node);
+
+    void leave(const ExprStmtAST &node);
+
+    void leave(const BreakStmtAST &node);
+
+    void leave(const ReturnStmtAST &node);
+
+    void leave(const LocalStmtAST &node);
+
+    void leave(const AssignStmtAST &node);
+
+    void leave(const BlockStmtAST &node);
+
+    void leave(const IfStmtAST &node);
+
+    void leave(const WhileStmtAST &node);
+
+    void leave(const NumberExprAST &node);
+
+    void leave(const IdentifierExprAST &node);
+
+    void leave(const UnaryExprAST &node);
+
+    void leave(const BinaryExprAST &node);
+
+    void leave(const CallExprAST &node);
+
+    void leave(const IndexExprAST &node);
+
+    void leave(const GroupedExprAST &node);
+};
+
+// == ASTImage ==
+
+/// @brief Module loaded from an AST image, whose nodes live as long as the
+/// image
+class ASTImage {
+  public:
+    /// @brief Loads the image in the given file, written for the given source
+    /// @note The module, its name and its types are allocated in the given
+    /// arena and type context, and its symbols interned in the given table.
+    /// The header and the tables are checked by hash, and the positions
+    /// listed by the tables by bounds. The nodes are checked by hash too
+    /// unless the file still has the modification time given by
+    /// ASTWriter::stampFile, so that a corrupted or truncated image is
+    /// rejected before any of its nodes is visited. The targets of the
+    /// references are also checked by bounds as they are relocated.
+    static llvm::Expected<ASTImage> load(llvm::StringRef filename,
+                                         std::string_view source,
+                                         Arena &arena, TypeContext &typeCtx,
+                                         SymbolTable &symbols);
+
+    ASTImage(const ASTImage &) = delete;
+    ASTImage &operator=(const ASTImage &) = delete;
+
+    ASTImage(ASTImage &&other) noexcept
+        : module(other.module), data(std::exchange(other.data, nullptr)),
+          size(other.size), mapped(other.mapped) {}
+
+    ASTImage &operator=(ASTImage &&other) noexcept;
+
+    ~ASTImage();
+
+    [[nodiscard]] ModuleAST &getModule() const { return *module; }
+
+    /// @brief Returns whether the nodes were mapped at their preferred offset
+    /// as is, rather than copied and relocated
+    [[nodiscard]] bool isMapped() const { return mapped; }
+
+  private:
+    ModuleAST *module;
+    std::byte *data;
+    std::size_t size;
+    bool mapped;
+
+    ASTImage(ModuleAST *module, std::byte *data, std::size_t size,
+             bool mapped)
+        : module(module), data(data), size(size), mapped(mapped) {}
+
+    void release();
+};
+
+} // namespace lang
+
+#endif // LANG_AST_IMAGE_H
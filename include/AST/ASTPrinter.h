@@ -8,48 +8,57 @@
 namespace lang {
 
 class ASTPrinter : public ConstASTVisitor<ASTPrinter> {
+    friend class ASTVisitor<ASTPrinter, true>;
+
   public:
     explicit ASTPrinter(llvm::raw_ostream &os) : level(-1), os(os) {}
 
     void visit(const ModuleAST &node);
 
-    void visit(const FunctionDeclAST &node);
+  private:
+    int level;
+    llvm::raw_ostream &os;
+    /// @brief Source buffer of the module being printed
+    std::string_view source;
 
-    void visit(const ExprStmtAST &node);
+    void ident();
 
-    void visit(const BreakStmtAST &node);
+    // NOTE: Every node prints itself on enter, one level deeper than its
+    // parent, and goes back to the level of its parent on leave
 
-    void visit(const ReturnStmtAST &node);
+    bool enter(const FunctionDeclAST &node);
 
-    void visit(const LocalStmtAST &node);
+    bool enter(const ExprStmtAST &node);
 
-    void visit(const AssignStmtAST &node);
+    bool enter(const BreakStmtAST &node);
 
-    void visit(const BlockStmtAST &node);
+    bool enter(const ReturnStmtAST &node);
 
-    void visit(const IfStmtAST &node);
+    bool enter(const LocalStmtAST &node);
 
-    void visit(const WhileStmtAST &node);
+    bool enter(const AssignStmtAST &node);
 
-    void visit(const IdentifierExprAST &node);
+    bool enter(const BlockStmtAST &node);
 
-    void visit(const NumberExprAST &node);
+    bool enter(const IfStmtAST &node);
 
-    void visit(const UnaryExprAST &node);
+    bool enter(const WhileStmtAST &node);
 
-    void visit(const BinaryExprAST &node);
+    bool enter(const IdentifierExprAST &node);
 
-    void visit(const CallExprAST &node);
+    bool enter(const NumberExprAST &node);
 
-    void visit(const IndexExprAST &node);
+    bool enter(const UnaryExprAST &node);
 
-    void visit(const GroupedExprAST &node);
+    bool enter(const BinaryExprAST &node);
 
-  private:
-    int level;
-    llvm::raw_ostream &os;
+    bool enter(const CallExprAST &node);
 
-    void ident();
+    bool enter(const IndexExprAST &node);
+
+    bool enter(const GroupedExprAST &node);
+
+    template <typename T> void leave(const T &node) { --level; }
 };
 
 } // namespace lang
@@ -3,8 +3,25 @@
 
 #include "AST.h"
 
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 namespace lang {
 
+/// @brief Dispatches on the kind of AST nodes to the visit methods of Derived
+/// @note Besides visit, which leaves the traversal to Derived, walk traverses
+/// a whole subtree without recursion, so that its stack usage does not grow
+/// with the depth of the AST. It calls the following hooks of Derived on every
+/// node, which default to doing nothing:
+/// - `bool enter(Node &node)` before the children, which are skipped when it
+///   returns false;
+/// - `bool enterChild(Node &node, std::size_t index)` before every non-null
+///   child, which is skipped when it returns false, where index is the
+///   position of the child among the children of node in source order;
+/// - `void leave(Node &node)` after the children.
+/// Derived classes that define some of the hooks bring the defaults of the
+/// others into scope with a using declaration.
 template <typename Derived, bool IsConst = true> class ASTVisitor {
   protected:
     template <typename T>
@@ -12,6 +29,24 @@ template <typename Derived, bool IsConst = true> class ASTVisitor {
 
     ASTVisitor() = default;
 
+    template <typename T> bool enter(T &node) { return true; }
+
+    template <typename T> bool enterChild(T &node, std::size_t index) {
+        return true;
+    }
+
+    template <typename T> void leave(T &node) {}
+
+    /// @brief Parser of the deferred function bodies of the module being
+    /// walked, which derived classes take from the module before walking it
+    DeferredBodyParser *bodyParser = nullptr;
+
+    void walk(MaybeConst<DeclAST> &node) { walk(&node, Category::Decl); }
+
+    void walk(MaybeConst<StmtAST> &node) { walk(&node, Category::Stmt); }
+
+    void walk(MaybeConst<ExprAST> &node) { walk(&node, Category::Expr); }
+
     void visit(MaybeConst<ExprAST> &node) {
         switch (node.kind) {
         case ExprASTKind::Number:
@@ -76,7 +111,285 @@ template <typename Derived, bool IsConst = true> class ASTVisitor {
     }
 
   private:
+    enum class Category : std::uint8_t {
+        Decl,
+        Stmt,
+        Expr,
+    };
+
+    enum class Hook : std::uint8_t {
+        Enter,
+        EnterChild,
+        Leave,
+    };
+
+    using NodePtr = std::conditional_t<IsConst, const void *, void *>;
+
+    /// @brief Node being walked, with the position of its next child
+    struct Frame {
+        NodePtr node;
+        Category category;
+        bool entered = false;
+        std::size_t index = 0;
+
+        Frame(NodePtr node, Category category)
+            : node(node), category(category) {}
+    };
+
+    /// @brief Frames of the nodes being walked, kept between walks to reuse
+    /// their storage
+    std::vector<Frame> frames;
+
     Derived &derived() { return static_cast<Derived &>(*this); }
+
+    void walk(NodePtr root, Category category) {
+        const std::size_t base = frames.size();
+        frames.emplace_back(root, category);
+        while (frames.size() != base) {
+            Frame &frame = frames.back();
+            if (!frame.entered) {
+                frame.entered = true;
+                if (!dispatch(frame, Hook::Enter)) {
+                    dispatch(frame, Hook::Leave);
+                    frames.pop_back();
+                    continue;
+                }
+            }
+
+            std::optional<Frame> child;
+            std::size_t index = 0;
+            do {
+                index = frame.index++;
+                child = nextChild(frame, index);
+            } while (child && child->node == nullptr);
+
+            if (!child) {
+                dispatch(frame, Hook::Leave);
+                frames.pop_back();
+            } else if (dispatch(frame, Hook::EnterChild, index)) {
+                frames.push_back(*child);
+            }
+        }
+    }
+
+    template <typename T> bool call(T &node, Hook hook, std::size_t index) {
+        switch (hook) {
+        case Hook::Enter:
+            return derived().enter(node);
+        case Hook::EnterChild:
+            return derived().enterChild(node, index);
+        case Hook::Leave:
+            derived().leave(node);
+            break;
+        }
+        return true;
+    }
+
+    bool dispatch(const Frame &frame, Hook hook, std::size_t index = 0) {
+        switch (frame.category) {
+        case Category::Decl: {
+            auto &node = *static_cast<MaybeConst<DeclAST> *>(frame.node);
+            switch (node.kind) {
+            case DeclASTKind::Function:
+                return call(static_cast<MaybeConst<FunctionDeclAST> &>(node),
+                            hook, index);
+            }
+        } break;
+
+        case Category::Stmt: {
+            auto &node = *static_cast<MaybeConst<StmtAST> *>(frame.node);
+            switch (node.kind) {
+            case StmtASTKind::Expr:
+                return call(static_cast<MaybeConst<ExprStmtAST> &>(node), hook,
+                            index);
+            case StmtASTKind::Break:
+                return call(static_cast<MaybeConst<BreakStmtAST> &>(node),
+                            hook, index);
+            case StmtASTKind::Return:
+                return call(static_cast<MaybeConst<ReturnStmtAST> &>(node),
+                            hook, index);
+            case StmtASTKind::Local:
+                return call(static_cast<MaybeConst<LocalStmtAST> &>(node),
+                            hook, index);
+            case StmtASTKind::Assign:
+                return call(static_cast<MaybeConst<AssignStmtAST> &>(node),
+                            hook, index);
+            case StmtASTKind::Block:
+                return call(static_cast<MaybeConst<BlockStmtAST> &>(node),
+                            hook, index);
+            case StmtASTKind::If:
+                return call(static_cast<MaybeConst<IfStmtAST> &>(node), hook,
+                            index);
+            case StmtASTKind::While:
+                return call(static_cast<MaybeConst<WhileStmtAST> &>(node),
+                            hook, index);
+            }
+        } break;
+
+        case Category::Expr: {
+            auto &node = *static_cast<MaybeConst<ExprAST> *>(frame.node);
+            switch (node.kind) {
+            case ExprASTKind::Number:
+                return call(static_cast<MaybeConst<NumberExprAST> &>(node),
+                            hook, index);
+            case ExprASTKind::Identifier:
+                return call(static_cast<MaybeConst<IdentifierExprAST> &>(node),
+                            hook, index);
+            case ExprASTKind::Unary:
+                return call(static_cast<MaybeConst<UnaryExprAST> &>(node),
+                            hook, index);
+            case ExprASTKind::Binary:
+                return call(static_cast<MaybeConst<BinaryExprAST> &>(node),
+                            hook, index);
+            case ExprASTKind::Call:
+                return call(static_cast<MaybeConst<CallExprAST> &>(node), hook,
+                            index);
+            case ExprASTKind::Index:
+                return call(static_cast<MaybeConst<IndexExprAST> &>(node),
+                            hook, index);
+            case ExprASTKind::Grouped:
+                return call(static_cast<MaybeConst<GroupedExprAST> &>(node),
+                            hook, index);
+            }
+        } break;
+        }
+        return true;
+    }
+
+    static std::optional<Frame> stmtChild(StmtAST *child) {
+        return Frame(child, Category::Stmt);
+    }
+
+    static std::optional<Frame> exprChild(ExprAST *child) {
+        return Frame(child, Category::Expr);
+    }
+
+    /// @brief Returns the child at the given position of the node of the
+    /// given frame, whose node is null if the child is, or nothing past the
+    /// last child
+    std::optional<Frame> nextChild(const Frame &frame, std::size_t index) {
+        switch (frame.category) {
+        case Category::Decl: {
+            auto &node =
+                *static_cast<MaybeConst<FunctionDeclAST> *>(frame.node);
+            if (index < node.params.size()) {
+                return stmtChild(node.params[index]);
+            }
+            if (index == node.params.size()) {
+                return stmtChild(node.getBody(bodyParser));
+            }
+        } break;
+
+        case Category::Stmt:
+            return nextStmtChild(frame, index);
+
+        case Category::Expr:
+            return nextExprChild(frame, index);
+        }
+        return std::nullopt;
+    }
+
+    static std::optional<Frame> nextStmtChild(const Frame &frame,
+                                              std::size_t index) {
+        auto &base = *static_cast<MaybeConst<StmtAST> *>(frame.node);
+        switch (base.kind) {
+        case StmtASTKind::Expr:
+            if (index == 0) {
+                return exprChild(
+                    static_cast<MaybeConst<ExprStmtAST> &>(base).expr);
+            }
+            break;
+        case StmtASTKind::Break:
+            break;
+        case StmtASTKind::Return:
+            if (index == 0) {
+                return exprChild(
+                    static_cast<MaybeConst<ReturnStmtAST> &>(base).expr);
+            }
+            break;
+        case StmtASTKind::Local:
+            if (index == 0) {
+                return exprChild(
+                    static_cast<MaybeConst<LocalStmtAST> &>(base).init);
+            }
+            break;
+        case StmtASTKind::Assign: {
+            auto &node = static_cast<MaybeConst<AssignStmtAST> &>(base);
+            if (index <= 1) {
+                return exprChild(index == 0 ? node.lhs : node.rhs);
+            }
+        } break;
+        case StmtASTKind::Block: {
+            auto &node = static_cast<MaybeConst<BlockStmtAST> &>(base);
+            if (index < node.stmts.size()) {
+                return stmtChild(node.stmts[index]);
+            }
+        } break;
+        case StmtASTKind::If: {
+            auto &node = static_cast<MaybeConst<IfStmtAST> &>(base);
+            if (index == 0) {
+                return exprChild(node.cond);
+            }
+            if (index <= 2) {
+                return stmtChild(index == 1 ? node.thenStmt : node.elseStmt);
+            }
+        } break;
+        case StmtASTKind::While: {
+            auto &node = static_cast<MaybeConst<WhileStmtAST> &>(base);
+            if (index == 0) {
+                return exprChild(node.cond);
+            }
+            if (index == 1) {
+                return stmtChild(node.body);
+            }
+        } break;
+        }
+        return std::nullopt;
+    }
+
+    static std::optional<Frame> nextExprChild(const Frame &frame,
+                                              std::size_t index) {
+        auto &base = *static_cast<MaybeConst<ExprAST> *>(frame.node);
+        switch (base.kind) {
+        case ExprASTKind::Number:
+        case ExprASTKind::Identifier:
+            break;
+        case ExprASTKind::Unary:
+            if (index == 0) {
+                return exprChild(
+                    static_cast<MaybeConst<UnaryExprAST> &>(base).expr);
+            }
+            break;
+        case ExprASTKind::Binary: {
+            auto &node = static_cast<MaybeConst<BinaryExprAST> &>(base);
+            if (index <= 1) {
+                return exprChild(index == 0 ? node.lhs : node.rhs);
+            }
+        } break;
+        case ExprASTKind::Call: {
+            auto &node = static_cast<MaybeConst<CallExprAST> &>(base);
+            if (index == 0) {
+                return exprChild(node.callee);
+            }
+            if (index <= node.args.size()) {
+                return exprChild(node.args[index - 1]);
+            }
+        } break;
+        case ExprASTKind::Index: {
+            auto &node = static_cast<MaybeConst<IndexExprAST> &>(base);
+            if (index <= 1) {
+                return exprChild(index == 0 ? node.base : node.index);
+            }
+        } break;
+        case ExprASTKind::Grouped:
+            if (index == 0) {
+                return exprChild(
+                    static_cast<MaybeConst<GroupedExprAST> &>(base).expr);
+            }
+            break;
+        }
+        return std::nullopt;
+    }
 };
 
 template <typename Derived> using ConstASTVisitor = ASTVisitor<Derived, true>;
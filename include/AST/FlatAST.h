@@ -0,0 +1,186 @@
+#ifndef LANG_FLAT_AST_H
+#define LANG_FLAT_AST_H
+
+#include "AST/AST.h"
+#include "AST/ASTVisitor.h"
+#include "Alloc/ArenaAllocator.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lang {
+
+// == FlatKind ==
+
+/// @brief Kind of a node of a FlatAST, which also tells what its operands are
+enum class FlatKind : std::uint8_t {
+    // Expressions, whose operands are the nodes of their children
+    Number,
+    /// @brief Identifier bound to a local, which is its operand
+    LocalRef,
+    /// @brief Identifier bound to a function, whose position in the functions
+    /// of the FlatAST is its operand
+    FunctionRef,
+    Unary,
+    Binary,
+    /// @brief Call, whose operands are the callee and the number of arguments
+    Call,
+    Index,
+    Grouped,
+    // Statements
+    Param,
+    Local,
+    /// @brief Return, whose operands are the value and the position of the
+    /// function in the functions of the FlatAST
+    Return,
+    Assign,
+    Expr,
+    Break,
+    /// @brief Block, if and while statements, whose operand is the first node
+    /// of their subtree
+    Block,
+    If,
+    While,
+};
+
+[[nodiscard]] constexpr bool isFlatExpr(FlatKind kind) {
+    return kind <= FlatKind::Grouped;
+}
+
+// == FlatAST ==
+
+/// @brief Function bodies of a module lowered to arrays of nodes in
+/// post-order, where the kinds, the operands and the types of the nodes are
+/// kept in separate arrays
+/// @note Operands are positions of other nodes, which always come before the
+/// node except for a local that refers to itself in its initializer. A pass
+/// can thus run as a forward loop over the kinds, without recursion. Every
+/// node keeps the tree node it was lowered from, which is how diagnostics get
+/// their spans and how results are stored back into the tree.
+struct FlatAST {
+    using Operands = std::array<std::uint32_t, 2>;
+
+    /// @brief Operand of a node that has no such child
+    static constexpr std::uint32_t none = UINT32_MAX;
+
+    /// @brief Source buffer of the module, which spans are offsets into
+    std::string_view source;
+    std::vector<FlatKind> kinds;
+    std::vector<Operands> operands;
+    /// @brief Types of the nodes, which start as the types of the tree nodes
+    std::vector<Type *> types;
+    std::vector<void *> nodes;
+    /// @brief Lowered functions, in module order
+    std::vector<FunctionDeclAST *> functions;
+
+    [[nodiscard]] std::uint32_t size() const {
+        return static_cast<std::uint32_t>(kinds.size());
+    }
+
+    /// @brief Returns the tree node the given node was lowered from
+    template <typename T> [[nodiscard]] T &getNode(std::uint32_t index) const {
+        return *static_cast<T *>(nodes[index]);
+    }
+};
+
+// == ASTFlattener ==
+
+/// @brief Lowers the function bodies of a resolved module to a FlatAST
+class ASTFlattener : public MutableASTVisitor<ASTFlattener> {
+    friend class ASTVisitor<ASTFlattener, false>;
+
+  public:
+    [[nodiscard]] FlatAST flattenModuleAST(ModuleAST &module);
+
+  private:
+    using FunctionMap =
+        ArenaUnorderedMap<const FunctionDeclAST *, std::uint32_t>;
+    using LocalMap = ArenaUnorderedMap<const LocalStmtAST *, std::uint32_t>;
+
+    FlatAST flat;
+    std::uint32_t currentFunction = 0;
+    /// @brief Arena of the tables of the module being lowered
+    Arena moduleArena{kiloBytes(32)};
+    /// @brief Arena of the tables of the function being lowered, which is
+    /// reset after every function
+    Arena scratch{kiloBytes(32)};
+    /// @brief Positions of the functions of the module
+    std::optional<FunctionMap> functionNodes;
+    /// @brief Nodes of the locals of the current function
+    std::optional<LocalMap> localNodes;
+    /// @brief References to locals lowered before the local itself, which
+    /// are patched at the end of the function
+    std::vector<std::pair<std::uint32_t, const LocalStmtAST *>> pendingRefs;
+    /// @brief Nodes of the expressions whose parent is not lowered yet
+    std::vector<std::uint32_t> values;
+    /// @brief First nodes of the subtrees of the statements being lowered
+    std::vector<std::uint32_t> subtrees;
+
+    std::uint32_t push(FlatKind kind, void *node, Type *type,
+                       FlatAST::Operands operands);
+
+    std::uint32_t popValue() {
+        const std::uint32_t value = values.back();
+        values.pop_back();
+        return value;
+    }
+
+    using ASTVisitor::enter;
+    using ASTVisitor::enterChild;
+    using ASTVisitor::leave;
+
+    // NOTE: Nodes are pushed on leave, which yields them in post-order
+
+    bool enter(FunctionDeclAST &node);
+
+    /// @brief Only visits the body, the parameters are lowered on enter
+    bool enterChild(FunctionDeclAST &node, std::size_t index) {
+        return index == node.params.size();
+    }
+
+    bool enter(BlockStmtAST &node);
+
+    bool enter(IfStmtAST &node);
+
+    bool enter(WhileStmtAST &node);
+
+    void leave(FunctionDeclAST &node);
+
+    void leave(ExprStmtAST &node);
+
+    void leave(BreakStmtAST &node);
+
+    void leave(ReturnStmtAST &node);
+
+    void leave(LocalStmtAST &node);
+
+    void leave(AssignStmtAST &node);
+
+    void leave(BlockStmtAST &node);
+
+    void leave(IfStmtAST &node);
+
+    void leave(WhileStmtAST &node);
+
+    void leave(NumberExprAST &node);
+
+    void leave(IdentifierExprAST &node);
+
+    void leave(UnaryExprAST &node);
+
+    void leave(BinaryExprAST &node);
+
+    void leave(CallExprAST &node);
+
+    void leave(IndexExprAST &node);
+
+    void leave(GroupedExprAST &node);
+};
+
+} // namespace lang
+
+#endif // LANG_FLAT_AST_H
@@ -1,9 +1,18 @@
 #ifndef LANG_ARENA_H
 #define LANG_ARENA_H
 
+#include "Alloc/ArenaSpace.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/TypeName.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstddef>
-#include <list>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace lang {
 
@@ -19,10 +28,75 @@ constexpr std::size_t gigaBytes(const std::size_t bytes) {
     return bytes * 1024 * 1024 * 1024;
 }
 
+/// @brief Where an arena takes its memory from
+enum class ArenaBackend : std::uint8_t {
+    /// @brief Blocks of growing size
+    Blocks,
+    /// @brief A single range reserved upfront, whose pages are committed as
+    /// the arena grows into it
+    Reserved,
+    /// @brief A reserved range backed by transparent huge pages where the
+    /// host provides them
+    ReservedHugePages,
+};
+
+/// @brief Number of objects of one type allocated in an arena, and the bytes
+/// that they take
+struct ArenaTypeStats {
+    llvm::StringRef name;
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+};
+
+/// @brief Bump allocator for objects that live as long as the arena
+/// @note Blocks are taken from the ArenaSpace, so that every object can be
+/// referred to by an ArenaRef. Every block is twice as large as the previous
+/// one, up to maxBlockSize, so that a large module takes few blocks. Objects
+/// are aligned to their own alignment only.
+/// A mark saves the state of the arena, which a rollback restores, freeing
+/// every object allocated since, and returning the blocks taken since to the
+/// bins.
+/// Only the allocations per type are opt-in, as they are the only statistics
+/// recorded on every allocation. Blocks freed by reset are kept in
+/// bins by size class, and taken back from the smallest bin whose blocks all
+/// fit the allocation.
+/// With a reserved backend, the arena first allocates from a single range,
+/// which it commits by steps of commitSize, and which reset decommits. Past
+/// its end, the arena goes on with blocks of maxBlockSize.
 class Arena {
   public:
-    explicit Arena(std::size_t bytes)
-        : defaultSize(bytes), numAllocations(0), allocSize(0) {}
+    /// @brief State of an arena saved by mark, which rollback restores
+    class Mark {
+        friend class Arena;
+
+        std::size_t numUsed = 0;
+        std::size_t numRequested = 0;
+        std::size_t numTailBytes = 0;
+        std::size_t allocSize = 0;
+        bool hasBlock = false;
+    };
+
+    static constexpr std::size_t minBlockSize = ArenaSpace::pageSize;
+    static constexpr std::size_t maxBlockSize = std::size_t(64) << 20;
+    static constexpr std::size_t commitSize = ArenaSpace::hugePageSize;
+
+    /// @brief Creates an arena whose first block or reserved range has the
+    /// given size
+    explicit Arena(std::size_t bytes,
+                   ArenaBackend backend = ArenaBackend::Blocks)
+        : backend(backend),
+          nextSize(backend == ArenaBackend::Blocks
+                       ? alignUp(std::clamp(bytes, minBlockSize,
+                                            maxBlockSize),
+                                 minBlockSize)
+                       : maxBlockSize),
+          pendingRange(backend == ArenaBackend::Blocks
+                           ? 0
+                           : alignUp(std::max(bytes, commitSize),
+                                     commitSize)),
+          numAllocations(0), numRequested(0), numTailBytes(0),
+          numRolledBack(0), peakCommitted(0), peakRequested(0),
+          allocSize(0) {}
 
     Arena(const Arena &) = delete;
     Arena &operator=(const Arena &) = delete;
@@ -30,55 +104,271 @@ class Arena {
     Arena(Arena &&) = default;
     Arena &operator=(Arena &&) = default;
 
+    /// @brief Returns the size of the first block or of the reserved range
+    /// of an arena holding the AST of an input of the given size
+    /// @note The AST takes about four bytes per byte of source, so a module
+    /// that is not much larger than its estimate fits in a couple of blocks.
+    /// Reserving costs no memory, so ranges are twice as large, to fit the
+    /// AST in most cases.
+    [[nodiscard]] static std::size_t
+    getInitialSize(std::size_t inputSize,
+                   ArenaBackend backend = ArenaBackend::Blocks) {
+        if (backend == ArenaBackend::Blocks) {
+            return std::clamp(inputSize * 4, kiloBytes(32), maxBlockSize);
+        }
+        return std::clamp(inputSize * 8, commitSize, gigaBytes(1));
+    }
+
+    [[nodiscard]] ArenaBackend getBackend() const { return backend; }
+
     [[nodiscard]] std::size_t totalAllocations() const {
         return numAllocations;
     }
 
-    [[nodiscard]] std::size_t totalAllocated() const {
+    /// @brief Returns the number of accessible bytes of the blocks and
+    /// ranges of the arena
+    [[nodiscard]] std::size_t totalCommitted() const {
+        return sumBlocks([](const Block &b) { return b.size; });
+    }
+
+    /// @brief Returns the number of bytes of the blocks and ranges of the
+    /// arena, committed or not
+    [[nodiscard]] std::size_t totalReserved() const {
+        return sumBlocks(
+            [](const Block &b) { return b.data.get_deleter().size; });
+    }
+
+    /// @brief Returns the number of bytes requested by the allocations
+    [[nodiscard]] std::size_t totalRequested() const { return numRequested; }
+
+    /// @brief Returns the number of bytes that no allocation can use any
+    /// more, which are the padding between objects and the ends of the
+    /// blocks that were left for a new one
+    [[nodiscard]] std::size_t totalWasted() const {
         std::size_t total = allocSize;
-        for (const auto &block : used) {
-            total += block.size;
+        for (const auto &usedBlock : used) {
+            total += usedBlock.size;
         }
-        for (const auto &block : avail) {
-            total += block.size;
+        return total - numRequested;
+    }
+
+    /// @brief Returns the number of bytes requested by the allocations that
+    /// were rolled back
+    [[nodiscard]] std::size_t totalRolledBack() const { return numRolledBack; }
+
+    /// @brief Returns the number of bytes left unused at the end of the
+    /// blocks that were left for a new one
+    [[nodiscard]] std::size_t totalTailBytes() const { return numTailBytes; }
+
+    /// @brief Returns the number of bytes lost to aligning objects
+    [[nodiscard]] std::size_t totalPadding() const {
+        return totalWasted() - numTailBytes;
+    }
+
+    /// @brief Returns the largest number of accessible bytes that the arena
+    /// held at once
+    [[nodiscard]] std::size_t maxCommitted() const {
+        return std::max(peakCommitted, totalCommitted());
+    }
+
+    /// @brief Returns the largest number of bytes requested by the
+    /// allocations between two resets
+    [[nodiscard]] std::size_t maxRequested() const {
+        return std::max(peakRequested, numRequested);
+    }
+
+    /// @brief Starts recording the allocations per type, which the arenas
+    /// adopted afterwards add theirs to
+    void enableTypeStats() {
+        if (typeStats == nullptr) {
+            typeStats = std::make_unique<TypeStatsMap>();
         }
-        return total;
     }
 
-    void reset() {
-        allocSize = 0;
-        avail.splice(avail.begin(), used);
+    [[nodiscard]] bool hasTypeStats() const { return typeStats != nullptr; }
+
+    /// @brief Returns the allocations per type, by decreasing number of
+    /// bytes, or nothing if they are not recorded
+    [[nodiscard]] std::vector<ArenaTypeStats> getTypeStats() const;
+
+    /// @brief Takes over the blocks of another arena, so that the objects
+    /// allocated from it live as long as this arena
+    void adopt(Arena &&other);
+
+    void reset();
+
+    /// @brief Saves the state of the arena, to which rollback returns
+    /// @note A mark is invalidated by a rollback to an earlier mark, and by
+    /// reset and adopt.
+    [[nodiscard]] Mark mark() const {
+        Mark saved;
+        saved.numUsed = used.size();
+        saved.numRequested = numRequested;
+        saved.numTailBytes = numTailBytes;
+        saved.allocSize = allocSize;
+        saved.hasBlock = block.data != nullptr;
+        return saved;
     }
 
-    template <typename T> void dealloc(T *ptr) {
+    /// @brief Frees every object allocated since the given mark, which must
+    /// no longer be referred to
+    /// @note The allocations per type still count the objects rolled back.
+    void rollback(const Mark &saved) {
+        assert(saved.numUsed <= used.size() && "the mark is invalidated");
+        if (used.size() != saved.numUsed || !saved.hasBlock) {
+            rollbackBlocks(saved);
+        }
+        peakRequested = std::max(peakRequested, numRequested);
+        numRolledBack += numRequested - saved.numRequested;
+        numRequested = saved.numRequested;
+        numTailBytes = saved.numTailBytes;
+        allocSize = saved.allocSize;
+    }
+
+    template <typename T, typename... Args> T *alloc(Args &&...args) {
         static_assert(std::is_trivially_destructible_v<T>,
                       "T must be trivially destructible");
-        std::byte *start = block.data.get() + allocSize - sizeof(T);
-        assert(reinterpret_cast<T *>(start) == ptr);
-        allocSize -= sizeof(T);
+        ++numAllocations;
+        if (typeStats != nullptr) {
+            ArenaTypeStats &stats = getTypeStats<T>();
+            ++stats.count;
+            stats.bytes += sizeof(T);
+        }
+        return new (allocInternal(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
     }
 
-    template <typename T, typename... Args> T *alloc(Args &&...args) {
+    /// @brief Allocates uninitialized storage for the given number of
+    /// contiguous objects
+    template <typename T> T *allocArray(std::size_t count) {
         static_assert(std::is_trivially_destructible_v<T>,
                       "T must be trivially destructible");
+        return allocStorage<T>(count);
+    }
+
+    /// @brief Allocates uninitialized storage for the given number of
+    /// contiguous objects, which their owner destroys before the arena is
+    /// reset or destroyed
+    template <typename T> T *allocStorage(std::size_t count) {
         ++numAllocations;
-        return new (allocInternal(sizeof(T))) T(std::forward<Args>(args)...);
+        if (typeStats != nullptr) {
+            ArenaTypeStats &stats = getTypeStats<T[]>();
+            ++stats.count;
+            stats.bytes += count * sizeof(T);
+        }
+        return static_cast<T *>(allocInternal(count * sizeof(T), alignof(T)));
     }
 
   private:
+    /// @brief Returns a block or a reserved range to the ArenaSpace
+    struct BlockDeleter {
+        /// @brief Size of the block or of the whole range
+        std::size_t size;
+        bool range;
+        void operator()(std::byte *data) const {
+            if (range) {
+                ArenaSpace::releaseRange(data, size);
+            } else {
+                ArenaSpace::freeBlock(data, size);
+            }
+        }
+    };
+
+    /// @brief Block, or reserved range whose size is the committed part
     struct Block {
         std::size_t size = 0;
-        std::unique_ptr<std::byte[]> data = nullptr;
+        std::unique_ptr<std::byte[], BlockDeleter> data = nullptr;
+
+        [[nodiscard]] bool isRange() const {
+            return data != nullptr && data.get_deleter().range;
+        }
     };
 
-    std::size_t defaultSize;
+    /// @brief Number of size classes, the last of which holds the blocks of
+    /// maxBlockSize and more
+    static constexpr std::size_t numBins = 15;
+
+    /// @brief Allocations per type, indexed by the index of the type
+    using TypeStatsMap = std::vector<ArenaTypeStats>;
+
+    ArenaBackend backend;
+    std::size_t nextSize;
+    /// @brief Size of the range to reserve on the first allocation, or 0
+    std::size_t pendingRange;
     std::size_t numAllocations;
+    std::size_t numRequested;
+    std::size_t numTailBytes;
+    std::size_t numRolledBack;
+    std::size_t peakCommitted;
+    std::size_t peakRequested;
     std::size_t allocSize;
     Block block;
-    std::list<Block> used;
-    std::list<Block> avail;
+    std::vector<Block> used;
+    /// @brief Free blocks whose size is at least minBlockSize times two to the
+    /// power of their index
+    std::array<std::vector<Block>, numBins> bins;
+    /// @brief Reserved ranges decommitted by reset
+    std::vector<Block> ranges;
+    std::unique_ptr<TypeStatsMap> typeStats;
+
+    /// @brief Returns a new index for a type whose allocations are recorded
+    static std::size_t getNextTypeIndex();
+
+    template <typename T> ArenaTypeStats &getTypeStats() {
+        static const std::size_t index = getNextTypeIndex();
+        if (index >= typeStats->size()) {
+            typeStats->resize(index + 1);
+        }
+        ArenaTypeStats &stats = (*typeStats)[index];
+        if (stats.name.empty()) {
+            stats.name = llvm::getTypeName<T>();
+        }
+        return stats;
+    }
+
+    template <typename F> std::size_t sumBlocks(F getSize) const {
+        std::size_t total = block.data != nullptr ? getSize(block) : 0;
+        for (const auto &usedBlock : used) {
+            total += getSize(usedBlock);
+        }
+        for (const auto &bin : bins) {
+            for (const auto &freeBlock : bin) {
+                total += getSize(freeBlock);
+            }
+        }
+        for (const auto &range : ranges) {
+            total += getSize(range);
+        }
+        return total;
+    }
+
+    static constexpr std::size_t alignUp(std::size_t size, std::size_t align) {
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    void *allocInternal(std::size_t size, std::size_t align) {
+        const std::size_t start = alignUp(allocSize, align);
+        if (size > block.size - std::min(start, block.size)) {
+            return allocSlow(size, align);
+        }
+        numRequested += size;
+        allocSize = start + size;
+        return block.data.get() + start;
+    }
+
+    /// @brief Recycles the blocks taken since the given mark, and makes the
+    /// current block at the mark current again
+    void rollbackBlocks(const Mark &saved);
+
+    /// @brief Returns a block emptied by reset or rollback to the bins, or
+    /// a range to the ranges, whose committed pages are kept
+    void recycle(Block &&freed);
 
-    void *allocInternal(std::size_t bytes);
+    /// @brief Allocates from the next pages of the current range if it has
+    /// enough, and otherwise from a new range or block, which is taken from
+    /// the decommitted ranges or the bins if one fits, and from the
+    /// ArenaSpace otherwise
+    void *allocSlow(std::size_t size, std::size_t align);
 };
 
 } // namespace lang
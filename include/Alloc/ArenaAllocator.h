@@ -0,0 +1,58 @@
+#ifndef LANG_ARENA_ALLOCATOR_H
+#define LANG_ARENA_ALLOCATOR_H
+
+#include "Alloc/Arena.h"
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace lang {
+
+/// @brief Standard allocator that takes its memory from an arena
+/// @note Deallocating is a no-op, the memory is given back when the arena is
+/// reset or destroyed, which must not happen before the container is
+/// destroyed. Containers whose memory comes from a scratch arena reset
+/// between functions are thus rebuilt for every function.
+template <typename T> class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena) noexcept : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+        : arena(other.getArena()) {}
+
+    [[nodiscard]] T *allocate(std::size_t count) {
+        return arena->allocStorage<T>(count);
+    }
+
+    void deallocate(T *, std::size_t) noexcept {}
+
+    [[nodiscard]] Arena *getArena() const noexcept { return arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept {
+        return arena == other.getArena();
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const noexcept {
+        return arena != other.getArena();
+    }
+
+  private:
+    Arena *arena;
+};
+
+/// @brief Hash map whose buckets and nodes are allocated in an arena
+template <typename K, typename V, typename Hash = std::hash<K>>
+using ArenaUnorderedMap =
+    std::unordered_map<K, V, Hash, std::equal_to<K>,
+                       ArenaAllocator<std::pair<const K, V>>>;
+
+} // namespace lang
+
+#endif // LANG_ARENA_ALLOCATOR_H
@@ -0,0 +1,72 @@
+#ifndef LANG_ARENA_GROUP_H
+#define LANG_ARENA_GROUP_H
+
+#include "Alloc/Arena.h"
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace lang {
+
+/// @brief Arenas of the workers of a parallel phase, whose blocks are handed
+/// over to a parent arena at the end of the phase
+/// @note Every worker allocates from an arena of its own, which only takes
+/// a lock of the ArenaSpace when it needs a new block. A worker arena must
+/// only be used by one thread at a time.
+/// Merging moves the blocks of the workers into the parent without copying
+/// anything, so every object keeps its address, and the statistics of the
+/// parent become those of a single arena that made the allocations of the
+/// workers after its own. The workers record the allocations per type if
+/// the parent does, and may go on allocating after a merge, for the next
+/// phase. The group merges on destruction, so that no object of a worker
+/// is freed before the parent.
+class ArenaGroup {
+  public:
+    /// @brief Creates the arenas of the given number of workers, whose first
+    /// blocks have the given size
+    ArenaGroup(Arena &parent, std::size_t numWorkers,
+               std::size_t bytes = kiloBytes(32))
+        : parent(&parent) {
+        workers.reserve(numWorkers);
+        for (std::size_t i = 0; i < numWorkers; ++i) {
+            workers.emplace_back(bytes);
+            if (parent.hasTypeStats()) {
+                workers.back().enableTypeStats();
+            }
+        }
+    }
+
+    ArenaGroup(const ArenaGroup &) = delete;
+    ArenaGroup &operator=(const ArenaGroup &) = delete;
+
+    ~ArenaGroup() { merge(); }
+
+    [[nodiscard]] std::size_t size() const { return workers.size(); }
+
+    [[nodiscard]] Arena &getParent() const { return *parent; }
+
+    /// @brief Returns the arena of the worker of the given index
+    [[nodiscard]] Arena &getWorker(std::size_t index) {
+        assert(index < workers.size() && "no such worker");
+        return workers[index];
+    }
+
+    /// @brief Hands the blocks of every worker over to the parent, in the
+    /// order of the workers
+    /// @note No worker may allocate while the group merges, and the marks
+    /// taken in the arenas of the workers are invalidated.
+    void merge() {
+        for (Arena &worker : workers) {
+            parent->adopt(std::move(worker));
+        }
+    }
+
+  private:
+    Arena *parent;
+    std::vector<Arena> workers;
+};
+
+} // namespace lang
+
+#endif // LANG_ARENA_GROUP_H
@@ -0,0 +1,65 @@
+#ifndef LANG_ARENA_REF_H
+#define LANG_ARENA_REF_H
+
+#include "Alloc/ArenaSpace.h"
+
+#include <cassert>
+#include <cstdint>
+
+namespace lang {
+
+/// @brief Reference to an object allocated in an arena, stored as its 32-bit
+/// offset in the ArenaSpace instead of a 64-bit pointer
+/// @note The reference converts to and from a pointer, so that it can stand
+/// for one in most expressions. It is trivially copyable and does not depend
+/// on its own address, so arrays of references can be copied with memcpy.
+template <typename T> class ArenaRef {
+  public:
+    ArenaRef() noexcept : offset(0) {}
+
+    // NOLINTNEXTLINE
+    ArenaRef(std::nullptr_t) noexcept : offset(0) {}
+
+    // NOLINTNEXTLINE
+    ArenaRef(T *ptr) noexcept : offset(toOffset(ptr)) {}
+
+    ArenaRef &operator=(T *ptr) noexcept {
+        offset = toOffset(ptr);
+        return *this;
+    }
+
+    [[nodiscard]] T *get() const noexcept {
+        return offset == 0 ? nullptr
+                           : reinterpret_cast<T *>(ArenaSpace::getBase() +
+                                                   offset);
+    }
+
+    // NOLINTNEXTLINE
+    operator T *() const noexcept { return get(); }
+
+    T *operator->() const noexcept {
+        assert(offset != 0 && "null reference");
+        return get();
+    }
+
+    T &operator*() const noexcept {
+        assert(offset != 0 && "null reference");
+        return *get();
+    }
+
+  private:
+    std::uint32_t offset;
+
+    static std::uint32_t toOffset(const T *ptr) noexcept {
+        if (ptr == nullptr) {
+            return 0;
+        }
+        assert(ArenaSpace::contains(ptr) && "object outside of the arenas");
+        return static_cast<std::uint32_t>(
+            reinterpret_cast<const std::byte *>(ptr) - ArenaSpace::getBase());
+    }
+};
+
+} // namespace lang
+
+#endif // LANG_ARENA_REF_H
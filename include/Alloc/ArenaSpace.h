@@ -0,0 +1,92 @@
+#ifndef LANG_ARENA_SPACE_H
+#define LANG_ARENA_SPACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace lang {
+
+/// @brief Thrown when the ArenaSpace has no room left for a block or a range
+class ArenaSpaceExhausted : public std::bad_alloc {
+  public:
+    [[nodiscard]] const char *what() const noexcept override {
+        return "the arenas ran out of their 4 GiB of address space";
+    }
+};
+
+/// @brief Range of virtual memory reserved once per process, from which every
+/// arena takes its blocks
+/// @note All arena objects thus lie within 4 GiB of the base of the space,
+/// which lets ArenaRef address any of them with a 32-bit offset. The first
+/// page is never handed out, so that offset 0 stands for null.
+/// Freed blocks and released ranges are decommitted and merged with the free
+/// space next to them, from which later blocks and ranges of any size are
+/// taken, so that the space only runs out when the live ones fill it.
+class ArenaSpace {
+  public:
+    static constexpr std::size_t reservedSize = std::size_t(1) << 32;
+    static constexpr std::size_t pageSize = 4096;
+    /// @brief Size of the transparent huge pages of the host
+    static constexpr std::size_t hugePageSize = std::size_t(2) << 20;
+
+    /// @brief Returns the base of the space, or null if no block has been
+    /// allocated yet
+    [[nodiscard]] static std::byte *getBase() { return base; }
+
+    /// @brief Returns whether the given address lies within the space
+    [[nodiscard]] static bool contains(const void *ptr) {
+        const auto *byte = static_cast<const std::byte *>(ptr);
+        return base != nullptr && byte >= base && byte < base + reservedSize;
+    }
+
+    /// @brief Returns a block of the given size, which must be a multiple of
+    /// pageSize, taken from the smallest free space that fits it if there is
+    /// one
+    /// @note Throws ArenaSpaceExhausted once the space is exhausted, and
+    /// std::bad_alloc if the pages cannot be made accessible
+    [[nodiscard]] static std::byte *allocBlock(std::size_t size);
+
+    /// @brief Returns a block obtained from allocBlock to the space, releasing
+    /// its memory
+    static void freeBlock(std::byte *data, std::size_t size);
+
+    /// @brief Returns a range of the given size, which must be a multiple of
+    /// hugePageSize, aligned to hugePageSize, whose pages are inaccessible
+    /// until they are committed
+    /// @note Throws ArenaSpaceExhausted once the space is exhausted
+    [[nodiscard]] static std::byte *reserveRange(std::size_t size);
+
+    /// @brief Makes the given pages of a reserved range accessible, asking for
+    /// transparent huge pages to back them if requested
+    /// @note Throws std::bad_alloc if the pages cannot be made accessible
+    static void commitRange(std::byte *data, std::size_t size,
+                            bool hugePages);
+
+    /// @brief Releases the memory of the given pages of a reserved range and
+    /// makes them inaccessible again
+    static void decommitRange(std::byte *data, std::size_t size);
+
+    /// @brief Returns a range obtained from reserveRange to the space
+    static void releaseRange(std::byte *data, std::size_t size);
+
+    /// @brief Maps the given range of a file privately at the given offset of
+    /// the space, so that the objects it holds can be referred to by the
+    /// offsets they were written with
+    /// @returns The mapped range, or null if a block or another file lies
+    /// within it
+    /// @note Throws std::bad_alloc if the mapping fails
+    [[nodiscard]] static std::byte *mapFile(std::size_t offset,
+                                            std::size_t size, int fd,
+                                            std::size_t fileOffset);
+
+    /// @brief Returns a range obtained from mapFile to the space
+    static void unmapFile(std::byte *data, std::size_t size);
+
+  private:
+    static inline std::byte *base = nullptr;
+};
+
+} // namespace lang
+
+#endif // LANG_ARENA_SPACE_H
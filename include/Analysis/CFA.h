@@ -36,45 +36,56 @@ struct CFAResult {
 
 class CFA : public MutableASTVisitor<CFA> {
     friend class ASTVisitor<CFA, false>;
+    friend class Sema;
 
   public:
     CFAResult analyzeModuleAST(ModuleAST &module);
 
   private:
+    /// @brief Position of the first break or return statement of a block
+    /// that is not its last statement, after which the block is unreachable
+    struct BlockCut {
+        std::size_t index;
+        StmtAST *stmt;
+    };
+
     std::stack<StmtAST *> breakableStack;
+    std::vector<BlockCut> blockCuts;
     std::vector<CFAError> errors;
+    /// @brief Source buffer of the module being analyzed
+    std::string_view source;
 
-    void visit(FunctionDeclAST &node);
-
-    void visit(ExprStmtAST &node) {}
-
-    void visit(BreakStmtAST &node);
+    using ASTVisitor::enter;
+    using ASTVisitor::enterChild;
+    using ASTVisitor::leave;
 
-    void visit(ReturnStmtAST &node) {}
+    // NOTE: Expressions contain no statements, so they are never entered
 
-    void visit(LocalStmtAST &node) {}
+    bool enter(ExprStmtAST &node) { return false; }
 
-    void visit(AssignStmtAST &node) {}
+    bool enter(BreakStmtAST &node);
 
-    void visit(BlockStmtAST &node);
+    bool enter(ReturnStmtAST &node) { return false; }
 
-    void visit(IfStmtAST &node);
+    bool enter(LocalStmtAST &node) { return false; }
 
-    void visit(WhileStmtAST &node);
+    bool enter(AssignStmtAST &node) { return false; }
 
-    void visit(IdentifierExprAST &node) {}
+    bool enter(BlockStmtAST &node);
 
-    void visit(NumberExprAST &node) {}
+    bool enterChild(BlockStmtAST &node, std::size_t index);
 
-    void visit(UnaryExprAST &node) {}
+    void leave(BlockStmtAST &node) { blockCuts.pop_back(); }
 
-    void visit(BinaryExprAST &node) {}
+    bool enterChild(IfStmtAST &node, std::size_t index) { return index != 0; }
 
-    void visit(CallExprAST &node) {}
+    bool enter(WhileStmtAST &node);
 
-    void visit(IndexExprAST &node) {}
+    bool enterChild(WhileStmtAST &node, std::size_t index) {
+        return index != 0;
+    }
 
-    void visit(GroupedExprAST &node) {}
+    void leave(WhileStmtAST &node) { breakableStack.pop(); }
 };
 
 } // namespace lang
@@ -5,8 +5,6 @@
 
 #include "AST/ASTVisitor.h"
 
-#include <unordered_map>
-
 namespace lang {
 
 enum class ResolveErrorKind {
@@ -36,49 +34,65 @@ struct ResolveResult {
 
 class Resolver : public MutableASTVisitor<Resolver> {
     friend class ASTVisitor<Resolver, false>;
+    friend class Sema;
 
   public:
     ResolveResult resolveModuleAST(ModuleAST &module);
 
   private:
-    bool deepResolution = false;
-    std::unordered_map<std::string_view, FunctionDeclAST *> functionsMap;
-    std::vector<std::unordered_map<std::string_view, LocalStmtAST *>> localsMap;
+    /// @brief Innermost local bound to a symbol and the depth of its scope
+    struct LocalBinding {
+        LocalStmtAST *local = nullptr;
+        std::size_t depth = 0;
+    };
+
+    /// @brief Binding of a symbol hidden by a local, restored at the end of
+    /// the local's scope
+    struct ShadowedBinding {
+        Symbol symbol;
+        LocalBinding binding;
+    };
+
+    // NOTE: Symbols are dense, so functions and locals are flat arrays indexed
+    // by symbol. Scopes only record which bindings they shadowed.
+
+    std::vector<FunctionDeclAST *> functions;
+    std::vector<LocalBinding> locals;
+    std::vector<ShadowedBinding> shadowed;
+    std::vector<std::size_t> scopes;
     std::vector<ResolveError> errors;
+    /// @brief Source buffer of the module being resolved
+    std::string_view source;
 
-    LocalStmtAST *lookupLocal(std::string_view ident) const;
-
-    void visit(FunctionDeclAST &node);
-
-    void visit(ExprStmtAST &node);
+    void pushScope() { scopes.push_back(shadowed.size()); }
 
-    void visit(BreakStmtAST &node) {}
+    void popScope();
 
-    void visit(ReturnStmtAST &node);
+    void bindLocal(LocalStmtAST &node);
 
-    void visit(LocalStmtAST &node);
+    LocalStmtAST *lookupLocal(Symbol symbol) const;
 
-    void visit(AssignStmtAST &node);
+    /// @brief Registers the functions of a module, before any body is
+    /// resolved
+    void declareFunctions(ModuleAST &module);
 
-    void visit(BlockStmtAST &node);
-
-    void visit(IfStmtAST &node);
-
-    void visit(WhileStmtAST &node);
+    /// @brief Registers a function
+    void visit(FunctionDeclAST &node);
 
-    void visit(IdentifierExprAST &node);
+    using ASTVisitor::enter;
+    using ASTVisitor::leave;
 
-    void visit(NumberExprAST &node) {}
+    bool enter(FunctionDeclAST &node);
 
-    void visit(UnaryExprAST &node);
+    void leave(FunctionDeclAST &node) { popScope(); }
 
-    void visit(BinaryExprAST &node);
+    bool enter(LocalStmtAST &node);
 
-    void visit(CallExprAST &node);
+    bool enter(BlockStmtAST &node);
 
-    void visit(IndexExprAST &node);
+    void leave(BlockStmtAST &node) { popScope(); }
 
-    void visit(GroupedExprAST &node);
+    bool enter(IdentifierExprAST &node);
 };
 
 } // namespace lang
@@ -0,0 +1,98 @@
+#ifndef LANG_SEMA_H
+#define LANG_SEMA_H
+
+#include "Analysis/CFA.h"
+#include "Analysis/Resolver.h"
+#include "Analysis/TypeChecker.h"
+
+namespace lang {
+
+struct SemaResult {
+    CFAResult cfa;
+    ResolveResult resolve;
+    TypeCheckerResult typeChecker;
+};
+
+/// @brief Runs the control flow analysis, the resolution and the type
+/// checking of a module in a single walk over every function
+/// @note The hooks of every node are forwarded to the hooks of the three
+/// passes, in that order, so each pass sees its nodes in the order of its own
+/// walk and reports the same errors in the same order. Where a pass would not
+/// have visited a subtree, its hooks are skipped for it.
+class Sema : public MutableASTVisitor<Sema> {
+    friend class ASTVisitor<Sema, false>;
+
+  public:
+    explicit Sema(TypeContext &typeCtx) : typeChecker(typeCtx) {}
+
+    SemaResult analyzeModuleAST(ModuleAST &module);
+
+  private:
+    /// @brief Subtree that a pass does not visit
+    struct Skip {
+        /// @brief Node whose children are skipped, or whose child being
+        /// visited is, or null if the pass visits the current node
+        const void *node = nullptr;
+        /// @brief Whether only the child being visited is skipped
+        bool child = false;
+    };
+
+    CFA cfa;
+    Resolver resolver;
+    TypeChecker typeChecker;
+    Skip cfaSkip;
+    Skip resolverSkip;
+    Skip typeCheckerSkip;
+
+    template <typename Pass, typename T>
+    static void enterPass(Pass &pass, Skip &skip, T &node) {
+        if (skip.node == nullptr && !pass.enter(node)) {
+            skip = {&node, false};
+        }
+    }
+
+    template <typename Pass, typename T>
+    static void enterChildPass(Pass &pass, Skip &skip, T &node,
+                               std::size_t index) {
+        if (skip.node == &node && skip.child) {
+            skip.node = nullptr;
+        }
+        if (skip.node == nullptr && !pass.enterChild(node, index)) {
+            skip = {&node, true};
+        }
+    }
+
+    template <typename Pass, typename T>
+    static void leavePass(Pass &pass, Skip &skip, T &node) {
+        if (skip.node == &node) {
+            skip.node = nullptr;
+        }
+        if (skip.node == nullptr) {
+            pass.leave(node);
+        }
+    }
+
+    template <typename T> bool enter(T &node) {
+        enterPass(cfa, cfaSkip, node);
+        enterPass(resolver, resolverSkip, node);
+        enterPass(typeChecker, typeCheckerSkip, node);
+        return true;
+    }
+
+    template <typename T> bool enterChild(T &node, std::size_t index) {
+        enterChildPass(cfa, cfaSkip, node, index);
+        enterChildPass(resolver, resolverSkip, node, index);
+        enterChildPass(typeChecker, typeCheckerSkip, node, index);
+        return true;
+    }
+
+    template <typename T> void leave(T &node) {
+        leavePass(cfa, cfaSkip, node);
+        leavePass(resolver, resolverSkip, node);
+        leavePass(typeChecker, typeCheckerSkip, node);
+    }
+};
+
+} // namespace lang
+
+#endif // LANG_SEMA_H
@@ -5,6 +5,7 @@
 
 #include "AST/AST.h"
 #include "AST/ASTVisitor.h"
+#include "AST/FlatAST.h"
 
 #include "Typing/TypeContext.h"
 
@@ -41,6 +42,7 @@ struct TypeCheckerResult {
 
 class TypeChecker : public MutableASTVisitor<TypeChecker> {
     friend class ASTVisitor<TypeChecker, false>;
+    friend class Sema;
 
   public:
     TypeChecker(TypeContext &typeCtx)
@@ -49,43 +51,56 @@ class TypeChecker : public MutableASTVisitor<TypeChecker> {
 
     TypeCheckerResult analyzeModuleAST(ModuleAST &module);
 
+    /// @brief Checks the lowered function bodies of a resolved module in a
+    /// single forward loop over their nodes, and stores the types back into
+    /// the AST they were lowered from
+    TypeCheckerResult analyzeFlatAST(FlatAST &flat);
+
   private:
     TypeContext *typeCtx;
     Arena *arena;
     FunctionDeclAST *currentFunction;
     std::vector<TypeCheckerError> errors;
+    /// @brief Source buffer of the module being checked
+    std::string_view source;
 
-    void visit(FunctionDeclAST &node);
-
-    void visit(ExprStmtAST &node);
+    /// @brief Returns the type of the given function, which is made on the
+    /// first reference to the function and cached in its declaration, or
+    /// null if a parameter of the function has no type
+    [[nodiscard]] Type *getFunctionType(FunctionDeclAST &decl);
 
-    void visit(BreakStmtAST &node) {}
+    using ASTVisitor::enter;
+    using ASTVisitor::enterChild;
+    using ASTVisitor::leave;
 
-    void visit(ReturnStmtAST &node);
+    // NOTE: Nodes are typed once their children are, on leave
 
-    void visit(LocalStmtAST &node);
+    bool enter(FunctionDeclAST &node);
 
-    void visit(AssignStmtAST &node);
+    /// @brief Only visits the body, the parameters are typed by annotation
+    bool enterChild(FunctionDeclAST &node, std::size_t index) {
+        return index == node.params.size();
+    }
 
-    void visit(BlockStmtAST &node);
+    void leave(ReturnStmtAST &node);
 
-    void visit(IfStmtAST &node);
+    void leave(LocalStmtAST &node);
 
-    void visit(WhileStmtAST &node);
+    void leave(AssignStmtAST &node);
 
-    void visit(IdentifierExprAST &node);
+    void leave(IdentifierExprAST &node);
 
-    void visit(NumberExprAST &node);
+    void leave(NumberExprAST &node);
 
-    void visit(UnaryExprAST &node);
+    void leave(UnaryExprAST &node);
 
-    void visit(BinaryExprAST &node);
+    void leave(BinaryExprAST &node);
 
-    void visit(CallExprAST &node);
+    void leave(CallExprAST &node);
 
-    void visit(IndexExprAST &node);
+    void leave(IndexExprAST &node);
 
-    void visit(GroupedExprAST &node);
+    void leave(GroupedExprAST &node);
 };
 
 } // namespace lang
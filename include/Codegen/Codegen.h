@@ -3,10 +3,15 @@
 
 #include "AST/AST.h"
 #include "AST/ASTVisitor.h"
+#include "Alloc/ArenaAllocator.h"
 
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 
+#include <array>
+#include <optional>
+#include <vector>
+
 namespace lang {
 
 class Codegen : public ConstASTVisitor<Codegen> {
@@ -14,52 +19,93 @@ class Codegen : public ConstASTVisitor<Codegen> {
 
   public:
     Codegen()
-        : deepCodegen(false), context(std::make_unique<llvm::LLVMContext>()),
-          builder(std::make_unique<llvm::IRBuilder<>>(*context)) {}
+        : context(std::make_unique<llvm::LLVMContext>()),
+          builder(std::make_unique<llvm::IRBuilder<>>(*context)),
+          functionTable(FunctionMap::allocator_type(moduleArena)) {}
 
     llvm::Module *generateModule(const ModuleAST &module);
 
   private:
-    bool deepCodegen = false;
+    using FunctionMap =
+        ArenaUnorderedMap<const FunctionDeclAST *, llvm::Function *>;
+    using BreakMap = ArenaUnorderedMap<const StmtAST *, llvm::BasicBlock *>;
+    using LocalMap =
+        ArenaUnorderedMap<const LocalStmtAST *, llvm::AllocaInst *>;
+
     llvm::Value *exprResult = nullptr;
+    /// @brief Left operands of the binary expressions being generated
+    std::vector<llvm::Value *> lhsStack;
+    /// @brief Then, else and merge blocks of the ifs being generated, or
+    /// cond, body and after blocks of the whiles, innermost last
+    std::vector<std::array<llvm::BasicBlock *, 3>> blockStack;
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::IRBuilder<>> builder;
     std::unique_ptr<llvm::Module> llvmModule = nullptr;
-    std::unordered_map<const StmtAST *, llvm::BasicBlock *> breakTargets;
-    std::unordered_map<const LocalStmtAST *, llvm::AllocaInst *> namedValues;
-    std::unordered_map<const FunctionDeclAST *, llvm::Function *> functionTable;
-
+    /// @brief Arena of the tables of the module
+    Arena moduleArena{kiloBytes(32)};
+    /// @brief Arena of the tables of the function being generated, which is
+    /// reset after every function
+    Arena scratch{kiloBytes(32)};
+    std::optional<BreakMap> breakTargets;
+    std::optional<LocalMap> namedValues;
+    FunctionMap functionTable;
+    /// @brief Function of the first declaration of every symbol, which is the
+    /// one calls resolve to
+    std::vector<llvm::Function *> symbolFunctions;
+    /// @brief Source buffer of the module being generated
+    std::string_view source;
+
+    /// @brief Declares a function, before any body is generated
     void visit(const FunctionDeclAST &node);
 
-    void visit(const ExprStmtAST &node);
+    using ASTVisitor::enter;
+    using ASTVisitor::enterChild;
+    using ASTVisitor::leave;
+
+    bool enter(const FunctionDeclAST &node);
+
+    bool enterChild(const FunctionDeclAST &node, std::size_t index) {
+        return index == node.params.size();
+    }
+
+    void leave(const FunctionDeclAST &node);
+
+    bool enter(const BreakStmtAST &node);
+
+    void leave(const ReturnStmtAST &node);
+
+    // TODO: Generate locals, assignments, unary and index expressions
+
+    bool enter(const LocalStmtAST &node) { return false; }
 
-    void visit(const BreakStmtAST &node);
+    bool enter(const AssignStmtAST &node) { return false; }
 
-    void visit(const ReturnStmtAST &node);
+    bool enter(const IfStmtAST &node);
 
-    void visit(const LocalStmtAST &node);
+    bool enterChild(const IfStmtAST &node, std::size_t index);
 
-    void visit(const AssignStmtAST &node);
+    void leave(const IfStmtAST &node);
 
-    void visit(const BlockStmtAST &node);
+    bool enter(const WhileStmtAST &node);
 
-    void visit(const IfStmtAST &node);
+    bool enterChild(const WhileStmtAST &node, std::size_t index);
 
-    void visit(const WhileStmtAST &node);
+    void leave(const WhileStmtAST &node);
 
-    void visit(const IdentifierExprAST &node);
+    void leave(const IdentifierExprAST &node);
 
-    void visit(const NumberExprAST &node);
+    void leave(const NumberExprAST &node);
 
-    void visit(const UnaryExprAST &node);
+    bool enter(const UnaryExprAST &node) { return false; }
 
-    void visit(const BinaryExprAST &node);
+    bool enter(const IndexExprAST &node) { return false; }
 
-    void visit(const CallExprAST &node);
+    bool enterChild(const BinaryExprAST &node, std::size_t index);
 
-    void visit(const IndexExprAST &node);
+    void leave(const BinaryExprAST &node);
 
-    void visit(const GroupedExprAST &node);
+    /// @brief Generates the call, the callee and arguments are never visited
+    bool enter(const CallExprAST &node);
 };
 
 } // namespace lang
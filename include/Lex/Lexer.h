@@ -3,8 +3,13 @@
 
 #include "Support/Reporting.h"
 
+#include "Scanner.h"
 #include "Token.h"
+#include "TokenBuffer.h"
 
+#include <array>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace lang {
@@ -26,25 +31,110 @@ struct LexError {
 };
 
 struct LexResult {
-    std::vector<Token> tokens;
+    TokenBuffer tokens;
     std::vector<LexError> errors;
 
-    LexResult() = default;
+    explicit LexResult(std::string_view buffer) : tokens(buffer) {}
 
     [[nodiscard]] bool hasErrors() const { return !errors.empty(); }
 };
 
+/// @brief Replacement of removedLength bytes at offset by insertedText
+struct TextEdit {
+    std::size_t offset;
+    std::size_t removedLength;
+    std::string_view insertedText;
+};
+
+/// @brief Applies edits sorted by offset, which must not overlap and are
+/// relative to the original buffer, and returns the edited buffer
+std::string applyTextEdits(std::string_view buffer,
+                           const std::vector<TextEdit> &edits);
+
+/// @brief Decodes the value of a number literal, rounding it to the nearest
+/// double
+/// @note Literals too large for a double decode to infinity.
+double decodeNumber(std::string_view span);
+
+/// @brief Pull-based lexer
+/// @note Tokens are lexed on demand into a small ring buffer, so consumers
+/// that only need a bounded lookahead never materialize the whole token
+/// stream. Errors are accumulated as the buffer is lexed. Identifiers are
+/// interned into the given symbol table as they are lexed.
 class Lexer {
   public:
-    explicit Lexer(std::string_view buffer) : idx(0), buffer(buffer) {}
+    /// @brief Maximum number of tokens that can be looked ahead with peek
+    static constexpr std::size_t maxLookahead = 4;
+
+    /// @param padded Whether the buffer is followed by at least scanPadding
+    /// readable bytes, the first of which is NUL, which lets the lexer drop
+    /// the bounds checks from its scanning loops
+    Lexer(SymbolTable &symbols, std::string_view buffer,
+          ScanISA isa = getHostScanISA(), bool padded = false)
+        : Lexer(symbols, buffer, 0, isa, padded) {}
+
+    /// @brief Returns the n-th token after the current position without
+    /// consuming it, or nullptr if the buffer ends before it
+    /// @note The pointer is invalidated by the next call to next()
+    const Token *peek(std::size_t n = 0);
+
+    /// @brief Consumes and returns the token at the current position, or
+    /// std::nullopt if the buffer has been exhausted
+    std::optional<Token> next();
+
+    [[nodiscard]] std::string_view getBuffer() const { return buffer; }
 
+    [[nodiscard]] const std::vector<LexError> &getErrors() const {
+        return errors;
+    }
+
+    [[nodiscard]] bool hasErrors() const { return !errors.empty(); }
+
+    /// @brief Lexes the remaining tokens of the buffer into a TokenBuffer
     LexResult lexAll(bool includeComments = false);
 
+    /// @brief Lexes the remaining tokens of the buffer into a TokenBuffer
+    /// using up to numThreads threads
+    /// @note The buffer is split into chunks just after newlines. No token,
+    /// comments included, spans a newline, so every chunk starts at a token
+    /// boundary and concatenating the chunks' results in order yields exactly
+    /// the result of lexAll. Every chunk interns into a table of its own, and
+    /// the tables are merged in order once all chunks are lexed.
+    LexResult lexAllParallel(unsigned numThreads,
+                             bool includeComments = false);
+
+    /// @brief Lexes the buffer, which must result from applying the given
+    /// edits to the buffer of a previous result, by updating that result
+    /// @note Edits follow the requirements of applyTextEdits. Lexing restarts
+    /// at the end of the last token before each edit and stops as soon as a
+    /// token past the edit starts where a previous token started, from which
+    /// point the previous tokens are reused with their offsets shifted. The
+    /// previous result must have been lexed with the same includeComments.
+    LexResult relex(LexResult previous,
+                    const std::vector<TextEdit> &edits,
+                    bool includeComments = false);
+
   private:
     size_t idx;
     std::string_view buffer;
+    SymbolTable *symbols;
+    ScanISA isa;
+    bool padded;
+    const Scanner *scanner;
+    bool includeComments;
+    std::size_t head;
+    std::size_t count;
+    std::array<Token, maxLookahead> ring;
+    std::vector<LexError> errors;
+
+    Lexer(SymbolTable &symbols, std::string_view buffer, std::size_t idx,
+          ScanISA isa, bool padded)
+        : idx(idx), buffer(buffer), symbols(&symbols), isa(isa),
+          padded(padded),
+          scanner(&Scanner::get(isa, padded)), includeComments(false),
+          head(0), count(0) {}
 
-    Token lexAlt(char c, TokenKind altKind, TokenKind defaultKind);
+    bool lexToken(Token &token);
 };
 
 } // namespace lang
@@ -0,0 +1,97 @@
+#ifndef LANG_SCANNER_H
+#define LANG_SCANNER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace lang {
+
+/// @brief Character classes used by the lexer to dispatch on the first
+/// character of a token
+enum class CharClass : std::uint8_t {
+    Other,
+    White,
+    Alpha,
+    Digit,
+};
+
+constexpr std::array<CharClass, 256> makeCharClassTable() {
+    std::array<CharClass, 256> table{};
+    for (unsigned c = 'a'; c <= 'z'; ++c) {
+        table[c] = CharClass::Alpha;
+    }
+    for (unsigned c = 'A'; c <= 'Z'; ++c) {
+        table[c] = CharClass::Alpha;
+    }
+    for (unsigned c = '0'; c <= '9'; ++c) {
+        table[c] = CharClass::Digit;
+    }
+    table[' '] = CharClass::White;
+    table['\t'] = CharClass::White;
+    table['\n'] = CharClass::White;
+    table['\r'] = CharClass::White;
+    return table;
+}
+
+inline constexpr std::array<CharClass, 256> charClassTable =
+    makeCharClassTable();
+
+constexpr CharClass getCharClass(char c) {
+    return charClassTable[static_cast<unsigned char>(c)];
+}
+
+constexpr bool isWhite(char c) { return getCharClass(c) == CharClass::White; }
+
+constexpr bool isAlpha(char c) { return getCharClass(c) == CharClass::Alpha; }
+
+constexpr bool isDigit(char c) { return getCharClass(c) == CharClass::Digit; }
+
+constexpr bool isAlnum(char c) {
+    const CharClass cls = getCharClass(c);
+    return cls == CharClass::Alpha || cls == CharClass::Digit;
+}
+
+/// @brief Instruction set used by the bulk character scanning routines
+enum class ScanISA {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// @brief Returns the best instruction set supported by the host CPU
+ScanISA getHostScanISA();
+
+/// @brief Returns the given instruction set, or the best one supported by the
+/// host CPU if the given one is not available
+ScanISA clampScanISA(ScanISA isa);
+
+/// @brief Number of readable bytes, the first of which must be NUL, that a
+/// padded buffer must have past its end
+constexpr std::size_t scanPadding = 32;
+
+/// @brief Bulk character scanning routines used by the lexer
+/// @note Every routine takes the buffer, a start index and the buffer size and
+/// returns the index of the first character at or after the start index that
+/// does not satisfy the routine's predicate, or the buffer size if there is
+/// none. Bounded routines never read at or past the buffer size. Padded
+/// routines ignore the buffer size and rely on the NUL sentinel of a padded
+/// buffer to stop, which removes the bounds check from their inner loops.
+struct Scanner {
+    using ScanFn = std::size_t (*)(const char *, std::size_t, std::size_t);
+
+    /// @brief Skips ' ', '\t', '\n' and '\r'
+    ScanFn skipWhite;
+    /// @brief Skips [a-zA-Z0-9]
+    ScanFn skipAlnum;
+    /// @brief Skips [0-9]
+    ScanFn skipDigits;
+    /// @brief Skips everything but '\n' and '\0'
+    ScanFn skipLine;
+
+    static const Scanner &get(ScanISA isa, bool padded = false);
+};
+
+} // namespace lang
+
+#endif // LANG_SCANNER_H
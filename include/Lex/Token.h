@@ -1,10 +1,16 @@
 #ifndef LANG_TOKEN_H
 #define LANG_TOKEN_H
 
+#include "Support/SymbolTable.h"
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
 #include <string_view>
 
 namespace lang {
 
+/// @note Kinds range from Comment to RBrace, see tokenKindIndex.
 enum class TokenKind : int {
     Bang = '!',
     Amp = '&',
@@ -53,12 +59,54 @@ enum class TokenKind : int {
 
 std::string tokenKindToString(TokenKind kind);
 
+/// @brief Maps a token kind to a dense index below numTokenKinds, so tables
+/// over token kinds can be plain arrays
+constexpr std::size_t tokenKindIndex(TokenKind kind) {
+    return static_cast<std::size_t>(static_cast<int>(kind) -
+                                    static_cast<int>(TokenKind::Comment));
+}
+
+constexpr std::size_t numTokenKinds = tokenKindIndex(TokenKind::RBrace) + 1;
+
+/// @brief Set of token kinds stored as a bitset, usable in constant
+/// expressions
+class TokenKindSet {
+  public:
+    constexpr TokenKindSet() = default;
+
+    constexpr TokenKindSet(std::initializer_list<TokenKind> kinds) {
+        for (const TokenKind kind : kinds) {
+            insert(kind);
+        }
+    }
+
+    constexpr void insert(TokenKind kind) {
+        const std::size_t idx = tokenKindIndex(kind);
+        words[idx / 64] |= std::uint64_t{1} << (idx % 64);
+    }
+
+    [[nodiscard]] constexpr bool contains(TokenKind kind) const {
+        const std::size_t idx = tokenKindIndex(kind);
+        return ((words[idx / 64] >> (idx % 64)) & 1) != 0;
+    }
+
+  private:
+    std::array<std::uint64_t, (numTokenKinds + 63) / 64> words{};
+};
+
 struct Token {
     TokenKind kind;
+    /// @brief Interned name of an identifier, invalid for other tokens
+    Symbol symbol;
     std::string_view span;
 
+    Token() : kind(TokenKind::Ident) {}
+
     Token(TokenKind kind, std::string_view span) : kind(kind), span(span) {}
 
+    Token(TokenKind kind, std::string_view span, Symbol symbol)
+        : kind(kind), symbol(symbol), span(span) {}
+
     std::string toString() const;
 };
 
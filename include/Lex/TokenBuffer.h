@@ -0,0 +1,171 @@
+#ifndef LANG_TOKEN_BUFFER_H
+#define LANG_TOKEN_BUFFER_H
+
+#include "Token.h"
+
+#include "Support/SourceSpan.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace lang {
+
+/// @brief Compact storage for a stream of tokens lexed from a single buffer
+/// @note Tokens are stored as parallel arrays of kinds, symbols, and offsets
+/// and lengths into the source buffer, which takes 13 bytes per token instead
+/// of the 24 bytes of a Token. Spans are reconstructed on demand.
+class TokenBuffer {
+  public:
+    /// @throws std::length_error if the buffer is larger than maxSourceSize
+    explicit TokenBuffer(std::string_view buffer) : buffer(buffer) {
+        checkSize(buffer);
+    }
+
+    [[nodiscard]] std::string_view getBuffer() const { return buffer; }
+
+    [[nodiscard]] bool empty() const { return kinds.empty(); }
+
+    [[nodiscard]] std::size_t size() const { return kinds.size(); }
+
+    [[nodiscard]] TokenKind getKind(std::size_t idx) const {
+        return static_cast<TokenKind>(static_cast<std::int8_t>(kinds[idx]));
+    }
+
+    [[nodiscard]] Symbol getSymbol(std::size_t idx) const {
+        return symbols[idx];
+    }
+
+    [[nodiscard]] std::uint32_t getOffset(std::size_t idx) const {
+        return offsets[idx];
+    }
+
+    [[nodiscard]] std::uint32_t getLength(std::size_t idx) const {
+        return lengths[idx];
+    }
+
+    [[nodiscard]] std::string_view getSpan(std::size_t idx) const {
+        return buffer.substr(offsets[idx], lengths[idx]);
+    }
+
+    [[nodiscard]] Token operator[](std::size_t idx) const {
+        return {getKind(idx), getSpan(idx), getSymbol(idx)};
+    }
+
+    /// @brief Returns the number of bytes reserved for the tokens
+    [[nodiscard]] std::size_t getMemoryUsage() const {
+        return kinds.capacity() * sizeof(std::uint8_t) +
+               symbols.capacity() * sizeof(Symbol) +
+               offsets.capacity() * sizeof(std::uint32_t) +
+               lengths.capacity() * sizeof(std::uint32_t);
+    }
+
+    void reserve(std::size_t n) {
+        kinds.reserve(n);
+        symbols.reserve(n);
+        offsets.reserve(n);
+        lengths.reserve(n);
+    }
+
+    // NOLINTNEXTLINE
+    void push_back(const Token &token) {
+        assert(token.span.data() >= buffer.data() &&
+               token.span.data() + token.span.size() <=
+                   buffer.data() + buffer.size() &&
+               "token span outside of the buffer");
+        kinds.push_back(static_cast<std::uint8_t>(token.kind));
+        symbols.push_back(token.symbol);
+        offsets.push_back(
+            static_cast<std::uint32_t>(token.span.data() - buffer.data()));
+        lengths.push_back(static_cast<std::uint32_t>(token.span.size()));
+    }
+
+    /// @brief Appends the tokens of another buffer lexed from the same source
+    void append(const TokenBuffer &other) {
+        assert(other.buffer.data() == buffer.data() &&
+               "token buffers of different sources");
+        kinds.insert(kinds.end(), other.kinds.begin(), other.kinds.end());
+        symbols.insert(symbols.end(), other.symbols.begin(),
+                       other.symbols.end());
+        offsets.insert(offsets.end(), other.offsets.begin(),
+                       other.offsets.end());
+        lengths.insert(lengths.end(), other.lengths.begin(),
+                       other.lengths.end());
+    }
+
+    /// @brief Replaces the tokens [begin, end) by the tokens of another
+    /// buffer and moves the offsets of the tokens after them by shift bytes
+    /// @note Used to update the tokens of an edited source in place, where
+    /// only the tokens around the edits are lexed again and the text after
+    /// them has only moved.
+    void splice(std::size_t begin, std::size_t end, const TokenBuffer &other,
+                std::ptrdiff_t shift) {
+        assert(begin <= end && end <= size() && "invalid token range");
+        spliceVector(kinds, begin, end, other.kinds);
+        spliceVector(symbols, begin, end, other.symbols);
+        spliceVector(offsets, begin, end, other.offsets);
+        spliceVector(lengths, begin, end, other.lengths);
+        for (std::size_t i = begin + other.size(); i != offsets.size(); ++i) {
+            offsets[i] = static_cast<std::uint32_t>(
+                static_cast<std::ptrdiff_t>(offsets[i]) + shift);
+        }
+    }
+
+    /// @brief Replaces the source buffer the offsets refer to
+    /// @throws std::length_error if the buffer is larger than maxSourceSize
+    void setBuffer(std::string_view buffer) {
+        checkSize(buffer);
+        this->buffer = buffer;
+    }
+
+    /// @brief Replaces every valid symbol s by remap[s], which moves the
+    /// tokens to another symbol table
+    void remapSymbols(const std::vector<Symbol> &remap) {
+        for (Symbol &symbol : symbols) {
+            if (symbol.isValid()) {
+                symbol = remap[symbol.getId()];
+            }
+        }
+    }
+
+    void clear() {
+        kinds.clear();
+        symbols.clear();
+        offsets.clear();
+        lengths.clear();
+    }
+
+  private:
+    std::string_view buffer;
+    std::vector<std::uint8_t> kinds;
+    std::vector<Symbol> symbols;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+
+    static void checkSize(std::string_view buffer) {
+        if (buffer.size() > maxSourceSize) {
+            throw std::length_error("input larger than the 4 GiB that token "
+                                    "offsets can address");
+        }
+    }
+
+    template <typename T>
+    static void spliceVector(std::vector<T> &vector, std::size_t begin,
+                             std::size_t end, const std::vector<T> &other) {
+        const std::size_t removed = end - begin;
+        if (other.size() > removed) {
+            vector.insert(vector.begin() + end, other.size() - removed, T());
+        } else if (other.size() < removed) {
+            vector.erase(vector.begin() + begin + other.size(),
+                         vector.begin() + end);
+        }
+        std::copy(other.begin(), other.end(), vector.begin() + begin);
+    }
+};
+
+} // namespace lang
+
+#endif // LANG_TOKEN_BUFFER_H
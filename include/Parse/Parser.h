@@ -5,13 +5,16 @@
 
 #include "Support/Reporting.h"
 
-#include "Lex/Token.h"
+#include "Lex/Lexer.h"
 
 #include "AST/AST.h"
 
 #include "Typing/TypeContext.h"
 
-#include <unordered_set>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <utility>
 
 namespace lang {
 
@@ -25,7 +28,11 @@ enum class ParseErrorKind {
 struct ParseError {
     ParseErrorKind kind;
     std::string_view span;
-    TokenKind expected;
+    /// @brief The token that was expected, if a single one was
+    std::optional<TokenKind> expected;
+
+    ParseError(ParseErrorKind kind, std::string_view span)
+        : kind(kind), span(span) {}
 
     ParseError(ParseErrorKind kind, std::string_view span, TokenKind expected)
         : kind(kind), span(span), expected(expected) {}
@@ -45,43 +52,145 @@ struct ParseResult {
     [[nodiscard]] bool hasErrors() const { return !errors.empty(); }
 };
 
-class Parser {
+class Parser : public DeferredBodyParser {
   public:
-    Parser(Arena &arena, TypeContext &typeCtx, const std::vector<Token> &tokens)
-        : arena(&arena), typeCtx(&typeCtx), cur(tokens.begin()),
-          end(tokens.end()) {}
+    /// @brief Creates a parser that pulls its tokens from the given lexer
+    Parser(Arena &arena, TypeContext &typeCtx, Lexer &lexer)
+        : arena(&arena), typeCtx(&typeCtx), lexer(&lexer), tokens(nullptr),
+          buffer(lexer.getBuffer()), pos(0) {}
+
+    /// @brief Creates a parser that iterates over already lexed tokens
+    Parser(Arena &arena, TypeContext &typeCtx, const TokenBuffer &tokens)
+        : arena(&arena), typeCtx(&typeCtx), lexer(nullptr), tokens(&tokens),
+          buffer(tokens.getBuffer()), pos(0), end(tokens.size()) {}
 
     ParseResult parseModuleAST();
 
+    /// @brief Parses the module with the top-level functions split across
+    /// the given number of threads
+    /// @note The result is identical to the one of parseModuleAST. Only
+    /// parsers that iterate over already lexed tokens can parse in parallel.
+    ParseResult parseModuleASTParallel(unsigned numThreads);
+
+    /// @brief Defers the parsing of every function body to its first access
+    /// through FunctionDeclAST::getBody, and only matches its braces upfront
+    /// @note Only parsers that iterate over already lexed tokens can defer
+    /// bodies, and they must outlive the AST. The errors of deferred bodies
+    /// are collected apart, see takeDeferredErrors.
+    void setDeferBodies(bool defer) {
+        assert(tokens != nullptr && "deferred bodies need lexed tokens");
+        deferBodies = defer;
+    }
+
+    /// @brief Returns the errors of the deferred bodies parsed since the last
+    /// call
+    std::vector<ParseError> takeDeferredErrors() {
+        return std::exchange(deferredErrors, {});
+    }
+
+    BlockStmtAST *parseBody(const FunctionDeclAST &node) override;
+
   private:
     Arena *arena;
     TypeContext *typeCtx;
-    std::vector<Token>::const_iterator cur;
-    std::vector<Token>::const_iterator end;
+    Lexer *lexer;
+    const TokenBuffer *tokens;
+    /// @brief Buffer that the spans of the nodes are offsets into
+    std::string_view buffer;
+    std::size_t pos;
+    /// @brief End of the tokens to parse, when iterating over a TokenBuffer
+    std::size_t end = 0;
+    std::string_view prevSpan;
     std::vector<ParseError> errors;
-
-    const Token *peek();
-    const Token *next();
-    const Token *expect(TokenKind kind);
-    void sync(const std::unordered_set<TokenKind> &syncSet);
+    bool deferBodies = false;
+    std::vector<ParseError> deferredErrors;
+
+    /// @brief Statement whose parsing waits for a nested block, in the
+    /// explicit stack of parseBlockStmtAST
+    struct StmtFrame {
+        enum class Kind : std::uint8_t {
+            Block,
+            If,
+            While,
+        };
+
+        Kind kind;
+        std::string_view span;
+        ExprAST *cond = nullptr;
+        /// @brief Then branch of an If, null until it is parsed
+        BlockStmtAST *thenStmt = nullptr;
+        /// @brief Position of the first statement of a Block in stmtScratch
+        std::size_t stmtsBegin = 0;
+        /// @brief State of the arena before the current statement of a
+        /// Block, to which it rolls back if the statement fails to parse
+        Arena::Mark stmtMark;
+
+        StmtFrame(Kind kind, std::string_view span, ExprAST *cond = nullptr)
+            : kind(kind), span(span), cond(cond) {}
+    };
+
+    /// @brief Expression whose parsing waits for an operand, in the explicit
+    /// stack of parseExprAST
+    struct ExprFrame {
+        enum class Kind : std::uint8_t {
+            Unary,
+            Grouped,
+            /// @brief Argument of a call, whose previous arguments are in
+            /// argScratch
+            Arg,
+            Index,
+            /// @brief Right operand of a binary operator
+            Rhs,
+        };
+
+        Kind kind;
+        BinOpKind op = BinOpKind::Add;
+        /// @brief Minimum precedence of the operators bound by the enclosing
+        /// operator-precedence loop, to resume it with
+        int prec;
+        std::string_view span;
+        ExprAST *lhs = nullptr;
+        /// @brief Position of the first argument of an Arg in argScratch
+        std::size_t argsBegin = 0;
+
+        ExprFrame(Kind kind, int prec, std::string_view span,
+                  ExprAST *lhs = nullptr)
+            : kind(kind), prec(prec), span(span), lhs(lhs) {}
+    };
+
+    // NOTE: The frames outlive a single parse to reuse their storage, so that
+    // deep nesting costs heap memory instead of native stack. So do the
+    // children of the pending blocks and calls, which are stacked in scratch
+    // vectors and copied into an ArenaArray once complete.
+    std::vector<StmtFrame> stmtFrames;
+    std::vector<ExprFrame> exprFrames;
+    std::vector<ArenaRef<StmtAST>> stmtScratch;
+    std::vector<ArenaRef<ExprAST>> argScratch;
+
+    std::optional<Token> peek(std::size_t n = 0);
+    std::optional<Token> next();
+    std::optional<Token> expect(TokenKind kind);
+    void sync(TokenKindSet syncSet);
+
+    [[nodiscard]] SourceSpan toSpan(std::string_view span) const {
+        return {buffer, span};
+    }
+
+    void parseDeclASTs(std::vector<ArenaRef<DeclAST>> &decls);
 
     FunctionDeclAST *parseFunctionDeclAST();
 
+    bool skipBlock();
+
     Type *parseTypeAnnotation();
 
     BlockStmtAST *parseBlockStmtAST();
 
     LocalStmtAST *parseLocalStmtAST(bool isConst);
 
-    IfStmtAST *parseIfStmtAST();
-
-    WhileStmtAST *parseWhileStmtAST();
-
     StmtAST *parseExprStmtOrAssignStmtAST();
 
-    ExprAST *parseExprAST(int prec = 0);
-
-    ExprAST *parsePrimaryExprAST();
+    ExprAST *parseExprAST();
 };
 
 } // namespace lang
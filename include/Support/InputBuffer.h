@@ -0,0 +1,58 @@
+#ifndef LANG_INPUT_BUFFER_H
+#define LANG_INPUT_BUFFER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorOr.h"
+
+#include <memory>
+#include <string_view>
+
+namespace lang {
+
+/// @brief Read-only contents of an input file followed by a NUL sentinel and
+/// zeroed padding
+/// @note Regular files are memory mapped without copying. Anything else, such
+/// as pipes or the standard input, is read into a padded heap buffer. Inputs
+/// larger than maxSourceSize fail with std::errc::file_too_large.
+class InputBuffer {
+  public:
+    /// @brief Number of readable bytes past the end of the contents, all of
+    /// them NUL
+    static constexpr std::size_t padding = 64;
+
+    /// @brief Opens the given file, or the standard input if it is "-"
+    static llvm::ErrorOr<InputBuffer> open(llvm::StringRef filename);
+
+    /// @brief Reads the given file descriptor until its end
+    static llvm::ErrorOr<InputBuffer> read(int fd);
+
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer &operator=(const InputBuffer &) = delete;
+
+    InputBuffer(InputBuffer &&other) noexcept;
+    InputBuffer &operator=(InputBuffer &&other) noexcept;
+
+    ~InputBuffer();
+
+    [[nodiscard]] std::string_view getBuffer() const { return {data, size}; }
+
+    [[nodiscard]] bool isMapped() const { return mapping != nullptr; }
+
+  private:
+    const char *data;
+    std::size_t size;
+    void *mapping;
+    std::size_t mappingSize;
+    std::unique_ptr<char[]> heap;
+
+    InputBuffer(const char *data, std::size_t size, void *mapping,
+                std::size_t mappingSize, std::unique_ptr<char[]> heap)
+        : data(data), size(size), mapping(mapping), mappingSize(mappingSize),
+          heap(std::move(heap)) {}
+
+    static llvm::ErrorOr<InputBuffer> map(int fd, std::size_t size);
+};
+
+} // namespace lang
+
+#endif // LANG_INPUT_BUFFER_H
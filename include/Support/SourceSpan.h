@@ -0,0 +1,39 @@
+#ifndef LANG_SOURCE_SPAN_H
+#define LANG_SOURCE_SPAN_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lang {
+
+/// @brief Size of the largest source buffer, whose offsets fit in 32 bits
+inline constexpr std::size_t maxSourceSize = UINT32_MAX;
+
+/// @brief Range of bytes of a source buffer, stored as an offset and a length
+/// into it, which takes 8 bytes instead of the 16 bytes of a std::string_view
+struct SourceSpan {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+
+    SourceSpan() = default;
+
+    /// @brief Returns the span of the given view into the given buffer
+    SourceSpan(std::string_view buffer, std::string_view span)
+        : offset(static_cast<std::uint32_t>(span.data() - buffer.data())),
+          length(static_cast<std::uint32_t>(span.size())) {
+        assert(span.data() >= buffer.data() &&
+               span.data() + span.size() <= buffer.data() + buffer.size() &&
+               "span outside of the buffer");
+    }
+
+    /// @brief Returns the text of the span in the given buffer
+    [[nodiscard]] std::string_view in(std::string_view buffer) const {
+        return buffer.substr(offset, length);
+    }
+};
+
+} // namespace lang
+
+#endif // LANG_SOURCE_SPAN_H
@@ -0,0 +1,100 @@
+#ifndef LANG_SYMBOL_TABLE_H
+#define LANG_SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace lang {
+
+/// @brief Dense identifier of a name interned in a SymbolTable
+/// @note Symbols are numbered from zero in interning order, so they can index
+/// flat arrays directly.
+class Symbol {
+  public:
+    constexpr Symbol() : id(invalidId) {}
+
+    constexpr explicit Symbol(std::uint32_t id) : id(id) {}
+
+    [[nodiscard]] constexpr std::uint32_t getId() const { return id; }
+
+    [[nodiscard]] constexpr bool isValid() const { return id != invalidId; }
+
+    friend constexpr bool operator==(Symbol lhs, Symbol rhs) {
+        return lhs.id == rhs.id;
+    }
+
+    friend constexpr bool operator!=(Symbol lhs, Symbol rhs) {
+        return lhs.id != rhs.id;
+    }
+
+  private:
+    static constexpr std::uint32_t invalidId = UINT32_MAX;
+
+    std::uint32_t id;
+};
+
+/// @brief Interns names into dense symbols
+/// @note Names are copied into storage owned by the table, so they outlive
+/// the buffers they were lexed from. Lookups use open addressing with linear
+/// probing over a power of two table of symbol ids, with the hash of every
+/// name cached to skip most string comparisons.
+class SymbolTable {
+  public:
+    SymbolTable() = default;
+
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable &operator=(SymbolTable &&) = default;
+
+    /// @brief Returns the symbol of the given name, interning it if needed
+    Symbol intern(std::string_view name);
+
+    /// @brief Interns the names of another table in the order they were
+    /// interned there
+    /// @returns The symbol in this table of every symbol of the other table
+    /// @note The other table's lookups are accounted as lookups in this table,
+    /// so merging the tables of chunks lexed in order yields the same symbols
+    /// and statistics as lexing the chunks with this table.
+    std::vector<Symbol> merge(const SymbolTable &other);
+
+    [[nodiscard]] std::string_view getName(Symbol symbol) const {
+        return names[symbol.getId()];
+    }
+
+    [[nodiscard]] std::size_t size() const { return names.size(); }
+
+    /// @brief Returns the number of calls to intern
+    [[nodiscard]] std::size_t getNumLookups() const { return numLookups; }
+
+    /// @brief Returns the number of calls to intern with a name that was
+    /// already interned
+    [[nodiscard]] std::size_t getNumHits() const { return numHits; }
+
+    /// @brief Returns the number of bytes reserved by the table
+    [[nodiscard]] std::size_t getMemoryUsage() const;
+
+  private:
+    static constexpr std::size_t blockSize = 16 * 1024;
+
+    std::vector<std::uint32_t> slots;
+    std::vector<std::string_view> names;
+    std::vector<std::uint32_t> hashes;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t blockUsed = 0;
+    std::size_t blockCapacity = 0;
+    std::size_t storageSize = 0;
+    std::size_t numLookups = 0;
+    std::size_t numHits = 0;
+
+    std::string_view store(std::string_view name);
+
+    void grow();
+};
+
+} // namespace lang
+
+#endif // LANG_SYMBOL_TABLE_H
@@ -3,6 +3,10 @@
 
 #include "ADT/NonOwningList.h"
 
+#include "llvm/ADT/Hashing.h"
+
+#include <cstddef>
+
 namespace lang {
 
 enum class TypeKind {
@@ -12,9 +16,14 @@ enum class TypeKind {
     Function,
 };
 
+/// @note Types are unique within their TypeContext, so the parts of a type
+/// are unique types too, and the structural hash of a type is combined from
+/// the hashes of its parts when it is made.
 struct Type {
     TypeKind kind;
-    explicit Type(TypeKind kind) : kind(kind) {}
+    /// @brief Structural hash of the type
+    std::size_t hash;
+    explicit Type(TypeKind kind) : kind(kind), hash(llvm::hash_value(kind)) {}
 
     std::string toString() const;
 
@@ -22,17 +31,32 @@ struct Type {
     template <typename T> const T *as() const {
         return static_cast<const T *>(this);
     }
+
+  protected:
+    Type(TypeKind kind, std::size_t hash) : kind(kind), hash(hash) {}
 };
 
 struct PointerType : public Type {
     Type *pointee;
-    PointerType(Type *pointee) : Type(TypeKind::Pointer), pointee(pointee) {}
+    PointerType(Type *pointee)
+        : Type(TypeKind::Pointer,
+               llvm::hash_combine(TypeKind::Pointer, pointee->hash)),
+          pointee(pointee) {}
 };
 
 struct FunctionType : public Type {
     NonOwningList<Type *> arrows;
     FunctionType(NonOwningList<Type *> arrows)
-        : Type(TypeKind::Function), arrows(arrows) {}
+        : Type(TypeKind::Function, hashArrows(arrows)), arrows(arrows) {}
+
+  private:
+    static std::size_t hashArrows(const NonOwningList<Type *> &arrows) {
+        llvm::hash_code hash = llvm::hash_value(TypeKind::Function);
+        for (const Type *arrow : arrows) {
+            hash = llvm::hash_combine(hash, arrow->hash);
+        }
+        return hash;
+    }
 };
 
 } // namespace lang
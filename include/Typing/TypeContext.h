@@ -1,7 +1,7 @@
 #ifndef LANG_TYPE_CONTEXT
 #define LANG_TYPE_CONTEXT
 
-#include "Alloc/Arena.h"
+#include "Alloc/ArenaAllocator.h"
 
 #include "Type.h"
 
@@ -10,57 +10,37 @@
 namespace lang {
 
 struct HashType {
-    std::size_t operator()(const Type *type) const {
-        switch (type->kind) {
-        case TypeKind::Void:
-            return 0;
-        case TypeKind::Number:
-            return 1;
-        case TypeKind::Pointer: {
-            const PointerType *ptrType = type->as<PointerType>();
-            return 2 * operator()(ptrType->pointee);
-        }
-        case TypeKind::Function: {
-            const FunctionType *fnType = type->as<FunctionType>();
-            std::size_t hash = 3;
-            for (const Type *param : fnType->arrows) {
-                hash = hash * 31 + operator()(param);
-            }
-            return hash;
-        }
-        }
-        return 0;
-    }
+    std::size_t operator()(const Type *type) const { return type->hash; }
 };
 
+/// @brief Compares types whose parts are unique, so that the parts are equal
+/// only if they are the same
 struct EqualType {
     bool operator()(const Type *lhs, const Type *rhs) const {
-        if (lhs->kind != rhs->kind) {
+        if (lhs->kind != rhs->kind || lhs->hash != rhs->hash) {
             return false;
         }
         switch (lhs->kind) {
         case TypeKind::Void:
         case TypeKind::Number:
             return true;
-        case TypeKind::Pointer: {
-            const PointerType *lhsPtr = lhs->as<PointerType>();
-            const PointerType *rhsPtr = rhs->as<PointerType>();
-            return operator()(lhsPtr->pointee, rhsPtr->pointee);
-        }
+        case TypeKind::Pointer:
+            return lhs->as<PointerType>()->pointee ==
+                   rhs->as<PointerType>()->pointee;
         case TypeKind::Function: {
             const FunctionType *lhsFn = lhs->as<FunctionType>();
             const FunctionType *rhsFn = rhs->as<FunctionType>();
-            if (lhsFn->arrows.size() != rhsFn->arrows.size()) {
-                return false;
-            }
             auto iterLhs = lhsFn->arrows.begin();
             auto iterRhs = rhsFn->arrows.begin();
-            for (; iterLhs != lhsFn->arrows.end(); ++iterLhs, ++iterRhs) {
-                if (!operator()(*iterLhs, *iterRhs)) {
+            for (; iterLhs != lhsFn->arrows.end() &&
+                   iterRhs != rhsFn->arrows.end();
+                 ++iterLhs, ++iterRhs) {
+                if (*iterLhs != *iterRhs) {
                     return false;
                 }
             }
-            return true;
+            return iterLhs == lhsFn->arrows.end() &&
+                   iterRhs == rhsFn->arrows.end();
         }
         }
         return false;
@@ -69,7 +49,9 @@ struct EqualType {
 
 class TypeContext {
   public:
-    explicit TypeContext(Arena &arena) : arena(&arena) {
+    explicit TypeContext(Arena &arena)
+        : arena(&arena),
+          typeSet(0, HashType(), EqualType(), ArenaAllocator<Type *>(arena)) {
         tyVoid = arena.alloc<Type>(TypeKind::Void);
         tyNumber = arena.alloc<Type>(TypeKind::Number);
     }
@@ -82,11 +64,25 @@ class TypeContext {
 
     std::size_t getNumTypes() const { return typeSet.size(); }
 
+    /// @brief Returns the unique type equal to a T made of the arguments,
+    /// whose parts must be unique types of this context
     template <typename T, typename... Args> Type *make(Args &&...args) {
-        auto [type, inserted] =
-            hashCons(arena->alloc<T>(std::forward<Args>(args)...));
-        if (!inserted) {
-            arena->dealloc(type);
+        return makeSince<T>(arena->mark(), std::forward<Args>(args)...);
+    }
+
+    /// @brief Returns the unique type equal to a T made of the arguments,
+    /// rolling the arena back to the given mark if it already exists
+    /// @note The mark is taken before allocating the parts of the type, such
+    /// as the arrows of a function type, which are freed along with it.
+    template <typename T, typename... Args>
+    Type *makeSince(const Arena::Mark &mark, Args &&...args) {
+        const std::size_t numTypes = typeSet.size();
+        T *fresh = arena->alloc<T>(std::forward<Args>(args)...);
+        auto [type, inserted] = hashCons(fresh);
+        // NOTE: The set allocates in the arena too, so the arena is only
+        // rolled back if no part of the type was inserted
+        if (!inserted && typeSet.size() == numTypes) {
+            arena->rollback(mark);
         }
         return type;
     }
@@ -95,7 +91,10 @@ class TypeContext {
     Arena *arena;
     Type *tyVoid;
     Type *tyNumber;
-    std::unordered_set<Type *, HashType, EqualType> typeSet;
+    /// @brief Unique types, whose buckets and nodes live in the arena along
+    /// with the types
+    std::unordered_set<Type *, HashType, EqualType, ArenaAllocator<Type *>>
+        typeSet;
 
     std::pair<Type *, bool> hashCons(Type *type) {
         switch (type->kind) {
@@ -103,21 +102,12 @@ class TypeContext {
             return {tyVoid, false};
         case TypeKind::Number:
             return {tyNumber, false};
-        case TypeKind::Pointer: {
-            PointerType *ptrType = type->as<PointerType>();
-            ptrType->pointee = hashCons(ptrType->pointee).first;
-            const auto [it, inserted] = typeSet.insert(type);
-            return {*it, inserted};
-        }
+        case TypeKind::Pointer:
         case TypeKind::Function:
-            FunctionType *fnType = type->as<FunctionType>();
-            for (Type *&param : fnType->arrows) {
-                param = hashCons(param).first;
-            }
-            const auto [it, inserted] = typeSet.insert(type);
-            return {*it, inserted};
+            break;
         }
-        return {nullptr, false};
+        const auto [it, inserted] = typeSet.insert(type);
+        return {*it, inserted};
     }
 };
 
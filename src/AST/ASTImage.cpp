@@ -0,0 +1,754 @@
+#include "AST/ASTImage.h"
+
+#include "llvm/Support/xxhash.h"
+
+#include <cassert>
+#include <cstddef>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using lang::ArenaSpace;
+
+constexpr char imageMagic[8] = {'L', 'A', 'N', 'G', 'A', 'S', 'T', '\0'};
+
+/// @brief Version of the format, bumped on every change to it
+constexpr std::uint32_t imageVersion = 5;
+
+/// @brief Fingerprint of the layout of the nodes, which changes with the
+/// compiler and the definitions of the nodes
+template <typename... Ts> constexpr std::uint32_t getLayout() {
+    std::uint32_t layout = 0;
+    for (const std::size_t size : {sizeof(Ts)..., alignof(Ts)...}) {
+        layout = layout * 31 + static_cast<std::uint32_t>(size);
+    }
+    return layout;
+}
+
+constexpr std::uint32_t imageLayout =
+    getLayout<lang::NumberExprAST, lang::IdentifierExprAST,
+              lang::UnaryExprAST, lang::BinaryExprAST, lang::CallExprAST,
+              lang::IndexExprAST, lang::GroupedExprAST, lang::ExprStmtAST,
+              lang::BreakStmtAST, lang::ReturnStmtAST, lang::LocalStmtAST,
+              lang::AssignStmtAST, lang::BlockStmtAST, lang::IfStmtAST,
+              lang::WhileStmtAST, lang::FunctionDeclAST>();
+
+/// @brief First page of an image, followed by the nodes and then by the
+/// tables in the order of their sizes
+struct ImageHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t layout;
+    std::uint64_t sourceSize;
+    std::uint64_t sourceHash;
+    /// @brief Hash of the header and the tables, which the loader checks
+    /// before it uses the tables
+    std::uint64_t checksum;
+    /// @brief Offset of the ArenaSpace that the nodes refer to each other
+    /// from
+    std::uint32_t base;
+    /// @brief Size of the nodes, a multiple of the page size
+    std::uint32_t nodesSize;
+    /// @brief Position of the array of declarations of the module
+    std::uint32_t decls;
+    std::uint32_t numDecls;
+    std::uint32_t identSize;
+    std::uint32_t numNodeRefs;
+    std::uint32_t numTypeRefs;
+    std::uint32_t numSymbolRefs;
+    std::uint32_t numTypeWords;
+    std::uint32_t numSymbols;
+    std::uint32_t namesSize;
+    /// @brief Hash of the nodes, which the loader checks unless the file of
+    /// the image still has the modification time below
+    std::uint64_t nodesHash;
+    /// @brief Time at which the image was written, in nanoseconds since the
+    /// epoch, which ASTWriter::stampFile makes the modification time of its
+    /// file
+    std::int64_t writeTime;
+};
+
+static_assert(sizeof(ImageHeader) <= ArenaSpace::pageSize);
+
+constexpr std::size_t alignUp(std::size_t size, std::size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+std::uint64_t hashSource(std::string_view source) {
+    return llvm::xxHash64(llvm::StringRef(source.data(), source.size()));
+}
+
+/// @brief Returns the checksum of the header of an image, whose tables are
+/// the given bytes
+std::uint64_t hashImage(const std::byte *image, llvm::StringRef tables) {
+    char header[sizeof(ImageHeader)];
+    std::memcpy(header, image, sizeof(header));
+    const std::uint64_t tablesHash = llvm::xxHash64(tables);
+    std::memcpy(header + offsetof(ImageHeader, checksum), &tablesHash,
+                sizeof(tablesHash));
+    return llvm::xxHash64(llvm::StringRef(header, sizeof(header)));
+}
+
+/// @brief Returns the given time in nanoseconds since the epoch
+std::int64_t toNanoSeconds(const timespec &time) {
+    return static_cast<std::int64_t>(time.tv_sec) * 1000000000 +
+           time.tv_nsec;
+}
+
+template <typename T> void append(std::string &out, const std::vector<T> &v) {
+    out.append(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+}
+
+llvm::Error makeError(const char *message) {
+    return llvm::createStringError(std::errc::invalid_argument, message);
+}
+
+/// @brief Reads the tables of an image in order, checking their bounds
+class TableReader {
+  public:
+    TableReader(const std::byte *data, std::size_t size)
+        : data(data), size(size), pos(0) {}
+
+    /// @brief Returns the next table of the given number of elements, or null
+    /// past the end of the image
+    template <typename T> const T *read(std::size_t count) {
+        const std::size_t bytes = count * sizeof(T);
+        if (count > size / sizeof(T) || bytes > size - pos) {
+            return nullptr;
+        }
+        const auto *table = reinterpret_cast<const T *>(data + pos);
+        pos += bytes;
+        return table;
+    }
+
+  private:
+    const std::byte *data;
+    std::size_t size;
+    std::size_t pos;
+};
+
+/// @brief Read-only mapping of a whole file
+struct FileMapping {
+    int fd = -1;
+    void *data = MAP_FAILED;
+    std::size_t size = 0;
+
+    FileMapping() = default;
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    ~FileMapping() {
+        if (data != MAP_FAILED) {
+            munmap(data, size);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+};
+
+} // namespace
+
+namespace lang {
+
+// == ASTWriter ==
+
+std::string ASTWriter::writeModuleAST(const ModuleAST &module,
+                                      const SymbolTable &symbols) {
+    // NOTE: The nodes start past a null reference, so that no node is at
+    // position 0
+    nodes.assign(sizeof(std::uint64_t), '\0');
+    typedNodes.clear();
+    bodyParser = module.bodyParser;
+    for (const DeclAST *decl : module.decls) {
+        walk(*decl);
+    }
+    const std::uint32_t decls = writeArray(module.decls.size());
+    assert(values.empty());
+
+    for (const auto &[position, decl] : pendingRefs) {
+        writeField(position, declPositions.at(decl));
+        nodeRefs.push_back(position);
+    }
+
+    // NOTE: The typed nodes are laid out last, so that patching their types
+    // on load touches their pages only
+    const auto typedBase = static_cast<std::uint32_t>(
+        alignUp(nodes.size(), alignof(std::max_align_t)));
+    nodes.resize(typedBase, '\0');
+    nodes += typedNodes;
+    const auto layOut = [typedBase](std::uint32_t position) {
+        return (position & typedBit) != 0 ? (position & ~typedBit) + typedBase
+                                          : position;
+    };
+
+    nodes.resize(alignUp(nodes.size(), ArenaSpace::pageSize), '\0');
+    const auto base =
+        static_cast<std::uint32_t>(ArenaSpace::reservedSize - nodes.size());
+    for (std::uint32_t &position : nodeRefs) {
+        position = layOut(position);
+        std::uint32_t ref = 0;
+        std::memcpy(&ref, nodes.data() + position, sizeof(ref));
+        ref = layOut(ref) + base;
+        std::memcpy(nodes.data() + position, &ref, sizeof(ref));
+    }
+    for (TypeRef &typeRef : typeRefs) {
+        typeRef.position = layOut(typeRef.position);
+    }
+    for (std::uint32_t &position : symbolRefs) {
+        position = layOut(position);
+    }
+
+    std::vector<std::uint32_t> nameSizes;
+    std::string names;
+    for (std::uint32_t id = 0; id < symbols.size(); ++id) {
+        const std::string_view name = symbols.getName(Symbol(id));
+        nameSizes.push_back(static_cast<std::uint32_t>(name.size()));
+        names += name;
+    }
+
+    ImageHeader header = {};
+    std::memcpy(header.magic, imageMagic, sizeof(imageMagic));
+    header.version = imageVersion;
+    header.layout = imageLayout;
+    header.sourceSize = module.source.size();
+    header.sourceHash = hashSource(module.source);
+    header.base = base;
+    header.nodesSize = static_cast<std::uint32_t>(nodes.size());
+    header.decls = decls;
+    header.numDecls = static_cast<std::uint32_t>(module.decls.size());
+    header.identSize = static_cast<std::uint32_t>(module.ident.size());
+    header.numNodeRefs = static_cast<std::uint32_t>(nodeRefs.size());
+    header.numTypeRefs = static_cast<std::uint32_t>(typeRefs.size());
+    header.numSymbolRefs = static_cast<std::uint32_t>(symbolRefs.size());
+    header.numTypeWords = static_cast<std::uint32_t>(typeWords.size());
+    header.numSymbols = static_cast<std::uint32_t>(nameSizes.size());
+    header.namesSize = static_cast<std::uint32_t>(names.size());
+    header.nodesHash = llvm::xxHash64(nodes);
+    timespec now = {};
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.writeTime = toNanoSeconds(now);
+
+    std::string image(ArenaSpace::pageSize, '\0');
+    image += nodes;
+    append(image, nodeRefs);
+    append(image, typeRefs);
+    append(image, symbolRefs);
+    append(image, typeWords);
+    append(image, nameSizes);
+    image += names;
+    image += module.ident;
+    std::memcpy(image.data(), &header, sizeof(header));
+    header.checksum = hashImage(
+        reinterpret_cast<const std::byte *>(image.data()),
+        llvm::StringRef(image).substr(ArenaSpace::pageSize + nodes.size()));
+    std::memcpy(image.data() + offsetof(ImageHeader, checksum),
+                &header.checksum, sizeof(header.checksum));
+    return image;
+}
+
+void ASTWriter::stampFile(int fd, std::string_view image) {
+    struct stat status = {};
+    if (image.size() < sizeof(ImageHeader) || fstat(fd, &status) != 0 ||
+        !S_ISREG(status.st_mode) ||
+        static_cast<std::size_t>(status.st_size) < image.size()) {
+        return;
+    }
+    ImageHeader header = {};
+    std::memcpy(&header, image.data(), sizeof(header));
+    const timespec times[2] = {
+        {0, UTIME_OMIT},
+        {static_cast<time_t>(header.writeTime / 1000000000),
+         static_cast<long>(header.writeTime % 1000000000)},
+    };
+    futimens(fd, times);
+}
+
+template <typename T>
+std::uint32_t ASTWriter::copyNode(const T &node, bool typed) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "T must be trivially copyable");
+    std::string &buffer = typed ? typedNodes : nodes;
+    const auto position =
+        static_cast<std::uint32_t>(alignUp(buffer.size(), alignof(T)));
+    buffer.resize(position + sizeof(T), '\0');
+    std::memcpy(buffer.data() + position, &node, sizeof(T));
+    return typed ? position | typedBit : position;
+}
+
+template <typename T, typename U>
+void ASTWriter::writeRef(std::uint32_t position, const T &node,
+                         const ArenaRef<U> &field, std::uint32_t target) {
+    const std::uint32_t fieldPosition = getPosition(position, node, field);
+    writeField(fieldPosition, target);
+    if (target != 0) {
+        nodeRefs.push_back(fieldPosition);
+    }
+}
+
+template <typename T, typename U>
+void ASTWriter::writeDeclRef(std::uint32_t position, const T &node,
+                             const ArenaRef<U> &field) {
+    if (field == nullptr) {
+        writeRef(position, node, field, 0);
+        return;
+    }
+    const auto it = declPositions.find(field.get());
+    if (it != declPositions.end()) {
+        writeRef(position, node, field, it->second);
+        return;
+    }
+    const std::uint32_t fieldPosition = getPosition(position, node, field);
+    writeField(fieldPosition, std::uint32_t(0));
+    pendingRefs.emplace_back(fieldPosition, field.get());
+}
+
+template <typename T>
+void ASTWriter::writeType(std::uint32_t position, const T &node,
+                          const ArenaRef<Type> &field) {
+    const std::uint32_t fieldPosition = getPosition(position, node, field);
+    writeField(fieldPosition, std::uint32_t(0));
+    if (field != nullptr) {
+        typeRefs.push_back({fieldPosition, getTypeIndex(field.get())});
+    }
+}
+
+std::uint32_t ASTWriter::writeArray(std::size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    const auto position = static_cast<std::uint32_t>(
+        alignUp(nodes.size(), alignof(std::uint32_t)));
+    nodes.resize(position + size * sizeof(std::uint32_t), '\0');
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto elementPosition =
+            static_cast<std::uint32_t>(position + i * sizeof(std::uint32_t));
+        writeField(elementPosition, values[values.size() - size + i]);
+        nodeRefs.push_back(elementPosition);
+    }
+    values.resize(values.size() - size);
+    return position;
+}
+
+std::uint32_t ASTWriter::getTypeIndex(const Type *type) {
+    const auto it = typeIndices.find(type);
+    if (it != typeIndices.end()) {
+        return it->second;
+    }
+
+    std::vector<std::uint32_t> children;
+    if (type->kind == TypeKind::Pointer) {
+        children.push_back(getTypeIndex(type->as<PointerType>()->pointee));
+    } else if (type->kind == TypeKind::Function) {
+        for (const Type *arrow : type->as<FunctionType>()->arrows) {
+            children.push_back(getTypeIndex(arrow));
+        }
+    }
+
+    const auto index = static_cast<std::uint32_t>(typeIndices.size());
+    typeWords.push_back(static_cast<std::uint32_t>(type->kind));
+    typeWords.push_back(static_cast<std::uint32_t>(children.size()));
+    typeWords.insert(typeWords.end(), children.begin(), children.end());
+    typeIndices.emplace(type, index);
+    return index;
+}
+
+void ASTWriter::leave(const FunctionDeclAST &node) {
+    const std::uint32_t body = popValue();
+    const std::uint32_t params = writeArray(node.params.size());
+    const std::uint32_t position =
+        copyNode(node, node.retType != nullptr || node.type != nullptr);
+    writeSymbol(position, node, node.symbol);
+    writeRef(position, node, node.params.getData(), params);
+    writeType(position, node, node.retType);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.body, body);
+    writeField(getPosition(position, node, node.bodyBegin), std::uint32_t(0));
+    writeField(getPosition(position, node, node.bodyEnd), std::uint32_t(0));
+    declPositions.emplace(&node, position);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const ExprStmtAST &node) {
+    const std::uint32_t expr = popValue();
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.expr, expr);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const BreakStmtAST &node) {
+    const std::uint32_t position = copyNode(node);
+    writeDeclRef(position, node, node.target);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const ReturnStmtAST &node) {
+    const std::uint32_t expr = node.expr != nullptr ? popValue() : 0;
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.expr, expr);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const LocalStmtAST &node) {
+    const std::uint32_t init = node.init != nullptr ? popValue() : 0;
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeSymbol(position, node, node.symbol);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.init, init);
+    declPositions.emplace(&node, position);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const AssignStmtAST &node) {
+    const std::uint32_t rhs = popValue();
+    const std::uint32_t lhs = popValue();
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.lhs, lhs);
+    writeRef(position, node, node.rhs, rhs);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const BlockStmtAST &node) {
+    const std::uint32_t stmts = writeArray(node.stmts.size());
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.stmts.getData(), stmts);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const IfStmtAST &node) {
+    const std::uint32_t elseStmt = node.elseStmt != nullptr ? popValue() : 0;
+    const std::uint32_t thenStmt = popValue();
+    const std::uint32_t cond = popValue();
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.cond, cond);
+    writeRef(position, node, node.thenStmt, thenStmt);
+    writeRef(position, node, node.elseStmt, elseStmt);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const WhileStmtAST &node) {
+    const std::uint32_t body = popValue();
+    const std::uint32_t cond = popValue();
+    const std::uint32_t position = copyNode(node);
+    writeRef(position, node, node.cond, cond);
+    writeRef(position, node, node.body, body);
+    declPositions.emplace(&node, position);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const NumberExprAST &node) {
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const IdentifierExprAST &node) {
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeSymbol(position, node, node.symbol);
+    writeDeclRef(position, node, node.local);
+    writeDeclRef(position, node, node.function);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const UnaryExprAST &node) {
+    const std::uint32_t expr = popValue();
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.expr, expr);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const BinaryExprAST &node) {
+    const std::uint32_t rhs = popValue();
+    const std::uint32_t lhs = popValue();
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.lhs, lhs);
+    writeRef(position, node, node.rhs, rhs);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const CallExprAST &node) {
+    const std::uint32_t args = writeArray(node.args.size());
+    const std::uint32_t callee = popValue();
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.callee, callee);
+    writeRef(position, node, node.args.getData(), args);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const IndexExprAST &node) {
+    const std::uint32_t index = popValue();
+    const std::uint32_t base = popValue();
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.base, base);
+    writeRef(position, node, node.index, index);
+    values.push_back(position);
+}
+
+void ASTWriter::leave(const GroupedExprAST &node) {
+    const std::uint32_t expr = popValue();
+    const std::uint32_t position = copyNode(node, node.type != nullptr);
+    writeType(position, node, node.type);
+    writeRef(position, node, node.expr, expr);
+    values.push_back(position);
+}
+
+// == ASTImage ==
+
+llvm::Expected<ASTImage> ASTImage::load(llvm::StringRef filename,
+                                        std::string_view source,
+                                        Arena &arena, TypeContext &typeCtx,
+                                        SymbolTable &symbols) {
+    FileMapping file;
+    file.fd = open(filename.str().c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status = {};
+    if (file.fd == -1 || fstat(file.fd, &status) != 0) {
+        return llvm::errorCodeToError(
+            std::error_code(errno, std::generic_category()));
+    }
+    file.size = static_cast<std::size_t>(status.st_size);
+    if (file.size < ArenaSpace::pageSize) {
+        return makeError("not an AST image");
+    }
+    file.data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (file.data == MAP_FAILED) {
+        return llvm::errorCodeToError(
+            std::error_code(errno, std::generic_category()));
+    }
+    const auto *bytes = static_cast<const std::byte *>(file.data);
+
+    ImageHeader header = {};
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, imageMagic, sizeof(imageMagic)) != 0) {
+        return makeError("not an AST image");
+    }
+    if (header.version != imageVersion || header.layout != imageLayout) {
+        return makeError("AST image written by another version of the "
+                         "compiler");
+    }
+    if (header.sourceSize != source.size() ||
+        header.sourceHash != hashSource(source)) {
+        return makeError("AST image written for another version of the "
+                         "input file");
+    }
+
+    const std::size_t nodesSize = header.nodesSize;
+    if (nodesSize == 0 || nodesSize % ArenaSpace::pageSize != 0 ||
+        header.base % ArenaSpace::pageSize != 0 ||
+        nodesSize > ArenaSpace::reservedSize - header.base ||
+        nodesSize > file.size - ArenaSpace::pageSize ||
+        header.numDecls > nodesSize / sizeof(std::uint32_t) ||
+        header.decls > nodesSize - header.numDecls * sizeof(std::uint32_t) ||
+        header.decls % alignof(std::uint32_t) != 0) {
+        return makeError("malformed AST image");
+    }
+
+    const std::byte *nodes = bytes + ArenaSpace::pageSize;
+    TableReader tables(nodes + nodesSize,
+                       file.size - ArenaSpace::pageSize - nodesSize);
+    const auto *nodeRefs = tables.read<std::uint32_t>(header.numNodeRefs);
+    const auto *typeRefs = tables.read<ASTWriter::TypeRef>(header.numTypeRefs);
+    const auto *symbolRefs = tables.read<std::uint32_t>(header.numSymbolRefs);
+    const auto *typeWords = tables.read<std::uint32_t>(header.numTypeWords);
+    const auto *nameSizes = tables.read<std::uint32_t>(header.numSymbols);
+    const auto *names = tables.read<char>(header.namesSize);
+    const auto *ident = tables.read<char>(header.identSize);
+    if (nodeRefs == nullptr || typeRefs == nullptr || symbolRefs == nullptr ||
+        typeWords == nullptr || nameSizes == nullptr || names == nullptr ||
+        ident == nullptr) {
+        return makeError("malformed AST image");
+    }
+
+    // NOTE: The image ends with the identifier of the module, whatever
+    // follows it
+    const auto *tablesBegin = reinterpret_cast<const char *>(nodes) + nodesSize;
+    const llvm::StringRef tablesData(tablesBegin,
+                                     ident + header.identSize - tablesBegin);
+    if (header.checksum != hashImage(bytes, tablesData)) {
+        return makeError("malformed AST image");
+    }
+
+    // NOTE: Hashing the nodes takes as long as the rest of the load, so it is
+    // skipped while the file still has the modification time it was given
+    // once written, which any later write to it changes
+    if (toNanoSeconds(status.st_mtim) != header.writeTime &&
+        header.nodesHash !=
+            llvm::xxHash64(llvm::StringRef(
+                reinterpret_cast<const char *>(nodes), nodesSize))) {
+        return makeError("malformed AST image");
+    }
+
+    const auto isField = [nodesSize](std::uint32_t position) {
+        return position % alignof(std::uint32_t) == 0 &&
+               position <= nodesSize - sizeof(std::uint32_t);
+    };
+
+    std::vector<Type *> types;
+    for (std::size_t i = 0; i < header.numTypeWords;) {
+        if (header.numTypeWords - i < 2 ||
+            typeWords[i + 1] > header.numTypeWords - i - 2) {
+            return makeError("malformed AST image");
+        }
+        const auto kind = static_cast<TypeKind>(typeWords[i]);
+        const std::uint32_t *children = typeWords + i + 2;
+        const std::uint32_t numChildren = typeWords[i + 1];
+        i += 2 + numChildren;
+        for (std::uint32_t j = 0; j < numChildren; ++j) {
+            if (children[j] >= types.size()) {
+                return makeError("malformed AST image");
+            }
+        }
+
+        switch (kind) {
+        case TypeKind::Void:
+            types.push_back(typeCtx.getTypeVoid());
+            continue;
+        case TypeKind::Number:
+            types.push_back(typeCtx.getTypeNumber());
+            continue;
+        case TypeKind::Pointer:
+            if (numChildren == 1) {
+                types.push_back(
+                    typeCtx.make<PointerType>(types[children[0]]));
+                continue;
+            }
+            break;
+        case TypeKind::Function:
+            if (numChildren != 0) {
+                Arena *arrowArena = typeCtx.getArena();
+                const Arena::Mark mark = arrowArena->mark();
+                NonOwningList<Type *> arrows;
+                for (std::uint32_t j = 0; j < numChildren; ++j) {
+                    arrows.emplace_back(arrowArena, types[children[j]]);
+                }
+                types.push_back(typeCtx.makeSince<FunctionType>(mark, arrows));
+                continue;
+            }
+            break;
+        }
+        return makeError("malformed AST image");
+    }
+
+    std::vector<Symbol> symbolMap;
+    symbolMap.reserve(header.numSymbols);
+    bool symbolsMoved = false;
+    for (std::size_t i = 0, offset = 0; i < header.numSymbols; ++i) {
+        if (nameSizes[i] > header.namesSize - offset) {
+            return makeError("malformed AST image");
+        }
+        const Symbol symbol = symbols.intern({names + offset, nameSizes[i]});
+        offset += nameSizes[i];
+        symbolsMoved |= symbol.getId() != i;
+        symbolMap.push_back(symbol);
+    }
+
+    for (std::uint32_t i = 0; i < header.numTypeRefs; ++i) {
+        if (!isField(typeRefs[i].position) ||
+            typeRefs[i].type >= types.size()) {
+            return makeError("malformed AST image");
+        }
+    }
+    for (std::uint32_t i = 0; i < header.numNodeRefs; ++i) {
+        if (!isField(nodeRefs[i])) {
+            return makeError("malformed AST image");
+        }
+    }
+    for (std::uint32_t i = 0; i < header.numSymbolRefs; ++i) {
+        if (!isField(symbolRefs[i])) {
+            return makeError("malformed AST image");
+        }
+    }
+
+    // NOTE: The nodes are mapped at their preferred offset if it is free,
+    // and copied into a block and relocated otherwise
+    std::byte *data = ArenaSpace::mapFile(header.base, nodesSize, file.fd,
+                                          ArenaSpace::pageSize);
+    const bool mapped = data != nullptr;
+    if (!mapped) {
+        data = ArenaSpace::allocBlock(nodesSize);
+    }
+    ASTImage image(nullptr, data, nodesSize, mapped);
+    if (!mapped) {
+        std::memcpy(data, nodes, nodesSize);
+        const auto delta = static_cast<std::uint32_t>(
+            static_cast<std::size_t>(data - ArenaSpace::getBase()) -
+            header.base);
+        for (std::uint32_t i = 0; i < header.numNodeRefs; ++i) {
+            std::uint32_t ref = 0;
+            std::memcpy(&ref, data + nodeRefs[i], sizeof(ref));
+            if (!isField(ref - header.base)) {
+                return makeError("malformed AST image");
+            }
+            ref += delta;
+            std::memcpy(data + nodeRefs[i], &ref, sizeof(ref));
+        }
+    }
+
+    for (std::uint32_t i = 0; i < header.numTypeRefs; ++i) {
+        const ArenaRef<Type> type = types[typeRefs[i].type];
+        std::memcpy(data + typeRefs[i].position, &type, sizeof(type));
+    }
+
+    if (symbolsMoved) {
+        for (std::uint32_t i = 0; i < header.numSymbolRefs; ++i) {
+            Symbol symbol;
+            std::memcpy(&symbol, data + symbolRefs[i], sizeof(symbol));
+            if (!symbol.isValid()) {
+                continue;
+            }
+            if (symbol.getId() >= symbolMap.size()) {
+                return makeError("malformed AST image");
+            }
+            symbol = symbolMap[symbol.getId()];
+            std::memcpy(data + symbolRefs[i], &symbol, sizeof(symbol));
+        }
+    }
+
+    char *moduleIdent = arena.allocArray<char>(header.identSize);
+    std::memcpy(moduleIdent, ident, header.identSize);
+    NodeArray<DeclAST> decls;
+    if (header.numDecls != 0) {
+        decls = NodeArray<DeclAST>(
+            reinterpret_cast<ArenaRef<DeclAST> *>(data + header.decls),
+            header.numDecls);
+    }
+    image.module = arena.alloc<ModuleAST>(
+        std::string_view(moduleIdent, header.identSize), source, decls);
+    return image;
+}
+
+ASTImage &ASTImage::operator=(ASTImage &&other) noexcept {
+    if (this != &other) {
+        release();
+        module = other.module;
+        data = std::exchange(other.data, nullptr);
+        size = other.size;
+        mapped = other.mapped;
+    }
+    return *this;
+}
+
+ASTImage::~ASTImage() { release(); }
+
+void ASTImage::release() {
+    if (data == nullptr) {
+        return;
+    }
+    if (mapped) {
+        ArenaSpace::unmapFile(data, size);
+    } else {
+        ArenaSpace::freeBlock(data, size);
+    }
+    data = nullptr;
+}
+
+} // namespace lang
@@ -8,45 +8,40 @@ template <class... Ts> struct Overloaded : Ts... {
 
 template <class... Ts> Overloaded(Ts...) -> Overloaded<Ts...>;
 
-struct Identation {
-    int &level;
-    Identation(int &level) : level(level) { ++level; }
-    ~Identation() { --level; }
-};
-
 } // namespace
 
+// NOTE: The level goes back to the one of the parent when the node is left
 #define INDENT()                                                               \
-    Identation identation(level);                                              \
+    ++level;                                                                   \
     ident();
 
 namespace lang {
 
 void ASTPrinter::visit(const ModuleAST &node) {
     INDENT();
+    source = node.source;
+    bodyParser = node.bodyParser;
     os << "ModuleAST: " << node.ident << '\n';
     for (const DeclAST *decl : node.decls) {
-        ASTVisitor::visit(*decl);
+        walk(*decl);
     }
+    --level;
 }
 
-void ASTPrinter::visit(const FunctionDeclAST &node) {
+bool ASTPrinter::enter(const FunctionDeclAST &node) {
     INDENT();
-    os << "FunctionDeclAST: " << node.ident << ": " << node.retType->toString()
-       << '\n';
-    for (auto *param : node.params) {
-        visit(*param);
-    }
-    ASTVisitor::visit(*node.body);
+    os << "FunctionDeclAST: " << node.ident.in(source) << ": "
+       << node.retType->toString() << '\n';
+    return true;
 }
 
-void ASTPrinter::visit(const ExprStmtAST &node) {
+bool ASTPrinter::enter(const ExprStmtAST &node) {
     INDENT();
     os << "ExprStmtAST\n";
-    ASTVisitor::visit(*node.expr);
+    return true;
 }
 
-void ASTPrinter::visit(const BreakStmtAST &node) {
+bool ASTPrinter::enter(const BreakStmtAST &node) {
     INDENT();
     os << "BreakStmtAST: ";
     if (node.target == nullptr) {
@@ -54,64 +49,53 @@ void ASTPrinter::visit(const BreakStmtAST &node) {
     } else {
         os << "StmtAST(" << static_cast<const void *>(node.target) << ")\n";
     }
+    return true;
 }
 
-void ASTPrinter::visit(const ReturnStmtAST &node) {
+bool ASTPrinter::enter(const ReturnStmtAST &node) {
     INDENT();
     os << "ReturnStmtAST\n";
-    if (node.expr != nullptr) {
-        ASTVisitor::visit(*node.expr);
-    }
+    return true;
 }
 
-void ASTPrinter::visit(const LocalStmtAST &node) {
+bool ASTPrinter::enter(const LocalStmtAST &node) {
     INDENT();
     os << "LocalStmtAST: " << (node.isConst ? "let" : "mut") << ' '
-       << node.span;
+       << node.span.in(source);
     if (node.type) {
         os << ": " << node.type->toString();
     }
     os << '\n';
-    if (node.init) {
-        ASTVisitor::visit(*node.init);
-    }
+    return true;
 }
 
-void ASTPrinter::visit(const AssignStmtAST &node) {
+bool ASTPrinter::enter(const AssignStmtAST &node) {
     INDENT();
     os << "AssignStmtAST\n";
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
+    return true;
 }
 
-void ASTPrinter::visit(const BlockStmtAST &node) {
+bool ASTPrinter::enter(const BlockStmtAST &node) {
     INDENT();
     os << "BlockStmtAST\n";
-    for (const StmtAST *stmt : node.stmts) {
-        ASTVisitor::visit(*stmt);
-    }
+    return true;
 }
 
-void ASTPrinter::visit(const IfStmtAST &node) {
+bool ASTPrinter::enter(const IfStmtAST &node) {
     INDENT();
     os << "IfStmtAST\n";
-    ASTVisitor::visit(*node.cond);
-    visit(*node.thenStmt);
-    if (node.elseStmt != nullptr) {
-        ASTVisitor::visit(*node.elseStmt);
-    }
+    return true;
 }
 
-void ASTPrinter::visit(const WhileStmtAST &node) {
+bool ASTPrinter::enter(const WhileStmtAST &node) {
     INDENT();
     os << "WhileStmtAST\n";
-    ASTVisitor::visit(*node.cond);
-    visit(*node.body);
+    return true;
 }
 
-void ASTPrinter::visit(const IdentifierExprAST &node) {
+bool ASTPrinter::enter(const IdentifierExprAST &node) {
     INDENT();
-    os << "IdentifierExprAST: " << node.span;
+    os << "IdentifierExprAST: " << node.span.in(source);
     std::visit(Overloaded{[&](const LocalStmtAST *stmt) {
                               os << " => LocalStmtAST("
                                  << static_cast<const void *>(stmt) << ')';
@@ -120,48 +104,45 @@ void ASTPrinter::visit(const IdentifierExprAST &node) {
                               os << " => FunctionDeclAST("
                                  << static_cast<const void *>(decl) << ')';
                           }},
-               node.decl);
+               node.getDecl());
     os << '\n';
+    return true;
 }
 
-void ASTPrinter::visit(const NumberExprAST &node) {
+bool ASTPrinter::enter(const NumberExprAST &node) {
     INDENT();
-    os << "NumberExprAST: " << node.span << '\n';
+    os << "NumberExprAST: " << node.span.in(source) << '\n';
+    return true;
 }
 
-void ASTPrinter::visit(const UnaryExprAST &node) {
+bool ASTPrinter::enter(const UnaryExprAST &node) {
     INDENT();
     os << "UnaryExprAST: " << unOpKindToString(node.op) << '\n';
-    ASTVisitor::visit(*node.expr);
+    return true;
 }
 
-void ASTPrinter::visit(const BinaryExprAST &node) {
+bool ASTPrinter::enter(const BinaryExprAST &node) {
     INDENT();
     os << "BinaryExprAST: " << binOpKindToString(node.op) << '\n';
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
+    return true;
 }
 
-void ASTPrinter::visit(const CallExprAST &node) {
+bool ASTPrinter::enter(const CallExprAST &node) {
     INDENT();
     os << "CallExprAST\n";
-    ASTVisitor::visit(*node.callee);
-    for (const ExprAST *arg : node.args) {
-        ASTVisitor::visit(*arg);
-    }
+    return true;
 }
 
-void ASTPrinter::visit(const IndexExprAST &node) {
+bool ASTPrinter::enter(const IndexExprAST &node) {
     INDENT();
     os << "IndexExprAST\n";
-    ASTVisitor::visit(*node.base);
-    ASTVisitor::visit(*node.index);
+    return true;
 }
 
-void ASTPrinter::visit(const GroupedExprAST &node) {
+bool ASTPrinter::enter(const GroupedExprAST &node) {
     INDENT();
     os << "GroupedExprAST\n";
-    ASTVisitor::visit(*node.expr);
+    return true;
 }
 
 void ASTPrinter::ident() {
@@ -0,0 +1,182 @@
+#include "AST/FlatAST.h"
+
+#include <cassert>
+
+namespace lang {
+
+FlatAST ASTFlattener::flattenModuleAST(ModuleAST &module) {
+    flat = FlatAST();
+    flat.source = module.source;
+    bodyParser = module.bodyParser;
+
+    // NOTE: Nodes span four bytes of source or more in most code, so this
+    // estimate rarely has to grow, and what it reserves in excess is never
+    // touched
+    const std::size_t numNodes = module.source.size() / 4;
+    flat.kinds.reserve(numNodes);
+    flat.operands.reserve(numNodes);
+    flat.types.reserve(numNodes);
+    flat.nodes.reserve(numNodes);
+
+    functionNodes.reset();
+    moduleArena.reset();
+    functionNodes.emplace(FunctionMap::allocator_type(moduleArena));
+    functionNodes->reserve(module.decls.size());
+    for (DeclAST *decl : module.decls) {
+        auto *function = static_cast<FunctionDeclAST *>(decl);
+        functionNodes->emplace(function, flat.functions.size());
+        flat.functions.push_back(function);
+    }
+    for (DeclAST *decl : module.decls) {
+        walk(*decl);
+    }
+    assert(values.empty() && subtrees.empty());
+    return std::move(flat);
+}
+
+std::uint32_t ASTFlattener::push(FlatKind kind, void *node, Type *type,
+                                 FlatAST::Operands operands) {
+    const std::uint32_t index = flat.size();
+    flat.kinds.push_back(kind);
+    flat.operands.push_back(operands);
+    flat.types.push_back(type);
+    flat.nodes.push_back(node);
+    return index;
+}
+
+bool ASTFlattener::enter(FunctionDeclAST &node) {
+    currentFunction = functionNodes->at(&node);
+    localNodes.emplace(LocalMap::allocator_type(scratch));
+    for (LocalStmtAST *param : node.params) {
+        (*localNodes)[param] = push(FlatKind::Param, param, param->type,
+                                    {FlatAST::none, FlatAST::none});
+    }
+    return true;
+}
+
+bool ASTFlattener::enter(BlockStmtAST &node) {
+    subtrees.push_back(flat.size());
+    return true;
+}
+
+bool ASTFlattener::enter(IfStmtAST &node) {
+    subtrees.push_back(flat.size());
+    return true;
+}
+
+bool ASTFlattener::enter(WhileStmtAST &node) {
+    subtrees.push_back(flat.size());
+    return true;
+}
+
+void ASTFlattener::leave(FunctionDeclAST &node) {
+    for (const auto &[index, local] : pendingRefs) {
+        flat.operands[index][0] = localNodes->at(local);
+    }
+    pendingRefs.clear();
+    localNodes.reset();
+    scratch.reset();
+}
+
+void ASTFlattener::leave(ExprStmtAST &node) {
+    push(FlatKind::Expr, &node, nullptr, {popValue(), FlatAST::none});
+}
+
+void ASTFlattener::leave(BreakStmtAST &node) {
+    push(FlatKind::Break, &node, nullptr, {FlatAST::none, FlatAST::none});
+}
+
+void ASTFlattener::leave(ReturnStmtAST &node) {
+    const std::uint32_t expr =
+        node.expr != nullptr ? popValue() : FlatAST::none;
+    push(FlatKind::Return, &node, nullptr, {expr, currentFunction});
+}
+
+void ASTFlattener::leave(LocalStmtAST &node) {
+    const std::uint32_t init =
+        node.init != nullptr ? popValue() : FlatAST::none;
+    (*localNodes)[&node] =
+        push(FlatKind::Local, &node, node.type, {init, FlatAST::none});
+}
+
+void ASTFlattener::leave(AssignStmtAST &node) {
+    const std::uint32_t rhs = popValue();
+    const std::uint32_t lhs = popValue();
+    push(FlatKind::Assign, &node, nullptr, {lhs, rhs});
+}
+
+void ASTFlattener::leave(BlockStmtAST &node) {
+    push(FlatKind::Block, &node, nullptr, {subtrees.back(), FlatAST::none});
+    subtrees.pop_back();
+}
+
+void ASTFlattener::leave(IfStmtAST &node) {
+    values.pop_back();
+    push(FlatKind::If, &node, nullptr, {subtrees.back(), FlatAST::none});
+    subtrees.pop_back();
+}
+
+void ASTFlattener::leave(WhileStmtAST &node) {
+    values.pop_back();
+    push(FlatKind::While, &node, nullptr, {subtrees.back(), FlatAST::none});
+    subtrees.pop_back();
+}
+
+void ASTFlattener::leave(NumberExprAST &node) {
+    values.push_back(push(FlatKind::Number, &node, node.type,
+                          {FlatAST::none, FlatAST::none}));
+}
+
+void ASTFlattener::leave(IdentifierExprAST &node) {
+    const IdentifierDecl decl = node.getDecl();
+    if (auto *const *function = std::get_if<FunctionDeclAST *>(&decl)) {
+        values.push_back(push(FlatKind::FunctionRef, &node, node.type,
+                              {functionNodes->at(*function), FlatAST::none}));
+        return;
+    }
+
+    // NOTE: A local is lowered after the references to it in its own
+    // initializer, and an unresolved identifier refers to no local
+    const LocalStmtAST *local = std::get<LocalStmtAST *>(decl);
+    const auto it = localNodes->find(local);
+    const std::uint32_t operand =
+        it != localNodes->end() ? it->second : FlatAST::none;
+    const std::uint32_t index = push(FlatKind::LocalRef, &node, node.type,
+                                     {operand, FlatAST::none});
+    if (local != nullptr && it == localNodes->end()) {
+        pendingRefs.emplace_back(index, local);
+    }
+    values.push_back(index);
+}
+
+void ASTFlattener::leave(UnaryExprAST &node) {
+    values.push_back(push(FlatKind::Unary, &node, node.type,
+                          {popValue(), FlatAST::none}));
+}
+
+void ASTFlattener::leave(BinaryExprAST &node) {
+    const std::uint32_t rhs = popValue();
+    const std::uint32_t lhs = popValue();
+    values.push_back(push(FlatKind::Binary, &node, node.type, {lhs, rhs}));
+}
+
+void ASTFlattener::leave(CallExprAST &node) {
+    const auto numArgs = static_cast<std::uint32_t>(node.args.size());
+    values.resize(values.size() - numArgs);
+    const std::uint32_t callee = popValue();
+    values.push_back(
+        push(FlatKind::Call, &node, node.type, {callee, numArgs}));
+}
+
+void ASTFlattener::leave(IndexExprAST &node) {
+    const std::uint32_t index = popValue();
+    const std::uint32_t base = popValue();
+    values.push_back(push(FlatKind::Index, &node, node.type, {base, index}));
+}
+
+void ASTFlattener::leave(GroupedExprAST &node) {
+    values.push_back(push(FlatKind::Grouped, &node, node.type,
+                          {popValue(), FlatAST::none}));
+}
+
+} // namespace lang
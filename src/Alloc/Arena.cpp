@@ -1,46 +1,233 @@
 #include "Alloc/Arena.h"
 
-#include <cstdlib>
+#include "llvm/ADT/StringMap.h"
+
+#include <atomic>
 
 namespace lang {
 
-constexpr std::size_t alignUp(std::size_t size, std::size_t align) {
-    return (size + align - 1) & ~(align - 1);
+namespace {
+
+/// @brief Returns the size class of a block of the given size, the largest
+/// whose smallest blocks are no larger than it
+std::size_t getSizeClass(std::size_t size, std::size_t numClasses) {
+    std::size_t sizeClass = 0;
+    while (sizeClass + 1 < numClasses &&
+           (Arena::minBlockSize << (sizeClass + 1)) <= size) {
+        ++sizeClass;
+    }
+    return sizeClass;
 }
 
-} // namespace lang
+} // namespace
 
-namespace lang {
+std::size_t Arena::getNextTypeIndex() {
+    static std::atomic<std::size_t> nextIndex = 0;
+    return nextIndex++;
+}
 
-void *Arena::allocInternal(std::size_t size) {
-    size = alignUp(size, alignof(max_align_t));
+std::vector<ArenaTypeStats> Arena::getTypeStats() const {
+    if (typeStats == nullptr) {
+        return {};
+    }
 
-    if (allocSize + size > block.size) {
-        if (block.data != nullptr) {
-            used.emplace_back(std::move(block));
+    // NOTE: A type may have several indices if its index was not merged
+    // across translation units, so the statistics are merged by name
+    llvm::StringMap<ArenaTypeStats> byName;
+    for (const ArenaTypeStats &stats : *typeStats) {
+        if (stats.name.empty()) {
+            continue;
         }
+        ArenaTypeStats &merged = byName[stats.name];
+        merged.name = stats.name;
+        merged.count += stats.count;
+        merged.bytes += stats.bytes;
+    }
+
+    std::vector<ArenaTypeStats> result;
+    result.reserve(byName.size());
+    for (const auto &entry : byName) {
+        result.push_back(entry.getValue());
+    }
+    std::sort(result.begin(), result.end(),
+              [](const ArenaTypeStats &lhs, const ArenaTypeStats &rhs) {
+                  return lhs.bytes != rhs.bytes ? lhs.bytes > rhs.bytes
+                                                : lhs.name < rhs.name;
+              });
+    return result;
+}
 
-        for (auto it = avail.begin(); it != avail.end(); ++it) {
-            if (it->size >= size) {
-                block = std::move(*it);
-                avail.erase(it);
-                break;
+void Arena::adopt(Arena &&other) {
+    numAllocations += other.numAllocations;
+    numRequested += other.numRequested;
+    numTailBytes += other.numTailBytes;
+    numRolledBack += other.numRolledBack;
+    if (other.block.data != nullptr) {
+        numTailBytes += other.block.size - other.allocSize;
+        used.push_back(std::move(other.block));
+        other.block = Block{};
+    }
+    for (Block &otherBlock : other.used) {
+        used.push_back(std::move(otherBlock));
+    }
+    other.used.clear();
+    for (std::size_t i = 0; i < numBins; ++i) {
+        for (Block &otherBlock : other.bins[i]) {
+            bins[i].push_back(std::move(otherBlock));
+        }
+        other.bins[i].clear();
+    }
+    for (Block &range : other.ranges) {
+        ranges.push_back(std::move(range));
+    }
+    other.ranges.clear();
+    if (typeStats != nullptr && other.typeStats != nullptr) {
+        if (typeStats->size() < other.typeStats->size()) {
+            typeStats->resize(other.typeStats->size());
+        }
+        for (std::size_t i = 0; i < other.typeStats->size(); ++i) {
+            const ArenaTypeStats &otherStats = (*other.typeStats)[i];
+            ArenaTypeStats &stats = (*typeStats)[i];
+            if (stats.name.empty()) {
+                stats.name = otherStats.name;
             }
+            stats.count += otherStats.count;
+            stats.bytes += otherStats.bytes;
+        }
+        other.typeStats->clear();
+    }
+    peakCommitted = std::max(peakCommitted + other.maxCommitted(),
+                             totalCommitted());
+    peakRequested = std::max(peakRequested, numRequested);
+    other.numAllocations = 0;
+    other.numRequested = 0;
+    other.numTailBytes = 0;
+    other.numRolledBack = 0;
+    other.peakCommitted = 0;
+    other.peakRequested = 0;
+    other.allocSize = 0;
+}
+
+void Arena::reset() {
+    // NOTE: Ranges give their memory back to the system, and the arena
+    // starts over from one of them if it has any
+    peakCommitted = maxCommitted();
+    peakRequested = maxRequested();
+    if (block.data != nullptr) {
+        used.push_back(std::move(block));
+        block = Block{};
+    }
+    for (Block &usedBlock : used) {
+        if (usedBlock.isRange()) {
+            ArenaSpace::decommitRange(usedBlock.data.get(), usedBlock.size);
+            usedBlock.size = 0;
+            ranges.push_back(std::move(usedBlock));
+        } else {
+            recycle(std::move(usedBlock));
         }
+    }
+    used.clear();
+    numRequested = 0;
+    numTailBytes = 0;
+    allocSize = 0;
+}
+
+void Arena::rollbackBlocks(const Mark &saved) {
+    if (block.data != nullptr) {
+        recycle(std::move(block));
+        block = Block{};
+    }
+    const std::size_t numKept = saved.numUsed + (saved.hasBlock ? 1 : 0);
+    for (std::size_t i = numKept; i < used.size(); ++i) {
+        recycle(std::move(used[i]));
+    }
+    if (saved.hasBlock) {
+        block = std::move(used[saved.numUsed]);
+    }
+    used.resize(saved.numUsed);
+}
+
+void Arena::recycle(Block &&freed) {
+    if (freed.isRange()) {
+        ranges.push_back(std::move(freed));
+    } else {
+        bins[getSizeClass(freed.size, numBins)].push_back(std::move(freed));
+    }
+}
 
-        if (block.data == nullptr) {
-            block = Block{
-                std::max(size, defaultSize),
-                std::make_unique<std::byte[]>(std::max(size, defaultSize))};
+void *Arena::allocSlow(std::size_t size, std::size_t align) {
+    if (block.isRange()) {
+        const std::size_t start = alignUp(allocSize, align);
+        const std::size_t rangeSize = block.data.get_deleter().size;
+        if (start <= rangeSize && size <= rangeSize - start) {
+            // NOTE: A range recycled by a rollback keeps its committed pages,
+            // which may already cover the allocation
+            const std::size_t committed =
+                std::min(alignUp(start + size, commitSize), rangeSize);
+            if (committed > block.size) {
+                ArenaSpace::commitRange(
+                    block.data.get() + block.size, committed - block.size,
+                    backend == ArenaBackend::ReservedHugePages);
+                block.size = committed;
+                peakCommitted = std::max(peakCommitted, totalCommitted());
+            }
+            numRequested += size;
+            allocSize = start + size;
+            return block.data.get() + start;
         }
+    }
 
-        allocSize = 0;
+    if (block.data != nullptr) {
+        numTailBytes += block.size - allocSize;
+        used.push_back(std::move(block));
+        block = Block{};
     }
+    allocSize = 0;
 
-    void *result = block.data.get() + allocSize;
-    allocSize += size;
+    if (!ranges.empty()) {
+        block = std::move(ranges.back());
+        ranges.pop_back();
+        return allocSlow(size, align);
+    }
+    if (pendingRange != 0) {
+        block.data = {ArenaSpace::reserveRange(pendingRange),
+                      BlockDeleter{pendingRange, true}};
+        pendingRange = 0;
+        return allocSlow(size, align);
+    }
 
-    return result;
+    // NOTE: Every block of the class above the one of the size fits, and so
+    // does every block of the size's own class if it is the smallest size of
+    // it. The last class has no upper bound, so its blocks are checked.
+    std::size_t sizeClass = getSizeClass(size, numBins);
+    if ((minBlockSize << sizeClass) < size && sizeClass + 1 < numBins) {
+        ++sizeClass;
+    }
+    for (; sizeClass < numBins; ++sizeClass) {
+        auto &bin = bins[sizeClass];
+        const auto it = std::find_if(
+            bin.rbegin(), bin.rend(),
+            [size](const Block &freeBlock) { return freeBlock.size >= size; });
+        if (it != bin.rend()) {
+            block = std::move(*it);
+            bin.erase(std::next(it).base());
+            break;
+        }
+    }
+
+    if (block.data == nullptr) {
+        const std::size_t blockSize =
+            alignUp(std::max(size, nextSize), minBlockSize);
+        block.size = blockSize;
+        block.data = {ArenaSpace::allocBlock(blockSize),
+                      BlockDeleter{blockSize, false}};
+        nextSize = std::min(nextSize * 2, maxBlockSize);
+        peakCommitted = std::max(peakCommitted, totalCommitted());
+    }
+
+    numRequested += size;
+    allocSize = size;
+    return block.data.get();
 }
 
 } // namespace lang
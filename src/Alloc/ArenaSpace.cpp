@@ -0,0 +1,231 @@
+#include "Alloc/ArenaSpace.h"
+
+#include <cassert>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace {
+
+/// @brief Bookkeeping of the space, created along with its reservation
+struct SpaceState {
+    std::mutex mutex;
+    /// @brief Offset of the first byte that was never handed out
+    std::size_t top = lang::ArenaSpace::pageSize;
+    /// @brief Sizes of the decommitted ranges below top that are free, by
+    /// offset, none of which touches another
+    std::map<std::size_t, std::size_t> freeSpace;
+    /// @brief Offsets and sizes of the files mapped into the space
+    std::vector<std::pair<std::size_t, std::size_t>> mappings;
+
+    /// @brief Returns the end of the first mapping that overlaps the given
+    /// range, or 0 if none does
+    [[nodiscard]] std::size_t findMapping(std::size_t offset,
+                                          std::size_t size) const {
+        for (const auto &[start, length] : mappings) {
+            if (offset < start + length && start < offset + size) {
+                return start + length;
+            }
+        }
+        return 0;
+    }
+
+    /// @brief Returns the offset of a range of the given size and alignment
+    /// past top, and moves top past it
+    /// @note Ranges are carved past the files mapped at higher offsets. The
+    /// space skipped to align the range is free, unless a file lies in it.
+    std::size_t carve(std::size_t size, std::size_t align) {
+        std::size_t offset = alignUp(top, align);
+        while (const std::size_t end = findMapping(offset, size)) {
+            offset = alignUp(end, align);
+        }
+        if (offset > lang::ArenaSpace::reservedSize ||
+            size > lang::ArenaSpace::reservedSize - offset) {
+            throw lang::ArenaSpaceExhausted();
+        }
+        if (offset != top && findMapping(top, offset - top) == 0) {
+            freeSpace.emplace(top, offset - top);
+        }
+        top = offset + size;
+        return offset;
+    }
+
+    /// @brief Returns the offset of a range of the given size and alignment,
+    /// taken from the smallest free range that fits it, or carved past top
+    /// if none does
+    std::size_t take(std::size_t size, std::size_t align) {
+        auto best = freeSpace.end();
+        for (auto it = freeSpace.begin(); it != freeSpace.end(); ++it) {
+            const std::size_t start = alignUp(it->first, align);
+            if (start - it->first < it->second &&
+                size <= it->second - (start - it->first) &&
+                (best == freeSpace.end() || it->second < best->second)) {
+                best = it;
+            }
+        }
+        if (best == freeSpace.end()) {
+            return carve(size, align);
+        }
+
+        // NOTE: The free space left on either side of the range stays free
+        const auto [offset, length] = *best;
+        const std::size_t start = alignUp(offset, align);
+        freeSpace.erase(best);
+        if (start != offset) {
+            freeSpace.emplace(offset, start - offset);
+        }
+        if (start + size != offset + length) {
+            freeSpace.emplace(start + size, offset + length - start - size);
+        }
+        return start;
+    }
+
+    /// @brief Returns the given decommitted range to the free space, merging
+    /// it with the free ranges next to it, and with top if it ends there
+    void release(std::size_t offset, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        auto next = freeSpace.lower_bound(offset);
+        if (next != freeSpace.end() && next->first == offset + size) {
+            size += next->second;
+            next = freeSpace.erase(next);
+        }
+        if (next != freeSpace.begin()) {
+            const auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                freeSpace.erase(prev);
+            }
+        }
+        if (offset + size == top) {
+            top = offset;
+        } else {
+            freeSpace.emplace(offset, size);
+        }
+    }
+
+    static constexpr std::size_t alignUp(std::size_t size, std::size_t align) {
+        return (size + align - 1) & ~(align - 1);
+    }
+};
+
+// NOTE: The space is reserved without access, which costs no memory, and
+// blocks are made accessible as they are handed out
+SpaceState &getState(std::byte *&base) {
+    static SpaceState state = [&base] {
+        void *mapping =
+            mmap(nullptr, lang::ArenaSpace::reservedSize, PROT_NONE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        base = static_cast<std::byte *>(mapping);
+        return SpaceState{};
+    }();
+    return state;
+}
+
+} // namespace
+
+namespace lang {
+
+std::byte *ArenaSpace::allocBlock(std::size_t size) {
+    assert(size != 0 && size % pageSize == 0 && "invalid block size");
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+
+    std::byte *data = base + state.take(size, pageSize);
+    if (mprotect(data, size, PROT_READ | PROT_WRITE) != 0) {
+        state.release(static_cast<std::size_t>(data - base), size);
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+void ArenaSpace::freeBlock(std::byte *data, std::size_t size) {
+    assert(contains(data) && "block outside of the space");
+    decommitRange(data, size);
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    state.release(static_cast<std::size_t>(data - base), size);
+}
+
+std::byte *ArenaSpace::reserveRange(std::size_t size) {
+    assert(size != 0 && size % hugePageSize == 0 && "invalid range size");
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    return base + state.take(size, hugePageSize);
+}
+
+void ArenaSpace::commitRange(std::byte *data, std::size_t size,
+                             bool hugePages) {
+    assert(contains(data) && "range outside of the space");
+    if (mprotect(data, size, PROT_READ | PROT_WRITE) != 0) {
+        throw std::bad_alloc();
+    }
+    // NOTE: The advice is only a hint, which hosts without transparent huge
+    // pages ignore or reject
+    if (hugePages) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+}
+
+void ArenaSpace::decommitRange(std::byte *data, std::size_t size) {
+    assert(contains(data) && "range outside of the space");
+    madvise(data, size, MADV_DONTNEED);
+    mprotect(data, size, PROT_NONE);
+}
+
+void ArenaSpace::releaseRange(std::byte *data, std::size_t size) {
+    assert(contains(data) && "range outside of the space");
+    decommitRange(data, size);
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+    state.release(static_cast<std::size_t>(data - base), size);
+}
+
+std::byte *ArenaSpace::mapFile(std::size_t offset, std::size_t size, int fd,
+                               std::size_t fileOffset) {
+    assert(offset % pageSize == 0 && size % pageSize == 0 &&
+           "invalid mapping range");
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+
+    if (offset < state.top || size > reservedSize - offset ||
+        state.findMapping(offset, size) != 0) {
+        return nullptr;
+    }
+    void *mapping =
+        mmap(base + offset, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(fileOffset));
+    if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    state.mappings.emplace_back(offset, size);
+    return base + offset;
+}
+
+void ArenaSpace::unmapFile(std::byte *data, std::size_t size) {
+    assert(contains(data) && "mapping outside of the space");
+    SpaceState &state = getState(base);
+    const std::lock_guard<std::mutex> lock(state.mutex);
+
+    // NOTE: The range goes back to being reserved without access
+    mmap(data, size, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    const auto offset = static_cast<std::size_t>(data - base);
+    for (auto it = state.mappings.begin(); it != state.mappings.end(); ++it) {
+        if (it->first == offset) {
+            state.mappings.erase(it);
+            break;
+        }
+    }
+}
+
+} // namespace lang
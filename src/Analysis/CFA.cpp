@@ -31,54 +31,61 @@ JSONError CFAError::toJSONError() const {
 }
 
 CFAResult CFA::analyzeModuleAST(ModuleAST &module) {
-    for (auto *decl : module.decls) {
-        ASTVisitor::visit(*decl);
+    source = module.source;
+    bodyParser = module.bodyParser;
+    for (DeclAST *decl : module.decls) {
+        walk(*decl);
     }
     return {std::move(errors)};
 }
 
-void CFA::visit(FunctionDeclAST &node) { visit(*node.body); }
-
-void CFA::visit(BreakStmtAST &node) {
+bool CFA::enter(BreakStmtAST &node) {
     if (breakableStack.empty()) {
-        errors.push_back({CFAErrorKind::InvalidBreakStmt, node.span});
-        return;
+        errors.push_back(
+            {CFAErrorKind::InvalidBreakStmt, node.span.in(source)});
+        return true;
     }
 
     node.target = breakableStack.top();
+    return true;
 }
 
-void CFA::visit(BlockStmtAST &node) {
+bool CFA::enter(BlockStmtAST &node) {
+    BlockCut cut = {node.stmts.size(), nullptr};
     std::size_t i = 0;
-    for (auto *stmt : node.stmts) {
-        ASTVisitor::visit(*stmt);
-
+    for (StmtAST *stmt : node.stmts) {
         ++i;
-        if (stmt->kind == StmtASTKind::Break ||
-            stmt->kind == StmtASTKind::Return) {
-            CFAErrorKind kind = stmt->kind == StmtASTKind::Break
-                                    ? CFAErrorKind::EarlyBreakStmt
-                                    : CFAErrorKind::EarlyReturnStmt;
-            if (i != node.stmts.size()) {
-                errors.push_back({kind, stmt->span});
-                break;
-            }
+        if ((stmt->kind == StmtASTKind::Break ||
+             stmt->kind == StmtASTKind::Return) &&
+            i != node.stmts.size()) {
+            cut = {i - 1, stmt};
+            break;
         }
     }
+    blockCuts.push_back(cut);
+    return true;
 }
 
-void CFA::visit(IfStmtAST &node) {
-    ASTVisitor::visit(*node.thenStmt);
-    if (node.elseStmt != nullptr) {
-        ASTVisitor::visit(*node.elseStmt);
+bool CFA::enterChild(BlockStmtAST &node, std::size_t index) {
+    const BlockCut &cut = blockCuts.back();
+    if (index <= cut.index) {
+        return true;
+    }
+
+    // NOTE: The statements after the cut are never visited, and the error is
+    // reported once the cut itself was
+    if (index == cut.index + 1) {
+        errors.push_back({cut.stmt->kind == StmtASTKind::Break
+                              ? CFAErrorKind::EarlyBreakStmt
+                              : CFAErrorKind::EarlyReturnStmt,
+                          cut.stmt->span.in(source)});
     }
+    return false;
 }
 
-void CFA::visit(WhileStmtAST &node) {
-    ASTVisitor::visit(*node.cond);
+bool CFA::enter(WhileStmtAST &node) {
     breakableStack.push(&node);
-    visit(*node.body);
-    breakableStack.pop();
+    return true;
 }
 
 } // namespace lang
@@ -22,117 +22,94 @@ JSONError ResolveError::toJSONError() const {
 }
 
 ResolveResult Resolver::resolveModuleAST(ModuleAST &module) {
-    for (auto *decl : module.decls) {
-        ASTVisitor::visit(*decl);
-    }
-    deepResolution = true;
-    for (auto *decl : module.decls) {
-        ASTVisitor::visit(*decl);
+    source = module.source;
+    bodyParser = module.bodyParser;
+    declareFunctions(module);
+    for (DeclAST *decl : module.decls) {
+        walk(*decl);
     }
     return {std::move(errors)};
 }
 
-LocalStmtAST *Resolver::lookupLocal(std::string_view ident) const {
-    for (auto it = localsMap.rbegin(); it != localsMap.rend(); ++it) {
-        const auto &locals = *it;
-        const auto found = locals.find(ident);
-        if (found != locals.end()) {
-            return found->second;
-        }
+void Resolver::declareFunctions(ModuleAST &module) {
+    for (DeclAST *decl : module.decls) {
+        ASTVisitor::visit(*decl);
     }
-    return nullptr;
 }
 
-void Resolver::visit(FunctionDeclAST &node) {
-    if (!deepResolution) {
-        functionsMap.insert({node.ident, &node});
-    } else {
-        localsMap.emplace_back();
-        for (auto *param : node.params) {
-            visit(*param);
-        }
-        visit(*node.body);
-        localsMap.pop_back();
+void Resolver::popScope() {
+    assert(!scopes.empty());
+    for (std::size_t i = shadowed.size(); i != scopes.back(); --i) {
+        const ShadowedBinding &entry = shadowed[i - 1];
+        locals[entry.symbol.getId()] = entry.binding;
     }
+    shadowed.resize(scopes.back());
+    scopes.pop_back();
 }
 
-void Resolver::visit(ExprStmtAST &node) { ASTVisitor::visit(*node.expr); }
-
-void Resolver::visit(ReturnStmtAST &node) {
-    if (node.expr != nullptr) {
-        ASTVisitor::visit(*node.expr);
+void Resolver::bindLocal(LocalStmtAST &node) {
+    assert(!scopes.empty());
+    assert(node.symbol.isValid());
+    const std::uint32_t id = node.symbol.getId();
+    if (id >= locals.size()) {
+        locals.resize(id + 1);
     }
-}
-
-void Resolver::visit(LocalStmtAST &node) {
-    assert(!localsMap.empty());
-    localsMap.back().insert({node.span, &node});
-    if (node.init != nullptr) {
-        ASTVisitor::visit(*node.init);
+    // NOTE: The first local of a given name in a scope wins
+    LocalBinding &binding = locals[id];
+    if (binding.local != nullptr && binding.depth == scopes.size()) {
+        return;
     }
+    shadowed.push_back({node.symbol, binding});
+    binding = {&node, scopes.size()};
 }
 
-void Resolver::visit(AssignStmtAST &node) {
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
+LocalStmtAST *Resolver::lookupLocal(Symbol symbol) const {
+    const std::uint32_t id = symbol.getId();
+    return id < locals.size() ? locals[id].local : nullptr;
 }
 
-void Resolver::visit(BlockStmtAST &node) {
-    localsMap.emplace_back();
-    for (auto *stmt : node.stmts) {
-        ASTVisitor::visit(*stmt);
+void Resolver::visit(FunctionDeclAST &node) {
+    assert(node.symbol.isValid());
+    const std::uint32_t id = node.symbol.getId();
+    if (id >= functions.size()) {
+        functions.resize(id + 1, nullptr);
     }
-    localsMap.pop_back();
-}
-
-void Resolver::visit(IfStmtAST &node) {
-    ASTVisitor::visit(*node.cond);
-    visit(*node.thenStmt);
-    if (node.elseStmt != nullptr) {
-        ASTVisitor::visit(*node.elseStmt);
+    if (functions[id] == nullptr) {
+        functions[id] = &node;
     }
 }
 
-void Resolver::visit(WhileStmtAST &node) {
-    ASTVisitor::visit(*node.cond);
-    visit(*node.body);
+bool Resolver::enter(FunctionDeclAST &node) {
+    pushScope();
+    return true;
 }
 
-void Resolver::visit(IdentifierExprAST &node) {
-    LocalStmtAST *local = lookupLocal(node.span);
-    if (local != nullptr) {
-        node.decl = local;
-        return;
-    }
-
-    const auto it = functionsMap.find(node.span);
-    if (it == functionsMap.end()) {
-        errors.push_back({ResolveErrorKind::UnknownIdentifier, node.span});
-        return;
-    }
-
-    node.decl = it->second;
+bool Resolver::enter(LocalStmtAST &node) {
+    bindLocal(node);
+    return true;
 }
 
-void Resolver::visit(UnaryExprAST &node) { ASTVisitor::visit(*node.expr); }
-
-void Resolver::visit(BinaryExprAST &node) {
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
+bool Resolver::enter(BlockStmtAST &node) {
+    pushScope();
+    return true;
 }
 
-void Resolver::visit(CallExprAST &node) {
-    ASTVisitor::visit(*node.callee);
-    for (auto *arg : node.args) {
-        ASTVisitor::visit(*arg);
+bool Resolver::enter(IdentifierExprAST &node) {
+    LocalStmtAST *local = lookupLocal(node.symbol);
+    if (local != nullptr) {
+        node.setDecl(local);
+        return true;
     }
-}
 
-void Resolver::visit(IndexExprAST &node) {
-    ASTVisitor::visit(*node.base);
-    ASTVisitor::visit(*node.index);
-}
+    const std::uint32_t id = node.symbol.getId();
+    if (id >= functions.size() || functions[id] == nullptr) {
+        errors.push_back(
+            {ResolveErrorKind::UnknownIdentifier, node.span.in(source)});
+        return true;
+    }
 
-void Resolver::visit(GroupedExprAST &node) { ASTVisitor::visit(*node.expr); }
+    node.setDecl(functions[id]);
+    return true;
+}
 
 } // namespace lang
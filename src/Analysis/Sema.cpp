@@ -0,0 +1,27 @@
+#include "Analysis/Sema.h"
+
+#include <cassert>
+
+namespace lang {
+
+SemaResult Sema::analyzeModuleAST(ModuleAST &module) {
+    cfa.source = module.source;
+    resolver.source = module.source;
+    typeChecker.source = module.source;
+    bodyParser = module.bodyParser;
+
+    // NOTE: Functions can be called before they are declared, so they are
+    // registered before any body is walked
+    resolver.declareFunctions(module);
+    for (DeclAST *decl : module.decls) {
+        walk(*decl);
+        assert(cfaSkip.node == nullptr && resolverSkip.node == nullptr &&
+               typeCheckerSkip.node == nullptr);
+    }
+
+    return {{std::move(cfa.errors)},
+            {std::move(resolver.errors)},
+            {std::move(typeChecker.errors)}};
+}
+
+} // namespace lang
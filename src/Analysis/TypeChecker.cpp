@@ -39,132 +39,201 @@ JSONError TypeCheckerError::toJSONError() const {
 }
 
 TypeCheckerResult TypeChecker::analyzeModuleAST(ModuleAST &module) {
-    for (auto *decl : module.decls) {
-        ASTVisitor::visit(*decl);
+    source = module.source;
+    bodyParser = module.bodyParser;
+    for (DeclAST *decl : module.decls) {
+        walk(*decl);
     }
     return {std::move(errors)};
 }
 
-void TypeChecker::visit(FunctionDeclAST &node) {
-    currentFunction = &node;
-    ASTVisitor::visit(*node.body);
-}
+TypeCheckerResult TypeChecker::analyzeFlatAST(FlatAST &flat) {
+    source = flat.source;
+    const std::uint32_t size = flat.size();
+    const FlatKind *kinds = flat.kinds.data();
+    const FlatAST::Operands *operands = flat.operands.data();
+    Type **types = flat.types.data();
+
+    // NOTE: Operands come before the nodes that use them, so their types are
+    // known by the time they are read, as with the tree walk
+    for (std::uint32_t i = 0; i < size; ++i) {
+        const auto [first, second] = operands[i];
+        switch (kinds[i]) {
+        case FlatKind::Number:
+            types[i] = typeCtx->getTypeNumber();
+            break;
+        case FlatKind::LocalRef:
+            types[i] = first != FlatAST::none ? types[first] : nullptr;
+            break;
+        case FlatKind::FunctionRef:
+            types[i] = getFunctionType(*flat.functions[first]);
+            break;
+        case FlatKind::Unary:
+        case FlatKind::Call:
+        case FlatKind::Index:
+        case FlatKind::Grouped:
+            types[i] = types[first];
+            break;
+        case FlatKind::Binary:
+            if (types[first] != types[second]) {
+                errors.push_back(
+                    {TypeCheckerErrorKind::InvalidBinaryOperation,
+                     flat.getNode<ExprAST>(i).span.in(source)});
+            }
+            types[i] = types[first];
+            break;
+        case FlatKind::Local: {
+            bool valid = types[i] != nullptr;
+            if (first != FlatAST::none) {
+                valid = types[i] == nullptr || types[i] == types[first];
+                if (types[i] == nullptr) {
+                    types[i] = types[first];
+                }
+            }
+            if (!valid) {
+                errors.push_back({TypeCheckerErrorKind::InvalidAssignment,
+                                  flat.getNode<StmtAST>(i).span.in(source)});
+            }
+        } break;
+        case FlatKind::Return: {
+            const Type *retType = flat.functions[second]->retType;
+            const bool valid = retType == nullptr
+                                   ? first == FlatAST::none
+                                   : first != FlatAST::none &&
+                                         types[first] == retType;
+            if (!valid) {
+                errors.push_back({TypeCheckerErrorKind::InvalidReturn,
+                                  flat.getNode<StmtAST>(i).span.in(source)});
+            }
+        } break;
+        case FlatKind::Assign:
+            if (types[first] != types[second]) {
+                errors.push_back({TypeCheckerErrorKind::InvalidAssignment,
+                                  flat.getNode<StmtAST>(i).span.in(source)});
+            }
+            break;
+        case FlatKind::Param:
+        case FlatKind::Expr:
+        case FlatKind::Break:
+        case FlatKind::Block:
+        case FlatKind::If:
+        case FlatKind::While:
+            break;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < size; ++i) {
+        if (isFlatExpr(kinds[i])) {
+            flat.getNode<ExprAST>(i).type = types[i];
+        } else if (kinds[i] == FlatKind::Local) {
+            flat.getNode<LocalStmtAST>(i).type = types[i];
+        }
+    }
 
-void TypeChecker::visit(ExprStmtAST &node) { ASTVisitor::visit(*node.expr); }
+    return {std::move(errors)};
+}
 
-void TypeChecker::visit(ReturnStmtAST &node) {
-    if (node.expr != nullptr) {
-        ASTVisitor::visit(*node.expr);
+Type *TypeChecker::getFunctionType(FunctionDeclAST &decl) {
+    // NOTE: The return type is always annotated, and the parameters are
+    // typed by their annotations only, so the signature does not change once
+    // made. A function with a parameter left unannotated has no signature,
+    // like an unresolved identifier has no type.
+    if (decl.type != nullptr) {
+        return decl.type;
+    }
+    for (const LocalStmtAST *param : decl.params) {
+        if (param->type == nullptr) {
+            return nullptr;
+        }
     }
+    const Arena::Mark mark = arena->mark();
+    NonOwningList<Type *> list;
+    for (LocalStmtAST *param : decl.params) {
+        list.emplace_back(arena, param->type);
+    }
+    list.emplace_back(arena, decl.retType);
+    decl.type = typeCtx->makeSince<FunctionType>(mark, list);
+    return decl.type;
+}
+
+bool TypeChecker::enter(FunctionDeclAST &node) {
+    currentFunction = &node;
+    return true;
+}
 
+void TypeChecker::leave(ReturnStmtAST &node) {
     if (currentFunction->retType == nullptr) {
         if (node.expr != nullptr) {
-            errors.push_back({TypeCheckerErrorKind::InvalidReturn, node.span});
+            errors.push_back({TypeCheckerErrorKind::InvalidReturn,
+                              node.span.in(source)});
         }
     } else {
         if (node.expr == nullptr) {
-            errors.push_back({TypeCheckerErrorKind::InvalidReturn, node.span});
+            errors.push_back({TypeCheckerErrorKind::InvalidReturn,
+                              node.span.in(source)});
         } else {
             if (node.expr->type != currentFunction->retType) {
-                errors.push_back(
-                    {TypeCheckerErrorKind::InvalidReturn, node.span});
+                errors.push_back({TypeCheckerErrorKind::InvalidReturn,
+                                  node.span.in(source)});
             }
         }
     }
 }
 
-void TypeChecker::visit(LocalStmtAST &node) {
+void TypeChecker::leave(LocalStmtAST &node) {
     if (node.init != nullptr) {
-        ASTVisitor::visit(*node.init);
-
         if (node.type == nullptr) {
             node.type = node.init->type;
         } else {
             if (node.type != node.init->type) {
-                errors.push_back(
-                    {TypeCheckerErrorKind::InvalidAssignment, node.span});
+                errors.push_back({TypeCheckerErrorKind::InvalidAssignment,
+                                  node.span.in(source)});
             }
         }
     } else {
         if (node.type == nullptr) {
-            errors.push_back(
-                {TypeCheckerErrorKind::InvalidAssignment, node.span});
+            errors.push_back({TypeCheckerErrorKind::InvalidAssignment,
+                              node.span.in(source)});
         }
     }
 }
 
-void TypeChecker::visit(AssignStmtAST &node) {
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
-
+void TypeChecker::leave(AssignStmtAST &node) {
     if (node.lhs->type != node.rhs->type) {
-        errors.push_back({TypeCheckerErrorKind::InvalidAssignment, node.span});
-    }
-}
-
-void TypeChecker::visit(BlockStmtAST &node) {
-    for (auto *stmt : node.stmts) {
-        ASTVisitor::visit(*stmt);
-    }
-}
-
-void TypeChecker::visit(IfStmtAST &node) {
-    ASTVisitor::visit(*node.cond);
-    ASTVisitor::visit(*node.thenStmt);
-
-    if (node.elseStmt != nullptr) {
-        ASTVisitor::visit(*node.elseStmt);
+        errors.push_back({TypeCheckerErrorKind::InvalidAssignment,
+                          node.span.in(source)});
     }
 }
 
-void TypeChecker::visit(WhileStmtAST &node) {
-    ASTVisitor::visit(*node.cond);
-    ASTVisitor::visit(*node.body);
-}
-
-void TypeChecker::visit(IdentifierExprAST &node) {
+void TypeChecker::leave(IdentifierExprAST &node) {
     std::visit(Overloaded{
-                   [&](const LocalStmtAST *stmt) { node.type = stmt->type; },
-                   [&](const FunctionDeclAST *decl) {
-                       NonOwningList<Type *> list;
-                       for (auto *param : decl->params) {
-                           list.emplace_back(arena, param->type);
-                       }
-                       list.emplace_back(arena, decl->retType);
-                       node.type = typeCtx->make<FunctionType>(list);
+                   [&](const LocalStmtAST *stmt) {
+                       // NOTE: Sema also checks unresolved identifiers
+                       node.type = stmt != nullptr ? stmt->type : nullptr;
+                   },
+                   [&](FunctionDeclAST *decl) {
+                       node.type = getFunctionType(*decl);
                    },
                },
-               node.decl);
+               node.getDecl());
 }
 
-void TypeChecker::visit(NumberExprAST &node) {
+void TypeChecker::leave(NumberExprAST &node) {
     node.type = typeCtx->getTypeNumber();
 }
 
-void TypeChecker::visit(UnaryExprAST &node) {
-    ASTVisitor::visit(*node.expr);
-
-    node.type = node.expr->type;
-}
-
-void TypeChecker::visit(BinaryExprAST &node) {
-    ASTVisitor::visit(*node.lhs);
-    ASTVisitor::visit(*node.rhs);
+void TypeChecker::leave(UnaryExprAST &node) { node.type = node.expr->type; }
 
+void TypeChecker::leave(BinaryExprAST &node) {
     if (node.lhs->type != node.rhs->type) {
-        errors.push_back(
-            {TypeCheckerErrorKind::InvalidBinaryOperation, node.span});
+        errors.push_back({TypeCheckerErrorKind::InvalidBinaryOperation,
+                          node.span.in(source)});
     }
 
     node.type = node.lhs->type;
 }
 
-void TypeChecker::visit(CallExprAST &node) {
-    ASTVisitor::visit(*node.callee);
-    for (auto &arg : node.args) {
-        ASTVisitor::visit(*arg);
-    }
-
+void TypeChecker::leave(CallExprAST &node) {
     // TODO: Verify that the callee is a function and that the argument types
     // match the parameter types
 
@@ -172,17 +241,10 @@ void TypeChecker::visit(CallExprAST &node) {
     node.type = node.callee->type;
 }
 
-void TypeChecker::visit(IndexExprAST &node) {
-    ASTVisitor::visit(*node.base);
-    ASTVisitor::visit(*node.index);
-
+void TypeChecker::leave(IndexExprAST &node) {
     node.type = node.base->type;
 }
 
-void TypeChecker::visit(GroupedExprAST &node) {
-    ASTVisitor::visit(*node.expr);
-
-    node.type = node.expr->type;
-}
+void TypeChecker::leave(GroupedExprAST &node) { node.type = node.expr->type; }
 
 } // namespace lang
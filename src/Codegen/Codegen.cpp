@@ -14,132 +14,159 @@ namespace lang {
 
 llvm::Module *Codegen::generateModule(const ModuleAST &module) {
     llvmModule = std::make_unique<llvm::Module>("main", *context);
-    for (auto *decl : module.decls) {
+    source = module.source;
+    bodyParser = module.bodyParser;
+    functionTable.reserve(module.decls.size());
+    for (const DeclAST *decl : module.decls) {
         ASTVisitor::visit(*decl);
     }
-    deepCodegen = true;
-    for (auto *decl : module.decls) {
-        ASTVisitor::visit(*decl);
+    for (const DeclAST *decl : module.decls) {
+        walk(*decl);
     }
     return llvmModule.get();
 }
 
 void Codegen::visit(const FunctionDeclAST &node) {
-    if (!deepCodegen) {
-        // TODO: implement proper function signatures
-        auto *funcType = llvm::FunctionType::get(
-            llvm::Type::getVoidTy(*context), false /* isVarArg */);
-        auto *func =
-            llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
-                                   node.ident, llvmModule.get());
-        functionTable[&node] = func;
-    } else {
-        auto *func = functionTable.at(&node);
-        auto *entry = llvm::BasicBlock::Create(*context, "entry", func);
-        builder->SetInsertPoint(entry);
-        // for (auto *arg : node.params) {
-        //     auto *alloca =
-        //     builder->CreateAlloca(llvm::Type::getFloatTy(*context),
-        //                                          nullptr, arg->span);
-        //     builder->CreateStore(arg->name, alloca);
-        //     namedValues[arg] = alloca;
-        // }
-        ASTVisitor::visit(*node.body);
-        builder->CreateRetVoid();
+    // TODO: implement proper function signatures
+    auto *funcType = llvm::FunctionType::get(llvm::Type::getVoidTy(*context),
+                                             false /* isVarArg */);
+    auto *func =
+        llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+                               node.ident.in(source), llvmModule.get());
+    functionTable[&node] = func;
+    const std::uint32_t id = node.symbol.getId();
+    if (id >= symbolFunctions.size()) {
+        symbolFunctions.resize(id + 1, nullptr);
+    }
+    if (symbolFunctions[id] == nullptr) {
+        symbolFunctions[id] = func;
     }
 }
 
-void Codegen::visit(const ExprStmtAST &node) { ASTVisitor::visit(*node.expr); }
+bool Codegen::enter(const FunctionDeclAST &node) {
+    auto *func = functionTable.at(&node);
+    auto *entry = llvm::BasicBlock::Create(*context, "entry", func);
+    builder->SetInsertPoint(entry);
+    breakTargets.emplace(BreakMap::allocator_type(scratch));
+    namedValues.emplace(LocalMap::allocator_type(scratch));
+    // for (auto *arg : node.params) {
+    //     auto *alloca =
+    //     builder->CreateAlloca(llvm::Type::getFloatTy(*context),
+    //                                          nullptr, arg->span);
+    //     builder->CreateStore(arg->name, alloca);
+    //     namedValues[arg] = alloca;
+    // }
+    return true;
+}
+
+void Codegen::leave(const FunctionDeclAST &node) {
+    builder->CreateRetVoid();
+    breakTargets.reset();
+    namedValues.reset();
+    scratch.reset();
+}
 
-void Codegen::visit(const BreakStmtAST &node) {
-    builder->CreateBr(breakTargets.at(node.target));
+bool Codegen::enter(const BreakStmtAST &node) {
+    builder->CreateBr(breakTargets->at(node.target));
+    return true;
 }
 
-void Codegen::visit(const ReturnStmtAST &node) {
+void Codegen::leave(const ReturnStmtAST &node) {
     if (node.expr) {
-        ASTVisitor::visit(*node.expr);
         builder->CreateRet(exprResult);
     } else {
         builder->CreateRetVoid();
     }
 }
 
-void Codegen::visit(const LocalStmtAST &node) { /* TODO */
-}
-
-void Codegen::visit(const AssignStmtAST &node) { /* TODO */
-}
-
-void Codegen::visit(const BlockStmtAST &node) {
-    for (auto *stmt : node.stmts) {
-        ASTVisitor::visit(*stmt);
-    }
-}
-
-void Codegen::visit(const IfStmtAST &node) {
+bool Codegen::enter(const IfStmtAST &node) {
     auto *func = builder->GetInsertBlock()->getParent();
     auto *thenBB = llvm::BasicBlock::Create(*context, "then", func);
     auto *elseBB = llvm::BasicBlock::Create(*context, "else", func);
     auto *mergeBB = llvm::BasicBlock::Create(*context, "ifcont", func);
+    blockStack.push_back({thenBB, elseBB, mergeBB});
+    return true;
+}
 
-    ASTVisitor::visit(*node.cond);
-    builder->CreateCondBr(exprResult, thenBB, elseBB);
-
-    builder->SetInsertPoint(thenBB);
-    ASTVisitor::visit(*node.thenStmt);
-    builder->CreateBr(mergeBB);
+bool Codegen::enterChild(const IfStmtAST &node, std::size_t index) {
+    const auto &[thenBB, elseBB, mergeBB] = blockStack.back();
+    if (index == 1) {
+        builder->CreateCondBr(exprResult, thenBB, elseBB);
+        builder->SetInsertPoint(thenBB);
+    } else if (index == 2) {
+        builder->CreateBr(mergeBB);
+        builder->SetInsertPoint(elseBB);
+    }
+    return true;
+}
 
-    builder->SetInsertPoint(elseBB);
-    if (node.elseStmt) {
-        ASTVisitor::visit(*node.elseStmt);
+void Codegen::leave(const IfStmtAST &node) {
+    const auto &[thenBB, elseBB, mergeBB] = blockStack.back();
+    if (!node.elseStmt) {
+        builder->CreateBr(mergeBB);
+        builder->SetInsertPoint(elseBB);
     }
     builder->CreateBr(mergeBB);
 
     builder->SetInsertPoint(mergeBB);
+    blockStack.pop_back();
 }
 
-void Codegen::visit(const WhileStmtAST &node) {
+bool Codegen::enter(const WhileStmtAST &node) {
     auto *func = builder->GetInsertBlock()->getParent();
     auto *condBB = llvm::BasicBlock::Create(*context, "cond", func);
     auto *bodyBB = llvm::BasicBlock::Create(*context, "body", func);
     auto *afterBB = llvm::BasicBlock::Create(*context, "after", func);
-    breakTargets[&node] = afterBB;
+    (*breakTargets)[&node] = afterBB;
+    blockStack.push_back({condBB, bodyBB, afterBB});
 
     builder->CreateBr(condBB);
 
     builder->SetInsertPoint(condBB);
-    ASTVisitor::visit(*node.cond);
-    builder->CreateCondBr(exprResult, bodyBB, afterBB);
+    return true;
+}
+
+bool Codegen::enterChild(const WhileStmtAST &node, std::size_t index) {
+    if (index == 1) {
+        const auto &[condBB, bodyBB, afterBB] = blockStack.back();
+        builder->CreateCondBr(exprResult, bodyBB, afterBB);
+        builder->SetInsertPoint(bodyBB);
+    }
+    return true;
+}
 
-    builder->SetInsertPoint(bodyBB);
-    ASTVisitor::visit(*node.body);
+void Codegen::leave(const WhileStmtAST &node) {
+    const auto &[condBB, bodyBB, afterBB] = blockStack.back();
     builder->CreateBr(condBB);
 
     builder->SetInsertPoint(afterBB);
+    blockStack.pop_back();
 }
 
-void Codegen::visit(const IdentifierExprAST &node) {
+void Codegen::leave(const IdentifierExprAST &node) {
     std::visit(Overloaded{
                    [&](const LocalStmtAST *decl) {
-                       exprResult = namedValues.at(decl);
+                       exprResult = namedValues->at(decl);
                    },
                    [&](const FunctionDeclAST *decl) { exprResult = nullptr; },
                },
-               node.decl);
+               node.getDecl());
 }
 
-void Codegen::visit(const NumberExprAST &node) {
-    exprResult = llvm::ConstantFP::get(
-        *context, llvm::APFloat(std::stof(std::string(node.span))));
+void Codegen::leave(const NumberExprAST &node) {
+    exprResult = llvm::ConstantFP::get(*context, llvm::APFloat(node.value));
 }
 
-void Codegen::visit(const UnaryExprAST &node) {}
-
-void Codegen::visit(const BinaryExprAST &node) {
-    ASTVisitor::visit(*node.lhs);
-    auto *lhs = exprResult;
+bool Codegen::enterChild(const BinaryExprAST &node, std::size_t index) {
+    if (index == 1) {
+        lhsStack.push_back(exprResult);
+    }
+    return true;
+}
 
-    ASTVisitor::visit(*node.rhs);
+void Codegen::leave(const BinaryExprAST &node) {
+    auto *lhs = lhsStack.back();
+    lhsStack.pop_back();
     auto *rhs = exprResult;
 
     switch (node.op) {
@@ -182,18 +209,18 @@ void Codegen::visit(const BinaryExprAST &node) {
     }
 }
 
-void Codegen::visit(const CallExprAST &node) {
+bool Codegen::enter(const CallExprAST &node) {
     if (node.callee->kind == ExprASTKind::Identifier) {
-        auto *callee = static_cast<IdentifierExprAST *>(node.callee);
+        auto *callee = static_cast<IdentifierExprAST *>(node.callee.get());
         std::visit(Overloaded{
                        [&](const LocalStmtAST *decl) { exprResult = nullptr; },
                        [&](const FunctionDeclAST *decl) {
                            exprResult = builder->CreateCall(
-                               llvmModule->getFunction(decl->ident),
-                               std::vector<llvm::Value *>(1, exprResult));
+                               symbolFunctions[decl->symbol.getId()],
+                               llvm::ArrayRef<llvm::Value *>(exprResult));
                        },
                    },
-                   callee->decl);
+                   callee->getDecl());
     } else {
         // TODO:
         // ASTVisitor::visit(*node.callee);
@@ -203,13 +230,7 @@ void Codegen::visit(const CallExprAST &node) {
         // exprResult = builder->CreateCall(callee, std::vector<llvm::Value
         // *>(1, arg));
     }
+    return false;
 }
 
-void Codegen::visit(const IndexExprAST &node) { /* TODO */
-}
-
-void Codegen::visit(const GroupedExprAST &node) {
-    ASTVisitor::visit(*node.expr);
-}
-
-} // namespace lang
\ No newline at end of file
+} // namespace lang
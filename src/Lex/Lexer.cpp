@@ -1,30 +1,142 @@
 #include "Lex/Lexer.h"
 
-#include <unordered_map>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <thread>
 
 namespace {
 
-bool isWhite(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+// == Punctuation ==
 
-bool isAlpha(char c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+/// @brief Describes how to lex a token starting with a given punctuation
+/// character: either a single character token, or a two character token when
+/// the next character is `follow`
+struct PunctEntry {
+    bool valid = false;
+    char follow = '\0';
+    lang::TokenKind kind = lang::TokenKind::Bang;
+    lang::TokenKind followKind = lang::TokenKind::Bang;
+};
+
+constexpr std::array<PunctEntry, 256> makePunctTable() {
+    std::array<PunctEntry, 256> table{};
+    for (const char c : {'(', ')', '*', '+', '-', ',', '.', ':', ';', '[', ']',
+                         '{', '}'}) {
+        table[static_cast<unsigned char>(c)] = {
+            true, '\0', static_cast<lang::TokenKind>(c), lang::TokenKind::Bang};
+    }
+    table['!'] = {true, '=', lang::TokenKind::Bang, lang::TokenKind::BangEqual};
+    table['&'] = {true, '&', lang::TokenKind::Amp, lang::TokenKind::AmpAmp};
+    table['|'] = {true, '|', lang::TokenKind::Pipe, lang::TokenKind::PipePipe};
+    table['<'] = {true, '=', lang::TokenKind::Less, lang::TokenKind::LessEqual};
+    table['='] = {true, '=', lang::TokenKind::Equal,
+                  lang::TokenKind::EqualEqual};
+    table['>'] = {true, '=', lang::TokenKind::Greater,
+                  lang::TokenKind::GreaterEqual};
+    table['/'] = {true, '/', lang::TokenKind::Slash, lang::TokenKind::Comment};
+    return table;
+}
+
+constexpr std::array<PunctEntry, 256> punctTable = makePunctTable();
+
+// == Keywords ==
+
+struct Keyword {
+    std::string_view text;
+    lang::TokenKind kind;
+};
+
+constexpr Keyword keywords[] = {
+    {"fn", lang::TokenKind::KwFn},
+    {"void", lang::TokenKind::KwVoid},
+    {"number", lang::TokenKind::KwNumber},
+    {"let", lang::TokenKind::KwLet},
+    {"var", lang::TokenKind::KwVar},
+    {"if", lang::TokenKind::KwIf},
+    {"else", lang::TokenKind::KwElse},
+    {"while", lang::TokenKind::KwWhile},
+    {"break", lang::TokenKind::KwBreak},
+    {"return", lang::TokenKind::KwReturn},
+};
+
+constexpr unsigned keywordTableBits = 4;
+
+/// @brief Hashes the first character, last character and length of a
+/// non-empty identifier into [0, 2^keywordTableBits)
+constexpr unsigned hashKeyword(const char *data, std::size_t size,
+                               std::uint32_t seed) {
+    const std::uint32_t key =
+        static_cast<unsigned char>(data[0]) |
+        (static_cast<std::uint32_t>(static_cast<unsigned char>(data[size - 1]))
+         << 8) |
+        (static_cast<std::uint32_t>(size) << 16);
+    return static_cast<std::uint32_t>(key * seed) >> (32 - keywordTableBits);
+}
+
+/// @brief Finds the first seed for which hashKeyword is injective over the
+/// keywords, or 0 if there is none
+constexpr std::uint32_t findKeywordSeed() {
+    for (std::uint32_t seed = 0x9E3779B1; seed != 0; seed += 2) {
+        bool used[1U << keywordTableBits] = {};
+        bool collision = false;
+        for (const Keyword &kw : keywords) {
+            const unsigned h =
+                hashKeyword(kw.text.data(), kw.text.size(), seed);
+            if (used[h]) {
+                collision = true;
+                break;
+            }
+            used[h] = true;
+        }
+        if (!collision) {
+            return seed;
+        }
+    }
+    return 0;
 }
 
-bool isDigit(char c) { return c >= '0' && c <= '9'; }
+constexpr std::uint32_t keywordSeed = findKeywordSeed();
 
-bool isAlnum(char c) { return isAlpha(c) || isDigit(c); }
+static_assert(keywordSeed != 0, "no perfect hash for the keywords");
 
-const std::unordered_map<std::string_view, lang::TokenKind> keywordToTokenKind =
-    {{"fn", lang::TokenKind::KwFn},
-     {"void", lang::TokenKind::KwVoid},
-     {"number", lang::TokenKind::KwNumber},
-     {"let", lang::TokenKind::KwLet},
-     {"var", lang::TokenKind::KwVar},
-     {"if", lang::TokenKind::KwIf},
-     {"else", lang::TokenKind::KwElse},
-     {"while", lang::TokenKind::KwWhile},
-     {"break", lang::TokenKind::KwBreak},
-     {"return", lang::TokenKind::KwReturn}};
+struct KeywordEntry {
+    std::string_view text;
+    lang::TokenKind kind = lang::TokenKind::Ident;
+};
+
+constexpr std::array<KeywordEntry, 1U << keywordTableBits>
+makeKeywordTable() {
+    std::array<KeywordEntry, 1U << keywordTableBits> table{};
+    for (const Keyword &kw : keywords) {
+        table[hashKeyword(kw.text.data(), kw.text.size(), keywordSeed)] = {
+            kw.text, kw.kind};
+    }
+    return table;
+}
+
+constexpr std::array<KeywordEntry, 1U << keywordTableBits> keywordTable =
+    makeKeywordTable();
+
+/// @brief Returns the keyword kind of an identifier, or TokenKind::Ident
+lang::TokenKind lookupKeyword(std::string_view ident) {
+    const KeywordEntry &entry = keywordTable[hashKeyword(
+        ident.data(), ident.size(), keywordSeed)];
+    if (entry.text.size() == ident.size() &&
+        std::memcmp(entry.text.data(), ident.data(), ident.size()) == 0) {
+        return entry.kind;
+    }
+    return lang::TokenKind::Ident;
+}
+
+// == Numbers ==
+
+/// @brief Powers of ten that are exactly representable as doubles
+constexpr std::array<double, 23> exactPowersOfTen = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
 
 } // namespace
 
@@ -46,140 +158,362 @@ JSONError LexError::toJSONError() const {
     return {span, "lex-unknown-error"};
 }
 
-// NOLINTNEXTLINE
-Token Lexer::lexAlt(char c, TokenKind altKind, TokenKind defaultKind) {
-    if (buffer[idx + 1] == c) {
-        idx += 2;
-        return {altKind, buffer.substr(idx - 2, 2)};
+const Token *Lexer::peek(std::size_t n) {
+    assert(n < maxLookahead && "lookahead exceeds the ring buffer");
+    while (count <= n) {
+        if (!lexToken(ring[(head + count) % maxLookahead])) {
+            return nullptr;
+        }
+        ++count;
     }
-    ++idx;
-    return {defaultKind, buffer.substr(idx - 1, 1)};
+    return &ring[(head + n) % maxLookahead];
+}
+
+std::optional<Token> Lexer::next() {
+    if (peek() == nullptr) {
+        return std::nullopt;
+    }
+    const Token token = ring[head];
+    head = (head + 1) % maxLookahead;
+    --count;
+    return token;
 }
 
 LexResult Lexer::lexAll(bool includeComments) {
-    LexResult result;
+    this->includeComments = includeComments;
 
-    while (idx != buffer.size()) {
-        while (isWhite(buffer[idx])) {
-            ++idx;
+    // NOTE: Sources average around four bytes per token, reserving up front
+    // avoids regrowing the token arrays on large inputs.
+    LexResult result(buffer);
+    result.tokens.reserve((buffer.size() - idx) / 4);
+    for (; count != 0; --count) {
+        result.tokens.push_back(ring[head]);
+        head = (head + 1) % maxLookahead;
+    }
+    Token token;
+    while (lexToken(token)) {
+        result.tokens.push_back(token);
+    }
+    result.errors = std::move(errors);
+
+    return result;
+}
+
+LexResult Lexer::lexAllParallel(unsigned numThreads, bool includeComments) {
+    assert(count == 0 && "lookahead tokens would be lost");
+
+    if (numThreads <= 1) {
+        return lexAll(includeComments);
+    }
+
+    const std::size_t size = buffer.size();
+    const std::size_t chunkSize = (size - idx) / numThreads + 1;
+
+    std::vector<std::size_t> bounds = {idx};
+    while (bounds.back() != size) {
+        std::size_t end = bounds.back() + chunkSize;
+        if (end >= size) {
+            end = size;
+        } else {
+            const void *newline =
+                std::memchr(buffer.data() + end, '\n', size - end);
+            end = newline == nullptr
+                      ? size
+                      : static_cast<const char *>(newline) - buffer.data() + 1;
         }
-        if (idx == buffer.size()) {
-            break;
+        bounds.push_back(end);
+    }
+
+    const std::size_t numChunks = bounds.size() - 1;
+    std::vector<std::optional<LexResult>> results(numChunks);
+    std::vector<SymbolTable> chunkSymbols(numChunks);
+    const auto lexChunk = [&](std::size_t i) {
+        // NOTE: Only the last chunk ends where the buffer does, so only it
+        // can rely on the padding
+        Lexer lexer(chunkSymbols[i], buffer.substr(0, bounds[i + 1]),
+                    bounds[i], isa, padded && i + 1 == numChunks);
+        results[i] = lexer.lexAll(includeComments);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks);
+    for (std::size_t i = 1; i < numChunks; ++i) {
+        threads.emplace_back(lexChunk, i);
+    }
+    if (numChunks != 0) {
+        lexChunk(0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    LexResult result(buffer);
+    std::size_t numTokens = 0;
+    for (const auto &chunk : results) {
+        numTokens += chunk->tokens.size();
+    }
+    result.tokens.reserve(numTokens);
+    result.errors = std::move(errors);
+    for (std::size_t i = 0; i < numChunks; ++i) {
+        auto &chunk = results[i];
+        chunk->tokens.remapSymbols(symbols->merge(chunkSymbols[i]));
+        result.tokens.append(chunk->tokens);
+        result.errors.insert(result.errors.end(), chunk->errors.begin(),
+                             chunk->errors.end());
+    }
+    idx = size;
+
+    return result;
+}
+
+LexResult Lexer::relex(LexResult previous,
+                       const std::vector<TextEdit> &edits,
+                       bool includeComments) {
+    assert(count == 0 && "lookahead tokens would be lost");
+    this->includeComments = includeComments;
+
+    // NOTE: The previous tokens are updated in place. Tokens before i are
+    // final, and the offsets of the tokens from i on are shifted by the
+    // distance between the buffers of the text after the edits spliced so
+    // far. delta is that distance for the edits lexed so far, which may run
+    // ahead of the splices.
+    TokenBuffer &tokens = previous.tokens;
+    const char *oldData = tokens.getBuffer().data();
+    const auto tokenEnd = [&](std::size_t i) -> std::ptrdiff_t {
+        return tokens.getOffset(i) + tokens.getLength(i);
+    };
+    std::size_t i = 0;
+    std::ptrdiff_t shift = 0;
+    std::ptrdiff_t delta = 0;
+
+    // NOTE: Errors are few, so the reused ones are copied instead, starting
+    // from the first previous error e not yet reused or discarded
+    const std::vector<LexError> &oldErrors = previous.errors;
+    const auto oldErrorOffset = [&](std::size_t e) -> std::ptrdiff_t {
+        return oldErrors[e].span.data() - oldData;
+    };
+    std::size_t e = 0;
+    const auto reuseErrors = [&](std::ptrdiff_t end) {
+        for (; e != oldErrors.size() && oldErrorOffset(e) < end; ++e) {
+            errors.emplace_back(oldErrors[e].kind,
+                                buffer.substr(oldErrorOffset(e) + delta,
+                                              oldErrors[e].span.size()));
         }
+    };
 
-        const std::size_t start = idx;
-        if (isAlpha(buffer[idx])) {
-            while (isAlnum(buffer[idx])) { // TokenKind::Ident
-                ++idx;
-            }
-            const std::string_view span = buffer.substr(start, idx - start);
-            const auto it = keywordToTokenKind.find(span);
-            if (it != keywordToTokenKind.end()) {
-                result.tokens.push_back({it->second, span});
+    TokenBuffer lexed(buffer);
+    for (std::size_t k = 0; k != edits.size(); ++k) {
+        // NOTE: The lexer reads at most one character past the end of a token,
+        // so the tokens that end before the edit are not affected by it
+        const std::ptrdiff_t editOffset =
+            static_cast<std::ptrdiff_t>(edits[k].offset) + delta;
+        std::size_t first = i;
+        for (std::size_t n = tokens.size() - i; n != 0;) {
+            const std::size_t half = n / 2;
+            if (tokenEnd(first + half) < editOffset) {
+                first += half + 1;
+                n -= half + 1;
             } else {
-                result.tokens.push_back({TokenKind::Ident, span});
+                n = half;
             }
-        } else if (isDigit(buffer[idx])) { // TokenKind::Number
-            while (isDigit(buffer[idx])) {
-                ++idx;
+        }
+        if (first != i) {
+            reuseErrors(tokenEnd(first - 1) - delta);
+        }
+        i = first;
+
+        idx = i == 0 ? 0 : static_cast<std::size_t>(tokenEnd(i - 1));
+        while (!errors.empty() &&
+               errors.back().span.data() >= buffer.data() + idx) {
+            errors.pop_back();
+        }
+
+        std::ptrdiff_t editEnd =
+            editOffset +
+            static_cast<std::ptrdiff_t>(edits[k].insertedText.size());
+        delta += static_cast<std::ptrdiff_t>(edits[k].insertedText.size()) -
+                 static_cast<std::ptrdiff_t>(edits[k].removedLength);
+
+        // NOTE: Lexing stops at the first token past the edit that starts at
+        // the same place as a previous token, from which point the previous
+        // tokens are known to be the same
+        std::size_t last = i;
+        bool converged = false;
+        lexed.clear();
+        Token token;
+        while (lexToken(token)) {
+            const std::ptrdiff_t start = token.span.data() - buffer.data();
+            // NOTE: Edits reached before converging are merged into this one
+            while (k + 1 != edits.size() &&
+                   start - delta >=
+                       static_cast<std::ptrdiff_t>(edits[k + 1].offset)) {
+                ++k;
+                editEnd =
+                    static_cast<std::ptrdiff_t>(edits[k].offset) + delta +
+                    static_cast<std::ptrdiff_t>(edits[k].insertedText.size());
+                delta +=
+                    static_cast<std::ptrdiff_t>(edits[k].insertedText.size()) -
+                    static_cast<std::ptrdiff_t>(edits[k].removedLength);
             }
-            if (buffer[idx] == '.') {
-                ++idx;
-                while (isDigit(buffer[idx])) {
-                    ++idx;
+            if (start >= editEnd) {
+                const std::ptrdiff_t target = start - delta + shift;
+                while (last != tokens.size() &&
+                       tokens.getOffset(last) < target) {
+                    ++last;
                 }
-                result.tokens.push_back(
-                    {TokenKind::Number, buffer.substr(start, idx - start)});
-            } else {
-                result.tokens.push_back(
-                    {TokenKind::Number, buffer.substr(start, idx - start)});
-            }
-        } else {
-            switch (buffer[idx]) {
-            case '/': // Comments and TokenKind::Slash
-                if (buffer[idx + 1] == '/') {
-                    idx += 2;
-                    while (idx < buffer.size() && buffer[idx] != '\n') {
-                        ++idx;
-                    }
-                    if (includeComments) {
-                        result.tokens.push_back(
-                            {TokenKind::Comment,
-                             buffer.substr(start, idx - start)});
+                if (last != tokens.size() && tokens.getOffset(last) == target) {
+                    converged = true;
+                    while (e != oldErrors.size() &&
+                           oldErrorOffset(e) < start - delta) {
+                        ++e;
                     }
-                } else {
-                    result.tokens.push_back(
-                        {TokenKind::Slash, buffer.substr(idx++, 1)});
+                    break;
                 }
-                break;
-            case '(':
-                result.tokens.push_back(
-                    {TokenKind::LParen, buffer.substr(idx++, 1)});
-                break;
-            case ')':
-                result.tokens.push_back(
-                    {TokenKind::RParen, buffer.substr(idx++, 1)});
-                break;
-            case '*':
-                result.tokens.push_back(
-                    {TokenKind::Star, buffer.substr(idx++, 1)});
-                break;
-            case '+':
-                result.tokens.push_back(
-                    {TokenKind::Plus, buffer.substr(idx++, 1)});
-                break;
-            case '-':
-                result.tokens.push_back(
-                    {TokenKind::Minus, buffer.substr(idx++, 1)});
-                break;
-            case ',':
-                result.tokens.push_back(
-                    {TokenKind::Comma, buffer.substr(idx++, 1)});
-                break;
-            case '.':
-                result.tokens.push_back(
-                    {TokenKind::Dot, buffer.substr(idx++, 1)});
-                break;
-            case ':':
-                result.tokens.push_back(
-                    {TokenKind::Colon, buffer.substr(idx++, 1)});
-                break;
-            case ';':
-                result.tokens.push_back(
-                    {TokenKind::Semicolon, buffer.substr(idx++, 1)});
-                break;
-            case '{':
-                result.tokens.push_back(
-                    {TokenKind::LBrace, buffer.substr(idx++, 1)});
-                break;
-            case '}':
-                result.tokens.push_back(
-                    {TokenKind::RBrace, buffer.substr(idx++, 1)});
-                break;
-            case '=':
-                result.tokens.push_back(
-                    lexAlt('=', TokenKind::EqualEqual, TokenKind::Equal));
-                break;
-            case '<':
-                result.tokens.push_back(
-                    lexAlt('=', TokenKind::LessEqual, TokenKind::Less));
-                break;
-            case '>':
-                result.tokens.push_back(
-                    lexAlt('=', TokenKind::GreaterEqual, TokenKind::Greater));
-                break;
-            case '&':
-                result.tokens.push_back(
-                    lexAlt('&', TokenKind::AmpAmp, TokenKind::Amp));
-                break;
-            default:
-                result.errors.emplace_back(LexErrorKind::InvalidCharacter,
-                                           buffer.substr(idx++, 1));
             }
+            lexed.push_back(token);
+        }
+
+        if (!converged) {
+            tokens.splice(i, tokens.size(), lexed, 0);
+            i = tokens.size();
+            e = oldErrors.size();
+            break;
+        }
+        tokens.splice(i, last, lexed, delta - shift);
+        i += lexed.size();
+        shift = delta;
+    }
+
+    reuseErrors(PTRDIFF_MAX);
+    tokens.setBuffer(buffer);
+    previous.errors = std::move(errors);
+    idx = buffer.size();
+
+    return previous;
+}
+
+double decodeNumber(std::string_view span) {
+    // NOTE: Literals are [0-9]+(\.[0-9]*)?. When the digits fit in the 53 bits
+    // of a double's significand and there are at most 22 of them after the
+    // dot, both the digits and the power of ten are exact doubles, so a
+    // single division rounds correctly (Clinger's fast path). Other literals
+    // fall back to std::from_chars, which is locale independent, does not
+    // allocate and rounds correctly too.
+    std::uint64_t digits = 0;
+    std::size_t numDigits = 0;
+    std::size_t numFractionDigits = 0;
+    bool fraction = false;
+    for (const char c : span) {
+        if (c == '.') {
+            fraction = true;
+            continue;
         }
+        digits = digits * 10 + static_cast<std::uint64_t>(c - '0');
+        ++numDigits;
+        numFractionDigits += fraction ? 1 : 0;
+    }
+    if (numDigits <= 19 && digits <= (std::uint64_t{1} << 53) &&
+        numFractionDigits < exactPowersOfTen.size()) {
+        return static_cast<double>(digits) /
+               exactPowersOfTen[numFractionDigits];
     }
 
+    double value = 0;
+    const auto [ptr, ec] =
+        std::from_chars(span.data(), span.data() + span.size(), value);
+    if (ec == std::errc::result_out_of_range) {
+        // NOTE: Literals have no exponent, so those whose integer part is
+        // zero underflow to zero, and the others overflow to infinity
+        const std::size_t first = span.find_first_not_of('0');
+        return first != std::string_view::npos && span[first] == '.'
+                   ? 0.0
+                   : std::numeric_limits<double>::infinity();
+    }
+    assert(ec == std::errc() && ptr == span.data() + span.size() &&
+           "invalid number literal");
+    return value;
+}
+
+std::string applyTextEdits(std::string_view buffer,
+                           const std::vector<TextEdit> &edits) {
+    std::string result;
+    result.reserve(buffer.size());
+    std::size_t pos = 0;
+    for (const TextEdit &edit : edits) {
+        assert(edit.offset >= pos &&
+               edit.offset + edit.removedLength <= buffer.size() &&
+               "edits out of order or out of bounds");
+        result.append(buffer.substr(pos, edit.offset - pos));
+        result.append(edit.insertedText);
+        pos = edit.offset + edit.removedLength;
+    }
+    result.append(buffer.substr(pos));
     return result;
 }
 
+bool Lexer::lexToken(Token &token) {
+    const char *data = buffer.data();
+    const std::size_t size = buffer.size();
+
+    while (idx != size) {
+        idx = scanner->skipWhite(data, idx, size);
+        if (idx == size) {
+            break;
+        }
+
+        const std::size_t start = idx;
+        switch (getCharClass(data[idx])) {
+        case CharClass::Alpha: { // TokenKind::Ident and keywords
+            idx = scanner->skipAlnum(data, idx + 1, size);
+            const std::string_view span = buffer.substr(start, idx - start);
+            const TokenKind kind = lookupKeyword(span);
+            token = kind == TokenKind::Ident
+                        ? Token(kind, span, symbols->intern(span))
+                        : Token(kind, span);
+            return true;
+        }
+
+        case CharClass::Digit: // TokenKind::Number
+            idx = scanner->skipDigits(data, idx + 1, size);
+            if (idx < size && data[idx] == '.') {
+                idx = scanner->skipDigits(data, idx + 1, size);
+            }
+            token = {TokenKind::Number, buffer.substr(start, idx - start)};
+            return true;
+
+        case CharClass::White:
+        case CharClass::Other: {
+            const PunctEntry &entry =
+                punctTable[static_cast<unsigned char>(data[idx])];
+            if (!entry.valid) {
+                errors.emplace_back(LexErrorKind::InvalidCharacter,
+                                    buffer.substr(idx++, 1));
+                break;
+            }
+            if (entry.follow == '\0' || idx + 1 == size ||
+                data[idx + 1] != entry.follow) {
+                token = {entry.kind, buffer.substr(idx++, 1)};
+                return true;
+            }
+            if (entry.followKind == TokenKind::Comment) {
+                idx = scanner->skipLine(data, idx + 2, size);
+                while (idx != size && data[idx] == '\0') {
+                    idx = scanner->skipLine(data, idx + 1, size);
+                }
+                if (!includeComments) {
+                    break;
+                }
+                token = {TokenKind::Comment, buffer.substr(start, idx - start)};
+                return true;
+            }
+            idx += 2;
+            token = {entry.followKind, buffer.substr(start, 2)};
+            return true;
+        }
+        }
+    }
+
+    return false;
+}
+
 } // namespace lang
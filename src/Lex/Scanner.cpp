@@ -0,0 +1,247 @@
+#include "Lex/Scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LANG_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool isLineChar(char c) { return c != '\n' && c != '\0'; }
+
+template <bool (*Pred)(char)>
+std::size_t skipScalar(const char *data, std::size_t idx, std::size_t size) {
+    while (idx < size && Pred(data[idx])) {
+        ++idx;
+    }
+    return idx;
+}
+
+template <bool (*Pred)(char)>
+std::size_t skipPaddedScalar(const char *data, std::size_t idx,
+                             std::size_t size) {
+    while (Pred(data[idx])) {
+        ++idx;
+    }
+    return idx;
+}
+
+#ifdef LANG_SCANNER_X86
+
+// NOTE: The vector routines compute a mask with one bit set per byte that
+// satisfies the predicate. The first clear bit is the end of the run. Bytes
+// outside the ASCII range are negative as signed chars, which makes the signed
+// range comparisons below reject them.
+
+__attribute__((target("sse2"))) __m128i inRangeSSE2(__m128i v, char lo,
+                                                    char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+__attribute__((target("sse2"))) __m128i isWhiteSSE2(__m128i v) {
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+}
+
+__attribute__((target("sse2"))) __m128i isAlnumSSE2(__m128i v) {
+    const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(inRangeSSE2(lower, 'a', 'z'),
+                        inRangeSSE2(v, '0', '9'));
+}
+
+__attribute__((target("sse2"))) __m128i isDigitSSE2(__m128i v) {
+    return inRangeSSE2(v, '0', '9');
+}
+
+__attribute__((target("sse2"))) __m128i isLineCharSSE2(__m128i v) {
+    return _mm_xor_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                      _mm_cmpeq_epi8(v, _mm_setzero_si128())),
+                         _mm_set1_epi8(-1));
+}
+
+__attribute__((target("sse2"))) unsigned
+endMaskSSE2(__m128i (*pred)(__m128i), const char *data) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    return ~_mm_movemask_epi8(pred(v)) & 0xFFFFU;
+}
+
+template <__m128i (*Pred)(__m128i), bool (*Tail)(char)>
+__attribute__((target("sse2"))) std::size_t
+skipSSE2(const char *data, std::size_t idx, std::size_t size) {
+    while (idx + 16 <= size) {
+        const unsigned mask = endMaskSSE2(Pred, data + idx);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+        idx += 16;
+    }
+    return skipScalar<Tail>(data, idx, size);
+}
+
+template <__m128i (*Pred)(__m128i)>
+__attribute__((target("sse2"))) std::size_t
+skipPaddedSSE2(const char *data, std::size_t idx, std::size_t size) {
+    for (;; idx += 16) {
+        const unsigned mask = endMaskSSE2(Pred, data + idx);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) __m256i inRangeAVX2(__m256i v, char lo,
+                                                    char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("avx2"))) __m256i isWhiteAVX2(__m256i v) {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+}
+
+__attribute__((target("avx2"))) __m256i isAlnumAVX2(__m256i v) {
+    const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(inRangeAVX2(lower, 'a', 'z'),
+                           inRangeAVX2(v, '0', '9'));
+}
+
+__attribute__((target("avx2"))) __m256i isDigitAVX2(__m256i v) {
+    return inRangeAVX2(v, '0', '9');
+}
+
+__attribute__((target("avx2"))) __m256i isLineCharAVX2(__m256i v) {
+    return _mm256_xor_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                        _mm256_cmpeq_epi8(v, _mm256_setzero_si256())),
+        _mm256_set1_epi8(-1));
+}
+
+__attribute__((target("avx2"))) unsigned
+endMaskAVX2(__m256i (*pred)(__m256i), const char *data) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    return ~static_cast<unsigned>(_mm256_movemask_epi8(pred(v)));
+}
+
+template <__m256i (*Pred)(__m256i), bool (*Tail)(char)>
+__attribute__((target("avx2"))) std::size_t
+skipAVX2(const char *data, std::size_t idx, std::size_t size) {
+    while (idx + 32 <= size) {
+        const unsigned mask = endMaskAVX2(Pred, data + idx);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+        idx += 32;
+    }
+    return skipScalar<Tail>(data, idx, size);
+}
+
+template <__m256i (*Pred)(__m256i)>
+__attribute__((target("avx2"))) std::size_t
+skipPaddedAVX2(const char *data, std::size_t idx, std::size_t size) {
+    for (;; idx += 32) {
+        const unsigned mask = endMaskAVX2(Pred, data + idx);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+}
+
+#endif // LANG_SCANNER_X86
+
+const lang::Scanner scalarScanner = {
+    skipScalar<lang::isWhite>,
+    skipScalar<lang::isAlnum>,
+    skipScalar<lang::isDigit>,
+    skipScalar<isLineChar>,
+};
+
+const lang::Scanner paddedScalarScanner = {
+    skipPaddedScalar<lang::isWhite>,
+    skipPaddedScalar<lang::isAlnum>,
+    skipPaddedScalar<lang::isDigit>,
+    skipPaddedScalar<isLineChar>,
+};
+
+#ifdef LANG_SCANNER_X86
+
+const lang::Scanner sse2Scanner = {
+    skipSSE2<isWhiteSSE2, lang::isWhite>,
+    skipSSE2<isAlnumSSE2, lang::isAlnum>,
+    skipSSE2<isDigitSSE2, lang::isDigit>,
+    skipSSE2<isLineCharSSE2, isLineChar>,
+};
+
+const lang::Scanner paddedSSE2Scanner = {
+    skipPaddedSSE2<isWhiteSSE2>,
+    skipPaddedSSE2<isAlnumSSE2>,
+    skipPaddedSSE2<isDigitSSE2>,
+    skipPaddedSSE2<isLineCharSSE2>,
+};
+
+const lang::Scanner avx2Scanner = {
+    skipAVX2<isWhiteAVX2, lang::isWhite>,
+    skipAVX2<isAlnumAVX2, lang::isAlnum>,
+    skipAVX2<isDigitAVX2, lang::isDigit>,
+    skipAVX2<isLineCharAVX2, isLineChar>,
+};
+
+const lang::Scanner paddedAVX2Scanner = {
+    skipPaddedAVX2<isWhiteAVX2>,
+    skipPaddedAVX2<isAlnumAVX2>,
+    skipPaddedAVX2<isDigitAVX2>,
+    skipPaddedAVX2<isLineCharAVX2>,
+};
+
+#endif // LANG_SCANNER_X86
+
+} // namespace
+
+namespace lang {
+
+ScanISA getHostScanISA() {
+#ifdef LANG_SCANNER_X86
+    static const ScanISA hostISA = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return ScanISA::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return ScanISA::SSE2;
+        }
+        return ScanISA::Scalar;
+    }();
+    return hostISA;
+#else
+    return ScanISA::Scalar;
+#endif
+}
+
+ScanISA clampScanISA(ScanISA isa) {
+    const ScanISA hostISA = getHostScanISA();
+    return static_cast<int>(isa) <= static_cast<int>(hostISA) ? isa : hostISA;
+}
+
+const Scanner &Scanner::get(ScanISA isa, bool padded) {
+#ifdef LANG_SCANNER_X86
+    switch (clampScanISA(isa)) {
+    case ScanISA::Scalar:
+        return padded ? paddedScalarScanner : scalarScanner;
+    case ScanISA::SSE2:
+        return padded ? paddedSSE2Scanner : sse2Scanner;
+    case ScanISA::AVX2:
+        return padded ? paddedAVX2Scanner : avx2Scanner;
+    }
+#endif
+    return padded ? paddedScalarScanner : scalarScanner;
+}
+
+} // namespace lang
@@ -38,7 +38,7 @@ std::string tokenKindToString(TokenKind kind) {
     case TokenKind::GreaterEqual:
         return "'>='";
     case TokenKind::PipePipe:
-        return "||";
+        return "'||'";
     case TokenKind::KwFn:
         return "'fn'";
     case TokenKind::KwVoid:
@@ -1,25 +1,39 @@
 #include "Parse/Parser.h"
 
-#include <unordered_map>
+#include "Alloc/ArenaGroup.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+#include <exception>
+#include <thread>
 
 namespace {
 
+/// @brief Tokens the parser skips to after an error in a declaration
+constexpr lang::TokenKindSet declLevelSyncSet = {
+    lang::TokenKind::KwFn,
+};
+
+/// @brief Tokens the parser skips to after an error in a statement
+constexpr lang::TokenKindSet stmtLevelSyncSet = {
+    lang::TokenKind::Semicolon,
+    lang::TokenKind::RBrace,
+};
+
 struct BinOpPair {
     lang::BinOpKind bind;
     int precLHS;
     int precRHS;
 };
 
-const std::unordered_set<lang::TokenKind> declLevelSyncSet = {
-    lang::TokenKind::KwFn,
-};
-
-const std::unordered_set<lang::TokenKind> stmtLevelSyncSet = {
-    lang::TokenKind::Semicolon,
-    lang::TokenKind::RBrace,
+struct BinOpEntry {
+    lang::TokenKind kind;
+    BinOpPair pair;
 };
 
-const std::unordered_map<lang::TokenKind, BinOpPair> binOpMap = {
+/// @brief The binary operators, this is the only place their precedence is
+/// defined
+constexpr BinOpEntry binOps[] = {
     // Multiplication and division (highest precedence)
     {lang::TokenKind::Star, {lang::BinOpKind::Mul, 6, 6}},
     {lang::TokenKind::Slash, {lang::BinOpKind::Div, 6, 6}},
@@ -46,20 +60,33 @@ const std::unordered_map<lang::TokenKind, BinOpPair> binOpMap = {
     {lang::TokenKind::PipePipe, {lang::BinOpKind::Or, 1, 1}},
 };
 
+/// @brief Builds the table of binOps indexed by token kind
+/// @note Token kinds that are not binary operators get a precLHS of 0, which
+/// never binds because parseExprAST is never called with a negative
+/// precedence.
+constexpr std::array<BinOpPair, lang::numTokenKinds> makeBinOpTable() {
+    std::array<BinOpPair, lang::numTokenKinds> table{};
+    for (auto &pair : table) {
+        pair = {lang::BinOpKind::Add, 0, 0};
+    }
+    for (const BinOpEntry &entry : binOps) {
+        table[lang::tokenKindIndex(entry.kind)] = entry.pair;
+    }
+    return table;
+}
+
+constexpr std::array<BinOpPair, lang::numTokenKinds> binOpTable =
+    makeBinOpTable();
+
 } // namespace
 
 #define EXPECT(kind)                                                           \
-    if (expect(kind) == nullptr) {                                             \
+    if (!expect(kind)) {                                                       \
         return nullptr;                                                        \
     }
 
-#define BREAK_IF_NULL(expr)                                                    \
-    if ((expr) == nullptr) {                                                   \
-        break;                                                                 \
-    }
-
 #define RETURN_IF_NULL(expr)                                                   \
-    if ((expr) == nullptr) {                                                   \
+    if (!(expr)) {                                                             \
         return nullptr;                                                        \
     }
 
@@ -71,7 +98,7 @@ TextError ParseError::toTextError() const {
         return {span, "Unexpected end of file", "Unexpected end of file"};
     case ParseErrorKind::UnexpectedToken:
         return {span, "Unexpected token",
-                "Expected " + tokenKindToString(expected) + " instead"};
+                "Expected " + tokenKindToString(*expected) + " instead"};
     case ParseErrorKind::ExpectedType:
         return {span, "Unexpected token", "Expected a type instead"};
     case ParseErrorKind::ExpectedPrimaryExpression:
@@ -95,110 +122,251 @@ JSONError ParseError::toJSONError() const {
     return {span, "parser-unknown-error"};
 }
 
-const Token *Parser::peek() {
-    if (cur == end) {
-        return nullptr;
+std::optional<Token> Parser::peek(std::size_t n) {
+    if (tokens != nullptr) {
+        if (pos + n >= end) {
+            return std::nullopt;
+        }
+        return (*tokens)[pos + n];
+    }
+    const Token *tok = lexer->peek(n);
+    if (tok == nullptr) {
+        return std::nullopt;
     }
-    return &*cur;
+    return *tok;
 }
 
-const Token *Parser::next() {
-    if (cur == end) {
-        return nullptr;
+std::optional<Token> Parser::next() {
+    std::optional<Token> tok;
+    if (tokens != nullptr) {
+        if (pos != end) {
+            tok = (*tokens)[pos++];
+        }
+    } else {
+        tok = lexer->next();
     }
-    return &*cur++;
+    if (tok) {
+        prevSpan = tok->span;
+    }
+    return tok;
 }
 
-const Token *Parser::expect(TokenKind kind) {
-    const Token *tok = peek();
+std::optional<Token> Parser::expect(TokenKind kind) {
+    const auto tok = next();
     if (!tok) {
-        errors.emplace_back(ParseErrorKind::UnexpectedEOF, std::prev(cur)->span,
-                            kind);
-        return nullptr;
+        errors.emplace_back(ParseErrorKind::UnexpectedEOF, prevSpan, kind);
+        return std::nullopt;
     }
 
-    ++cur;
-
     if (tok->kind != kind) {
         errors.emplace_back(ParseErrorKind::UnexpectedToken, tok->span, kind);
-        return nullptr;
+        return std::nullopt;
     }
 
     return tok;
 }
 
-void Parser::sync(const std::unordered_set<TokenKind> &syncSet) {
-    cur = std::find_if(cur, end, [&syncSet](const Token &token) {
-        return syncSet.find(token.kind) != syncSet.end();
-    });
+void Parser::sync(TokenKindSet syncSet) {
+    const auto skipUntilSyncSet = [&]() {
+        auto tok = peek();
+        while (tok && !syncSet.contains(tok->kind)) {
+            next();
+            tok = peek();
+        }
+    };
+
+    skipUntilSyncSet();
 
     // Return if we are at end or end - 1
-    if (cur == end || cur + 1 == end) {
+    if (!peek() || !peek(1)) {
         return;
     }
 
-    ++cur;
-    cur = std::find_if(cur, end, [&syncSet](const Token &token) {
-        return syncSet.find(token.kind) != syncSet.end();
-    });
+    next();
+    skipUntilSyncSet();
 }
 
 ParseResult Parser::parseModuleAST() {
-    NonOwningList<DeclAST *> decls;
+    std::vector<ArenaRef<DeclAST>> decls;
+    parseDeclASTs(decls);
+
+    return {arena->alloc<ModuleAST>("main", buffer, ArenaArray(*arena, decls),
+                                     deferBodies ? this : nullptr),
+            std::move(errors)};
+}
+
+ParseResult Parser::parseModuleASTParallel(unsigned numThreads) {
+    assert(tokens != nullptr && "parallel parsing needs lexed tokens");
+
+    if (numThreads <= 1 || pos == end) {
+        return parseModuleAST();
+    }
+
+    // NOTE: Every function declaration starts with a fn keyword outside of
+    // any braces, which splits the tokens into one range per function
+    std::vector<std::size_t> bounds = {pos};
+    std::size_t depth = 0;
+    for (std::size_t i = pos; i < end; ++i) {
+        switch (tokens->getKind(i)) {
+        case TokenKind::LBrace:
+            ++depth;
+            break;
+        case TokenKind::RBrace:
+            depth -= depth != 0 ? 1 : 0;
+            break;
+        case TokenKind::KwFn:
+            if (depth == 0 && i != pos) {
+                bounds.push_back(i);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    bounds.push_back(end);
+
+    // NOTE: Every thread parses a run of consecutive ranges into an arena of
+    // its own, and stops at the first range that does not parse into exactly
+    // one function without errors
+    const std::size_t numRanges = bounds.size() - 1;
+    const std::size_t numTokens = end - pos;
+    std::vector<FunctionDeclAST *> functions(numRanges, nullptr);
+    std::vector<std::size_t> runs = {0};
+    for (unsigned i = 1; i <= numThreads; ++i) {
+        const std::size_t target = pos + numTokens * i / numThreads;
+        std::size_t range = runs.back();
+        while (range != numRanges && bounds[range] < target) {
+            ++range;
+        }
+        if (range != runs.back()) {
+            runs.push_back(range);
+        }
+    }
+
+    // NOTE: A worker that throws, such as when the arenas run out of space,
+    // hands its exception over to be rethrown once every worker is joined
+    const std::size_t numRuns = runs.size() - 1;
+    ArenaGroup arenas(*arena, numRuns);
+    std::vector<std::exception_ptr> exceptions(numRuns);
+    const auto parseRun = [&](std::size_t run) {
+        Arena &runArena = arenas.getWorker(run);
+        Parser parser(runArena, *typeCtx, *tokens);
+        parser.deferBodies = deferBodies;
+        for (std::size_t i = runs[run]; i != runs[run + 1]; ++i) {
+            parser.pos = bounds[i];
+            parser.end = bounds[i + 1];
+            const Arena::Mark mark = runArena.mark();
+            FunctionDeclAST *function = parser.parseFunctionDeclAST();
+            if (function == nullptr || !parser.errors.empty() ||
+                parser.pos != parser.end) {
+                runArena.rollback(mark);
+                break;
+            }
+            functions[i] = function;
+        }
+    };
+    const auto runWorker = [&](std::size_t run) {
+        try {
+            parseRun(run);
+        } catch (...) {
+            exceptions[run] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numRuns);
+    for (std::size_t i = 1; i < numRuns; ++i) {
+        threads.emplace_back(runWorker, i);
+    }
+    if (numRuns != 0) {
+        runWorker(0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr &exception : exceptions) {
+        if (exception != nullptr) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    arenas.merge();
+
+    // NOTE: From the first range that failed on, the serial parser takes
+    // over, which recovers from the errors exactly as if it had parsed the
+    // module from the start
+    std::vector<ArenaRef<DeclAST>> decls;
+    std::size_t range = 0;
+    for (; range != numRanges && functions[range] != nullptr; ++range) {
+        decls.push_back(functions[range]);
+    }
+    if (range != 0) {
+        pos = bounds[range];
+        prevSpan = tokens->getSpan(pos - 1);
+    }
+    parseDeclASTs(decls);
+
+    return {arena->alloc<ModuleAST>("main", buffer, ArenaArray(*arena, decls),
+                                     deferBodies ? this : nullptr),
+            std::move(errors)};
+}
+
+void Parser::parseDeclASTs(std::vector<ArenaRef<DeclAST>> &decls) {
     DeclAST *decl = nullptr;
 
-    const Token *tok = peek();
-    while (tok != nullptr) {
+    auto tok = peek();
+    while (tok) {
         switch (tok->kind) {
-        case TokenKind::KwFn:
+        case TokenKind::KwFn: {
+            // NOTE: The nodes of a function that fails to parse are freed
+            const Arena::Mark mark = arena->mark();
             decl = parseFunctionDeclAST();
 
             if (decl != nullptr) {
-                decls.emplace_back(arena, decl);
+                decls.push_back(decl);
             } else {
+                arena->rollback(mark);
                 sync(declLevelSyncSet);
             }
 
-            break;
+        } break;
 
         default:
-            ++cur;
+            next();
             errors.emplace_back(ParseErrorKind::UnexpectedToken, tok->span,
                                 TokenKind::KwFn);
         }
 
         tok = peek();
     }
-
-    return {arena->alloc<ModuleAST>("main", decls), std::move(errors)};
 }
 
 FunctionDeclAST *Parser::parseFunctionDeclAST() {
     EXPECT(TokenKind::KwFn);
 
-    const Token *ident = expect(TokenKind::Ident);
+    const auto ident = expect(TokenKind::Ident);
     RETURN_IF_NULL(ident);
 
     EXPECT(TokenKind::LParen);
 
-    NonOwningList<LocalStmtAST *> params;
+    llvm::SmallVector<ArenaRef<LocalStmtAST>, 8> paramScratch;
     LocalStmtAST *param = nullptr;
 
-    const Token *tok = peek();
-    while (tok != nullptr && tok->kind != TokenKind::RParen) {
+    auto tok = peek();
+    while (tok && tok->kind != TokenKind::RParen) {
         param = parseLocalStmtAST(true);
         RETURN_IF_NULL(param);
 
-        params.emplace_back(arena, param);
+        paramScratch.push_back(param);
 
         tok = peek();
         RETURN_IF_NULL(tok);
 
-        if (tok == nullptr || tok->kind != TokenKind::Comma) {
+        if (!tok || tok->kind != TokenKind::Comma) {
             break;
         }
 
-        ++cur;
+        next();
         tok = peek();
     }
 
@@ -208,14 +376,81 @@ FunctionDeclAST *Parser::parseFunctionDeclAST() {
     Type *type = parseTypeAnnotation();
     RETURN_IF_NULL(type);
 
+    const ArenaArray params(*arena, paramScratch);
+
+    // NOTE: A body whose braces do not match is parsed right away, which
+    // reports the error
+    const std::size_t bodyBegin = pos;
+    if (deferBodies && skipBlock()) {
+        return arena->alloc<FunctionDeclAST>(
+            toSpan(ident->span), ident->symbol, params, type,
+            static_cast<std::uint32_t>(bodyBegin),
+            static_cast<std::uint32_t>(pos));
+    }
+
     BlockStmtAST *body = parseBlockStmtAST();
     RETURN_IF_NULL(body);
 
-    return arena->alloc<FunctionDeclAST>(ident->span, params, type, body);
+    return arena->alloc<FunctionDeclAST>(toSpan(ident->span), ident->symbol,
+                                         params, type, body);
+}
+
+bool Parser::skipBlock() {
+    if (pos == end || tokens->getKind(pos) != TokenKind::LBrace) {
+        return false;
+    }
+
+    std::size_t depth = 0;
+    for (std::size_t i = pos; i < end; ++i) {
+        switch (tokens->getKind(i)) {
+        case TokenKind::LBrace:
+            ++depth;
+            break;
+        case TokenKind::RBrace:
+            if (--depth == 0) {
+                pos = i + 1;
+                prevSpan = tokens->getSpan(i);
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+BlockStmtAST *Parser::parseBody(const FunctionDeclAST &node) {
+    const std::size_t prevPos = pos;
+    const std::size_t prevEnd = end;
+    const std::string_view prevPrevSpan = prevSpan;
+    const std::size_t numErrors = errors.size();
+
+    pos = node.bodyBegin;
+    end = node.bodyEnd;
+    const Arena::Mark mark = arena->mark();
+    BlockStmtAST *body = parseBlockStmtAST();
+
+    deferredErrors.insert(deferredErrors.end(), errors.begin() + numErrors,
+                          errors.end());
+    errors.erase(errors.begin() + numErrors, errors.end());
+    pos = prevPos;
+    end = prevEnd;
+    prevSpan = prevPrevSpan;
+
+    // NOTE: Passes visit the body of every function, so a body that failed
+    // to parse is replaced by an empty one. Its errors are reported instead.
+    if (body == nullptr) {
+        arena->rollback(mark);
+        body = arena->alloc<BlockStmtAST>(
+            toSpan(tokens->getSpan(node.bodyBegin)), NodeArray<StmtAST>());
+    }
+    return body;
 }
 
 Type *Parser::parseTypeAnnotation() {
-    const Token *tok = next();
+    const auto tok = next();
     RETURN_IF_NULL(tok);
 
     switch (tok->kind) {
@@ -224,99 +459,207 @@ Type *Parser::parseTypeAnnotation() {
     case TokenKind::KwNumber:
         return typeCtx->getTypeNumber();
     default:
-        errors.emplace_back(ParseErrorKind::ExpectedType, tok->span,
-                            TokenKind::Amp);
+        errors.emplace_back(ParseErrorKind::ExpectedType, tok->span);
     }
 
     return nullptr;
 }
 
 BlockStmtAST *Parser::parseBlockStmtAST() {
-    const Token *lBrace = expect(TokenKind::LBrace);
-    RETURN_IF_NULL(lBrace);
-
-    NonOwningList<StmtAST *> stmts;
-    StmtAST *stmt = nullptr;
+    // NOTE: Nested blocks, ifs and whiles push a frame instead of recursing,
+    // which bounds the native stack whatever the nesting depth. A null result
+    // aborts the innermost statement, exactly as a recursive descent would.
+    enum class State {
+        OpenBlock,
+        OpenIf,
+        OpenWhile,
+        NextStmt,
+        AddStmt,
+        Return,
+    };
+
+    const std::size_t base = stmtFrames.size();
+    State state = State::OpenBlock;
+    StmtAST *result = nullptr;
+
+    while (true) {
+        switch (state) {
+        case State::OpenBlock: {
+            const auto lBrace = expect(TokenKind::LBrace);
+            if (!lBrace) {
+                result = nullptr;
+                state = State::Return;
+                break;
+            }
+            stmtFrames.emplace_back(StmtFrame::Kind::Block, lBrace->span);
+            stmtFrames.back().stmtsBegin = stmtScratch.size();
+            state = State::NextStmt;
+        } break;
 
-    const Token *tok = peek();
-    while (tok != nullptr && tok->kind != TokenKind::RBrace) {
-        switch (tok->kind) {
-        case TokenKind::LBrace:
-            stmt = parseBlockStmtAST();
-            break;
+        case State::OpenIf:
+        case State::OpenWhile: {
+            const bool isIf = state == State::OpenIf;
+            const auto tok =
+                expect(isIf ? TokenKind::KwIf : TokenKind::KwWhile);
+            ExprAST *cond = tok ? parseExprAST() : nullptr;
+            if (cond == nullptr) {
+                result = nullptr;
+                state = State::Return;
+                break;
+            }
+            stmtFrames.emplace_back(isIf ? StmtFrame::Kind::If
+                                         : StmtFrame::Kind::While,
+                                    tok->span, cond);
+            state = State::OpenBlock;
+        } break;
 
-        case TokenKind::KwBreak:
-            ++cur;
-            stmt = arena->alloc<BreakStmtAST>(tok->span);
-            EXPECT(TokenKind::Semicolon);
-            break;
+        case State::NextStmt: {
+            const auto tok = peek();
+            if (!tok || tok->kind == TokenKind::RBrace) {
+                const StmtFrame frame = stmtFrames.back();
+                stmtFrames.pop_back();
+                result = nullptr;
+                if (expect(TokenKind::RBrace)) {
+                    const ArenaArray stmts(
+                        *arena, stmtScratch.data() + frame.stmtsBegin,
+                        stmtScratch.size() - frame.stmtsBegin);
+                    result =
+                        arena->alloc<BlockStmtAST>(toSpan(frame.span), stmts);
+                }
+                stmtScratch.resize(frame.stmtsBegin);
+                state = State::Return;
+                break;
+            }
 
-        case TokenKind::KwReturn:
-            ++cur;
-            stmt = arena->alloc<ReturnStmtAST>(
-                tok->span, cur != end && cur->kind != TokenKind::Semicolon
-                               ? parseExprAST()
-                               : nullptr);
-            EXPECT(TokenKind::Semicolon);
-            break;
+            // NOTE: A statement whose terminating semicolon is missing
+            // aborts the whole block
+            stmtFrames.back().stmtMark = arena->mark();
+            bool needsSemicolon = false;
+            result = nullptr;
+            state = State::AddStmt;
+            switch (tok->kind) {
+            case TokenKind::LBrace:
+                state = State::OpenBlock;
+                break;
+
+            case TokenKind::KwBreak:
+                next();
+                result = arena->alloc<BreakStmtAST>(toSpan(tok->span));
+                needsSemicolon = true;
+                break;
+
+            case TokenKind::KwReturn: {
+                next();
+                const auto exprTok = peek();
+                result = arena->alloc<ReturnStmtAST>(
+                    toSpan(tok->span),
+                    exprTok && exprTok->kind != TokenKind::Semicolon
+                        ? parseExprAST()
+                        : nullptr);
+                needsSemicolon = true;
+            } break;
+
+            case TokenKind::KwLet:
+            case TokenKind::KwVar:
+                next();
+                result = parseLocalStmtAST(tok->kind == TokenKind::KwLet);
+                needsSemicolon = result != nullptr;
+                break;
+
+            case TokenKind::KwIf:
+                state = State::OpenIf;
+                break;
+
+            case TokenKind::KwWhile:
+                state = State::OpenWhile;
+                break;
+
+            default:
+                result = parseExprStmtOrAssignStmtAST();
+            }
 
-        case TokenKind::KwLet:
-            ++cur;
+            if (needsSemicolon && !expect(TokenKind::Semicolon)) {
+                stmtScratch.resize(stmtFrames.back().stmtsBegin);
+                stmtFrames.pop_back();
+                result = nullptr;
+                state = State::Return;
+            }
+        } break;
 
-            stmt = parseLocalStmtAST(true);
-            BREAK_IF_NULL(stmt);
+        case State::AddStmt: {
+            if (result != nullptr) {
+                stmtScratch.push_back(result);
+            } else {
+                arena->rollback(stmtFrames.back().stmtMark);
+                sync(stmtLevelSyncSet);
+                next();
+            }
+            state = State::NextStmt;
+        } break;
 
-            EXPECT(TokenKind::Semicolon);
-            break;
+        case State::Return: {
+            if (stmtFrames.size() == base) {
+                return static_cast<BlockStmtAST *>(result);
+            }
 
-        case TokenKind::KwVar:
-            ++cur;
+            StmtFrame &frame = stmtFrames.back();
+            switch (frame.kind) {
+            case StmtFrame::Kind::Block:
+                state = State::AddStmt;
+                break;
 
-            stmt = parseLocalStmtAST(false);
-            BREAK_IF_NULL(stmt);
+            case StmtFrame::Kind::If:
+                if (result == nullptr) {
+                    stmtFrames.pop_back();
+                    break;
+                }
 
-            EXPECT(TokenKind::Semicolon);
-            break;
+                if (frame.thenStmt == nullptr) {
+                    frame.thenStmt = static_cast<BlockStmtAST *>(result);
 
-        case TokenKind::KwIf:
-            stmt = parseIfStmtAST();
-            break;
+                    const auto elseToken = peek();
+                    if (elseToken && elseToken->kind == TokenKind::KwElse) {
+                        next();
 
-        case TokenKind::KwWhile:
-            stmt = parseWhileStmtAST();
-            break;
+                        const auto ifToken = peek();
+                        state = ifToken && ifToken->kind == TokenKind::KwIf
+                                    ? State::OpenIf
+                                    : State::OpenBlock;
+                        break;
+                    }
+                    result = nullptr;
+                }
 
-        default:
-            stmt = parseExprStmtOrAssignStmtAST();
-        }
+                result = arena->alloc<IfStmtAST>(
+                    toSpan(frame.span), frame.cond, frame.thenStmt, result);
+                stmtFrames.pop_back();
+                break;
 
-        if (stmt != nullptr) {
-            stmts.emplace_back(arena, stmt);
-            stmt = nullptr;
-        } else {
-            sync(stmtLevelSyncSet);
-            next();
+            case StmtFrame::Kind::While:
+                if (result != nullptr) {
+                    result = arena->alloc<WhileStmtAST>(
+                        toSpan(frame.span), frame.cond,
+                        static_cast<BlockStmtAST *>(result));
+                }
+                stmtFrames.pop_back();
+                break;
+            }
+        } break;
         }
-
-        tok = peek();
     }
-
-    EXPECT(TokenKind::RBrace);
-
-    return arena->alloc<BlockStmtAST>(lBrace->span, stmts);
 }
 
 LocalStmtAST *Parser::parseLocalStmtAST(bool isConst) {
-    const Token *ident = expect(TokenKind::Ident);
+    const auto ident = expect(TokenKind::Ident);
     RETURN_IF_NULL(ident);
 
     Type *type = nullptr;
 
-    const Token *tok = peek();
+    auto tok = peek();
     RETURN_IF_NULL(tok);
 
     if (tok->kind == TokenKind::Colon) {
-        ++cur;
+        next();
 
         type = parseTypeAnnotation();
         RETURN_IF_NULL(type);
@@ -328,178 +671,258 @@ LocalStmtAST *Parser::parseLocalStmtAST(bool isConst) {
     RETURN_IF_NULL(tok);
 
     if (tok->kind == TokenKind::Equal) {
-        ++cur;
+        next();
 
         init = parseExprAST();
         RETURN_IF_NULL(init);
     }
 
-    return arena->alloc<LocalStmtAST>(isConst, ident->span, type, init);
-}
-
-IfStmtAST *Parser::parseIfStmtAST() {
-    const Token *tok = expect(TokenKind::KwIf);
-    RETURN_IF_NULL(tok);
-
-    ExprAST *cond = parseExprAST();
-    RETURN_IF_NULL(cond);
-
-    BlockStmtAST *thenStmt = parseBlockStmtAST();
-    RETURN_IF_NULL(thenStmt);
-
-    StmtAST *elseStmt = nullptr;
-
-    const Token *elseToken = peek();
-    if (elseToken != nullptr && elseToken->kind == TokenKind::KwElse) {
-        ++cur;
-
-        const Token *ifToken = peek();
-        if (ifToken != nullptr && ifToken->kind == TokenKind::KwIf) {
-            elseStmt = parseIfStmtAST();
-        } else {
-            elseStmt = parseBlockStmtAST();
-        }
-
-        RETURN_IF_NULL(elseStmt);
-    }
-
-    return arena->alloc<IfStmtAST>(tok->span, cond, thenStmt, elseStmt);
-}
-
-WhileStmtAST *Parser::parseWhileStmtAST() {
-    const Token *tok = expect(TokenKind::KwWhile);
-    RETURN_IF_NULL(tok);
-
-    ExprAST *cond = parseExprAST();
-    RETURN_IF_NULL(cond);
-
-    BlockStmtAST *body = parseBlockStmtAST();
-    RETURN_IF_NULL(body);
-
-    return arena->alloc<WhileStmtAST>(tok->span, cond, body);
+    return arena->alloc<LocalStmtAST>(isConst, toSpan(ident->span),
+                                      ident->symbol, type, init);
 }
 
 StmtAST *Parser::parseExprStmtOrAssignStmtAST() {
     ExprAST *lhs = parseExprAST();
     RETURN_IF_NULL(lhs);
 
-    const Token *tok = next();
+    const auto tok = next();
     RETURN_IF_NULL(tok);
 
     switch (tok->kind) {
     case TokenKind::Semicolon:
-        return arena->alloc<ExprStmtAST>(tok->span, lhs);
+        return arena->alloc<ExprStmtAST>(toSpan(tok->span), lhs);
 
     case TokenKind::Equal: {
         ExprAST *rhs = parseExprAST();
         RETURN_IF_NULL(rhs);
 
         EXPECT(TokenKind::Semicolon);
-        return arena->alloc<AssignStmtAST>(tok->span, lhs, rhs);
+        return arena->alloc<AssignStmtAST>(toSpan(tok->span), lhs, rhs);
 
     } break;
     default:
         errors.emplace_back(ParseErrorKind::ExpectedPrimaryExpression,
-                            tok->span, TokenKind::Amp);
+                            tok->span);
     }
 
     return nullptr;
 }
 
-ExprAST *Parser::parseExprAST(int prec) {
-    ExprAST *lhs = parsePrimaryExprAST();
-    RETURN_IF_NULL(lhs);
-
-    const Token *tok = peek();
-    while (tok != nullptr) {
-        switch (tok->kind) {
-        case TokenKind::LParen: {
-            ++cur;
+ExprAST *Parser::parseExprAST() {
+    // NOTE: This is an operator-precedence loop whose pending operators and
+    // operands are kept on exprFrames instead of the native stack. Operand
+    // starts a loop binding the operators above prec with a primary
+    // expression, Postfix continues the loop with lhs, and Return hands the
+    // result of the loop over to the innermost pending expression.
+    enum class State {
+        Operand,
+        Postfix,
+        Return,
+    };
+
+    const std::size_t base = exprFrames.size();
+    State state = State::Operand;
+    int prec = 0;
+    ExprAST *lhs = nullptr;
+    ExprAST *result = nullptr;
+
+    while (true) {
+        switch (state) {
+        case State::Operand: {
+            const auto tok = next();
+            result = nullptr;
+            state = State::Return;
+            if (!tok) {
+                errors.emplace_back(ParseErrorKind::UnexpectedEOF, prevSpan);
+                break;
+            }
 
-            NonOwningList<ExprAST *> args;
+            switch (tok->kind) {
+            case TokenKind::Number:
+                lhs = arena->alloc<NumberExprAST>(toSpan(tok->span),
+                                                  decodeNumber(tok->span));
+                state = State::Postfix;
+                break;
+
+            case TokenKind::Ident:
+                lhs = arena->alloc<IdentifierExprAST>(toSpan(tok->span),
+                                                      tok->symbol);
+                state = State::Postfix;
+                break;
+
+            case TokenKind::Minus:
+                exprFrames.emplace_back(ExprFrame::Kind::Unary, prec,
+                                        tok->span);
+                state = State::Operand;
+                break;
+
+            case TokenKind::LParen:
+                exprFrames.emplace_back(ExprFrame::Kind::Grouped, prec,
+                                        tok->span);
+                prec = 0;
+                state = State::Operand;
+                break;
+
+            default:
+                errors.emplace_back(ParseErrorKind::ExpectedPrimaryExpression,
+                                    tok->span);
+            }
 
-            const Token *argTok = peek();
-            while (argTok != nullptr && argTok->kind != TokenKind::RParen) {
-                ExprAST *arg = parseExprAST();
-                RETURN_IF_NULL(arg);
+            // NOTE: Unary operators apply to the primary expression only,
+            // before any postfix or binary operator
+            while (state == State::Postfix && exprFrames.size() != base &&
+                   exprFrames.back().kind == ExprFrame::Kind::Unary) {
+                lhs = arena->alloc<UnaryExprAST>(toSpan(exprFrames.back().span),
+                                                 UnOpKind::Neg, lhs);
+                exprFrames.pop_back();
+            }
+        } break;
 
-                args.emplace_back(arena, arg);
+        case State::Postfix: {
+            const auto tok = peek();
+            result = lhs;
+            state = State::Return;
+            if (!tok) {
+                break;
+            }
 
-                argTok = peek();
-                if (argTok == nullptr || argTok->kind != TokenKind::Comma) {
+            switch (tok->kind) {
+            case TokenKind::LParen: {
+                next();
+
+                const auto argTok = peek();
+                if (argTok && argTok->kind != TokenKind::RParen) {
+                    exprFrames.emplace_back(ExprFrame::Kind::Arg, prec,
+                                            tok->span, lhs);
+                    exprFrames.back().argsBegin = argScratch.size();
+                    prec = 0;
+                    state = State::Operand;
                     break;
                 }
 
-                ++cur;
-                argTok = peek();
+                lhs = arena->alloc<CallExprAST>(toSpan(tok->span), lhs,
+                                                NodeArray<ExprAST>());
+                if (expect(TokenKind::RParen)) {
+                    state = State::Postfix;
+                } else {
+                    result = nullptr;
+                }
+            } break;
+
+            case TokenKind::LBracket:
+                next();
+                exprFrames.emplace_back(ExprFrame::Kind::Index, prec,
+                                        tok->span, lhs);
+                prec = 0;
+                state = State::Operand;
+                break;
+
+            default:
+                const BinOpPair &binOp = binOpTable[tokenKindIndex(tok->kind)];
+                if (binOp.precLHS <= prec) {
+                    break;
+                }
+                next();
+                exprFrames.emplace_back(ExprFrame::Kind::Rhs, prec, tok->span,
+                                        lhs);
+                exprFrames.back().op = binOp.bind;
+                prec = binOp.precRHS;
+                state = State::Operand;
             }
-
-            lhs = arena->alloc<CallExprAST>(tok->span, lhs, args);
-
-            EXPECT(TokenKind::RParen);
         } break;
 
-        case TokenKind::LBracket: {
-            ++cur;
+        case State::Return: {
+            if (exprFrames.size() == base) {
+                return result;
+            }
 
-            ExprAST *index = parseExprAST();
-            RETURN_IF_NULL(index);
+            const ExprFrame frame = exprFrames.back();
+            prec = frame.prec;
 
-            lhs = arena->alloc<IndexExprAST>(tok->span, lhs, index);
+            // NOTE: A null operand aborts every pending expression but the
+            // right-hand side of a binary operator, which keeps it
+            if (result == nullptr && frame.kind != ExprFrame::Kind::Rhs) {
+                if (frame.kind == ExprFrame::Kind::Arg) {
+                    argScratch.resize(frame.argsBegin);
+                }
+                exprFrames.pop_back();
+                break;
+            }
 
-            EXPECT(TokenKind::RBracket);
-        } break;
+            switch (frame.kind) {
+            case ExprFrame::Kind::Unary:
+                assert(false && "unary frames never wait for a loop");
+                exprFrames.pop_back();
+                break;
+
+            case ExprFrame::Kind::Grouped:
+                exprFrames.pop_back();
+                if (expect(TokenKind::RParen)) {
+                    lhs = arena->alloc<GroupedExprAST>(toSpan(frame.span),
+                                                       result);
+                    // NOTE: The grouped expression is a primary expression,
+                    // which the unary operators before it apply to
+                    while (exprFrames.size() != base &&
+                           exprFrames.back().kind == ExprFrame::Kind::Unary) {
+                        lhs = arena->alloc<UnaryExprAST>(
+                            toSpan(exprFrames.back().span), UnOpKind::Neg, lhs);
+                        exprFrames.pop_back();
+                    }
+                    state = State::Postfix;
+                } else {
+                    result = nullptr;
+                }
+                break;
+
+            case ExprFrame::Kind::Arg: {
+                argScratch.push_back(result);
+
+                auto argTok = peek();
+                if (argTok && argTok->kind == TokenKind::Comma) {
+                    next();
+                    argTok = peek();
+                    if (argTok && argTok->kind != TokenKind::RParen) {
+                        prec = 0;
+                        state = State::Operand;
+                        break;
+                    }
+                }
 
-        default:
-            const auto it = binOpMap.find(tok->kind);
-            if (it == binOpMap.end()) {
-                return lhs;
-            }
-            if (it->second.precLHS <= prec) {
-                return lhs;
+                const ArenaArray args(*arena,
+                                      argScratch.data() + frame.argsBegin,
+                                      argScratch.size() - frame.argsBegin);
+                argScratch.resize(frame.argsBegin);
+                lhs = arena->alloc<CallExprAST>(toSpan(frame.span), frame.lhs,
+                                                args);
+                exprFrames.pop_back();
+                if (expect(TokenKind::RParen)) {
+                    state = State::Postfix;
+                } else {
+                    result = nullptr;
+                }
+            } break;
+
+            case ExprFrame::Kind::Index:
+                exprFrames.pop_back();
+                lhs = arena->alloc<IndexExprAST>(toSpan(frame.span), frame.lhs,
+                                                 result);
+                if (expect(TokenKind::RBracket)) {
+                    state = State::Postfix;
+                } else {
+                    result = nullptr;
+                }
+                break;
+
+            case ExprFrame::Kind::Rhs:
+                exprFrames.pop_back();
+                lhs = arena->alloc<BinaryExprAST>(toSpan(frame.span), frame.op,
+                                                  frame.lhs, result);
+                state = State::Postfix;
+                break;
             }
-            ++cur;
-            lhs = arena->alloc<BinaryExprAST>(tok->span, it->second.bind, lhs,
-                                              parseExprAST(it->second.precRHS));
+        } break;
         }
-
-        tok = peek();
-    }
-
-    return lhs;
-}
-
-ExprAST *Parser::parsePrimaryExprAST() {
-    ExprAST *expr = nullptr;
-    const Token *tok = next();
-
-    switch (tok->kind) {
-    case TokenKind::Number:
-        return arena->alloc<NumberExprAST>(tok->span);
-
-    case TokenKind::Ident:
-        return arena->alloc<IdentifierExprAST>(tok->span);
-
-    case TokenKind::Minus:
-        expr = parsePrimaryExprAST();
-        RETURN_IF_NULL(expr);
-
-        return arena->alloc<UnaryExprAST>(tok->span, UnOpKind::Neg, expr);
-
-    case TokenKind::LParen:
-        expr = parseExprAST();
-        RETURN_IF_NULL(expr);
-
-        EXPECT(TokenKind::RParen);
-
-        return arena->alloc<GroupedExprAST>(tok->span, expr);
-
-    default:
-        errors.emplace_back(ParseErrorKind::ExpectedPrimaryExpression,
-                            tok->span, TokenKind::Amp);
     }
-
-    return nullptr;
 }
 
 } // namespace lang
@@ -0,0 +1,148 @@
+#include "Support/InputBuffer.h"
+
+#include "Support/SourceSpan.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::error_code lastError() {
+    return {errno, std::generic_category()};
+}
+
+} // namespace
+
+namespace lang {
+
+llvm::ErrorOr<InputBuffer> InputBuffer::open(llvm::StringRef filename) {
+    if (filename == "-") {
+        return read(STDIN_FILENO);
+    }
+
+    const int fd = ::open(filename.str().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return lastError();
+    }
+
+    struct stat st = {};
+    if (fstat(fd, &st) != 0) {
+        const std::error_code error = lastError();
+        close(fd);
+        return error;
+    }
+
+    if (static_cast<std::uint64_t>(st.st_size) > maxSourceSize) {
+        close(fd);
+        return std::make_error_code(std::errc::file_too_large);
+    }
+
+    auto result = S_ISREG(st.st_mode) && st.st_size > 0
+                      ? map(fd, static_cast<std::size_t>(st.st_size))
+                      : read(fd);
+    close(fd);
+    return result;
+}
+
+llvm::ErrorOr<InputBuffer> InputBuffer::read(int fd) {
+    std::size_t capacity = 64 * 1024;
+    std::size_t size = 0;
+    std::unique_ptr<char[]> heap(new char[capacity + padding]);
+
+    for (;;) {
+        if (size == capacity) {
+            std::unique_ptr<char[]> grown(new char[2 * capacity + padding]);
+            std::memcpy(grown.get(), heap.get(), size);
+            heap = std::move(grown);
+            capacity *= 2;
+        }
+
+        const ssize_t n = ::read(fd, heap.get() + size, capacity - size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return lastError();
+        }
+        if (n == 0) {
+            break;
+        }
+        size += static_cast<std::size_t>(n);
+        if (size > maxSourceSize) {
+            return std::make_error_code(std::errc::file_too_large);
+        }
+    }
+
+    std::memset(heap.get() + size, 0, padding);
+
+    const char *data = heap.get();
+    return InputBuffer(data, size, nullptr, 0, std::move(heap));
+}
+
+llvm::ErrorOr<InputBuffer> InputBuffer::map(int fd, std::size_t size) {
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t mappingSize =
+        (size + padding + pageSize - 1) / pageSize * pageSize;
+
+    // NOTE: Zero-filled pages are reserved for the contents and the padding,
+    // then the file is mapped over the start of them. The kernel zero-fills
+    // the rest of the last page of the file, so every byte past the end of
+    // the contents reads as NUL.
+    void *mapping = mmap(nullptr, mappingSize, PROT_READ,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return lastError();
+    }
+
+    if (mmap(mapping, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+        MAP_FAILED) {
+        const std::error_code error = lastError();
+        munmap(mapping, mappingSize);
+        return error;
+    }
+
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    return InputBuffer(static_cast<const char *>(mapping), size, mapping,
+                       mappingSize, nullptr);
+}
+
+InputBuffer::InputBuffer(InputBuffer &&other) noexcept
+    : data(other.data), size(other.size), mapping(other.mapping),
+      mappingSize(other.mappingSize), heap(std::move(other.heap)) {
+    other.data = nullptr;
+    other.size = 0;
+    other.mapping = nullptr;
+    other.mappingSize = 0;
+}
+
+InputBuffer &InputBuffer::operator=(InputBuffer &&other) noexcept {
+    if (this != &other) {
+        if (mapping != nullptr) {
+            munmap(mapping, mappingSize);
+        }
+        data = other.data;
+        size = other.size;
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        heap = std::move(other.heap);
+        other.data = nullptr;
+        other.size = 0;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+    }
+    return *this;
+}
+
+InputBuffer::~InputBuffer() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+}
+
+} // namespace lang
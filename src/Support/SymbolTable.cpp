@@ -0,0 +1,91 @@
+#include "Support/SymbolTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// @brief 32-bit FNV-1a, which is hard to beat on names this short
+std::uint32_t hashName(std::string_view name) {
+    std::uint32_t hash = 2166136261U;
+    for (const char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+    }
+    return hash;
+}
+
+} // namespace
+
+namespace lang {
+
+Symbol SymbolTable::intern(std::string_view name) {
+    ++numLookups;
+
+    // NOTE: The table is kept at most 3/4 full, so probing always ends on an
+    // empty slot
+    if (4 * (names.size() + 1) > 3 * slots.size()) {
+        grow();
+    }
+
+    const std::uint32_t hash = hashName(name);
+    const std::size_t mask = slots.size() - 1;
+    std::size_t slot = hash & mask;
+    for (; slots[slot] != 0; slot = (slot + 1) & mask) {
+        const std::uint32_t id = slots[slot] - 1;
+        if (hashes[id] == hash && names[id] == name) {
+            ++numHits;
+            return Symbol(id);
+        }
+    }
+
+    const auto id = static_cast<std::uint32_t>(names.size());
+    names.push_back(store(name));
+    hashes.push_back(hash);
+    slots[slot] = id + 1;
+    return Symbol(id);
+}
+
+std::vector<Symbol> SymbolTable::merge(const SymbolTable &other) {
+    std::vector<Symbol> symbols;
+    symbols.reserve(other.size());
+    for (const std::string_view name : other.names) {
+        symbols.push_back(intern(name));
+    }
+    numLookups += other.numLookups - other.size();
+    numHits += other.numLookups - other.size();
+    return symbols;
+}
+
+std::size_t SymbolTable::getMemoryUsage() const {
+    return slots.capacity() * sizeof(std::uint32_t) +
+           names.capacity() * sizeof(std::string_view) +
+           hashes.capacity() * sizeof(std::uint32_t) + storageSize;
+}
+
+std::string_view SymbolTable::store(std::string_view name) {
+    if (blocks.empty() || name.size() > blockCapacity - blockUsed) {
+        blockCapacity = std::max(blockSize, name.size());
+        blocks.push_back(std::make_unique<char[]>(blockCapacity));
+        blockUsed = 0;
+        storageSize += blockCapacity;
+    }
+    char *data = blocks.back().get() + blockUsed;
+    std::memcpy(data, name.data(), name.size());
+    blockUsed += name.size();
+    return {data, name.size()};
+}
+
+void SymbolTable::grow() {
+    const std::size_t size = slots.empty() ? 256 : 2 * slots.size();
+    slots.assign(size, 0);
+    const std::size_t mask = size - 1;
+    for (std::uint32_t id = 0; id != names.size(); ++id) {
+        std::size_t slot = hashes[id] & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
+    }
+}
+
+} // namespace lang
@@ -1,7 +1,10 @@
 #include "Support/Debug.h"
+#include "Support/InputBuffer.h"
 #include "Support/Reporting.h"
 #include "Support/SourceFile.h"
+#include "Support/SymbolTable.h"
 
+#include "AST/ASTImage.h"
 #include "AST/ASTPrinter.h"
 
 #include "Lex/Lexer.h"
@@ -10,13 +13,20 @@
 
 #include "Analysis/CFA.h"
 #include "Analysis/Resolver.h"
+#include "Analysis/Sema.h"
 #include "Analysis/TypeChecker.h"
 
 #include "Codegen/Codegen.h"
 
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
-#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+
+#include <cstdio>
+
+#include <unistd.h>
 
 namespace {
 
@@ -37,9 +47,20 @@ enum class CompilerEmitAction {
     Lex,
     Src,
     AST,
+    ASTBin,
     LLVM,
 };
 
+enum class CompilerStats {
+    Symbols,
+    Arena,
+};
+
+enum class CompilerStatsFormat {
+    Text,
+    JSON,
+};
+
 const llvm::cl::opt<std::string>
     inputFilename(llvm::cl::Positional, llvm::cl::desc("<file>"),
                   llvm::cl::Required, llvm::cl::value_desc("filename"));
@@ -72,10 +93,223 @@ const llvm::cl::opt<CompilerEmitAction> compilerEmitAction(
                    "Emit the original source code of the input file"),
         clEnumValN(CompilerEmitAction::AST, "ast",
                    "Emit the abstract syntax tree of the input file"),
+        clEnumValN(CompilerEmitAction::ASTBin, "ast-bin",
+                   "Emit the parsed abstract syntax tree of the input file "
+                   "as a binary image, which --load-ast loads back"),
         clEnumValN(CompilerEmitAction::LLVM, "llvm",
                    "Emit the LLVM IR of the input file")),
     llvm::cl::init(CompilerEmitAction::None));
 
+const llvm::cl::opt<lang::ScanISA> lexerScanISA(
+    "lex-simd",
+    llvm::cl::desc("Select the instruction set used by the lexer's scanning "
+                   "routines (defaults to the best one supported by the host)"),
+    llvm::cl::values(
+        clEnumValN(lang::ScanISA::Scalar, "scalar", "Use scalar code only"),
+        clEnumValN(lang::ScanISA::SSE2, "sse2", "Use SSE2 if supported"),
+        clEnumValN(lang::ScanISA::AVX2, "avx2", "Use AVX2 if supported")),
+    llvm::cl::init(lang::getHostScanISA()));
+
+const llvm::cl::opt<unsigned> lexerThreads(
+    "lex-threads",
+    llvm::cl::desc("Select the number of threads used for lexing (with more "
+                   "than one, the input is lexed upfront in chunks)"),
+    llvm::cl::init(1));
+
+const llvm::cl::opt<unsigned> parserThreads(
+    "parse-threads",
+    llvm::cl::desc("Select the number of threads used for parsing (with more "
+                   "than one, the input is lexed upfront and the top-level "
+                   "functions are parsed in parallel)"),
+    llvm::cl::init(1));
+
+const llvm::cl::opt<bool> lazyBodies(
+    "lazy-bodies",
+    llvm::cl::desc("Parse function bodies on first use only (the input is "
+                   "lexed upfront, and --until=ast checks signatures only)"),
+    llvm::cl::init(false));
+
+const llvm::cl::opt<bool> flatAST(
+    "flat-ast",
+    llvm::cl::desc("Type check the function bodies lowered to flat arrays of "
+                   "nodes in post-order instead of walking the AST"),
+    llvm::cl::init(false));
+
+const llvm::cl::opt<bool> fusedSema(
+    "fused-sema",
+    llvm::cl::desc("Run the control flow analysis, the resolution and the "
+                   "type checking in a single walk over the AST (--emit=ast "
+                   "then skips the resolved AST, and --flat-ast has no "
+                   "effect)"),
+    llvm::cl::init(false));
+
+const llvm::cl::opt<lang::ArenaBackend> arenaBackend(
+    "arena",
+    llvm::cl::desc("Select where the arena of the AST takes its memory from"),
+    llvm::cl::values(
+        clEnumValN(lang::ArenaBackend::Blocks, "blocks",
+                   "Use blocks of growing size"),
+        clEnumValN(lang::ArenaBackend::Reserved, "reserve",
+                   "Reserve a range sized after the input and commit its "
+                   "pages as the AST grows"),
+        clEnumValN(lang::ArenaBackend::ReservedHugePages, "huge-pages",
+                   "Reserve a range as with reserve, backed by transparent "
+                   "huge pages where possible")),
+    llvm::cl::init(lang::ArenaBackend::Blocks));
+
+const llvm::cl::opt<CompilerStatsFormat> compilerStatsFormat(
+    "stats-format",
+    llvm::cl::desc("Select the format of the statistics reported by --stats"),
+    llvm::cl::values(clEnumValN(CompilerStatsFormat::Text, "text",
+                                "Use plain text format for statistics"),
+                     clEnumValN(CompilerStatsFormat::JSON, "json",
+                                "Use a JSON object for statistics")),
+    llvm::cl::init(CompilerStatsFormat::Text));
+
+const llvm::cl::opt<std::string> loadAST(
+    "load-ast",
+    llvm::cl::desc("Load the parsed AST from an image written by "
+                   "--emit=ast-bin for the same input file instead of "
+                   "lexing and parsing it"),
+    llvm::cl::value_desc("filename"));
+
+/// @brief Returns the --stats option, registering it on the first call
+/// @note LLVM registers a -stats flag of its own for the statistics of its
+/// passes, which the compiler does not use. It is unregistered to free the
+/// name, which must happen after static initialization, so the option is
+/// created on demand instead of being a global.
+const llvm::cl::list<CompilerStats> &getCompilerStats() {
+    static const bool llvmStatsRemoved = [] {
+        auto &options = llvm::cl::getRegisteredOptions();
+        const auto it = options.find("stats");
+        if (it == options.end()) {
+            return false;
+        }
+        it->second->removeArgument();
+        return true;
+    }();
+    static const llvm::cl::list<CompilerStats> compilerStats(
+        "stats", llvm::cl::desc("Report statistics of the compilation"),
+        llvm::cl::CommaSeparated,
+        llvm::cl::values(
+            clEnumValN(CompilerStats::Symbols, "symbols",
+                       "Report the hit rate and memory usage of the symbol "
+                       "table"),
+            clEnumValN(CompilerStats::Arena, "arena",
+                       "Report the allocations per type, the waste and the "
+                       "peak memory usage of the arena of the AST")));
+    (void)llvmStatsRemoved;
+    return compilerStats;
+}
+
+void reportSymbolStats(llvm::raw_ostream &os,
+                       const lang::SymbolTable &symbols) {
+    const std::size_t lookups = symbols.getNumLookups();
+    const double hitRate =
+        lookups == 0 ? 0
+                     : 100.0 * static_cast<double>(symbols.getNumHits()) /
+                           static_cast<double>(lookups);
+    os << "Symbols: " << symbols.size() << " symbol(s), " << lookups
+       << " lookup(s), " << llvm::format("%.1f", hitRate) << "% hit(s), "
+       << symbols.getMemoryUsage() << " byte(s)\n";
+}
+
+void reportSymbolStats(llvm::json::OStream &json,
+                       const lang::SymbolTable &symbols) {
+    json.attributeObject("symbols", [&] {
+        json.attribute("symbols", static_cast<int64_t>(symbols.size()));
+        json.attribute("lookups",
+                       static_cast<int64_t>(symbols.getNumLookups()));
+        json.attribute("hits", static_cast<int64_t>(symbols.getNumHits()));
+        json.attribute("bytes",
+                       static_cast<int64_t>(symbols.getMemoryUsage()));
+    });
+}
+
+void reportArenaStats(llvm::raw_ostream &os, const lang::Arena &arena) {
+    os << "Arena: " << arena.totalAllocations() << " allocation(s), "
+       << arena.totalRequested() << " byte(s) requested (peak "
+       << arena.maxRequested() << "), " << arena.totalRolledBack()
+       << " byte(s) rolled back, " << arena.totalPadding()
+       << " byte(s) of padding, " << arena.totalTailBytes()
+       << " byte(s) of block tails, " << arena.totalCommitted()
+       << " byte(s) committed (peak " << arena.maxCommitted() << "), "
+       << arena.totalReserved() << " byte(s) reserved\n";
+    for (const lang::ArenaTypeStats &stats : arena.getTypeStats()) {
+        os << "  " << stats.name << ": " << stats.count << " allocation(s), "
+           << stats.bytes << " byte(s)\n";
+    }
+}
+
+void reportArenaStats(llvm::json::OStream &json, const lang::Arena &arena) {
+    const auto attribute = [&json](llvm::StringRef key, std::size_t value) {
+        json.attribute(key, static_cast<int64_t>(value));
+    };
+    json.attributeObject("arena", [&] {
+        attribute("allocations", arena.totalAllocations());
+        attribute("requested", arena.totalRequested());
+        attribute("peakRequested", arena.maxRequested());
+        attribute("rolledBack", arena.totalRolledBack());
+        attribute("padding", arena.totalPadding());
+        attribute("blockTails", arena.totalTailBytes());
+        attribute("committed", arena.totalCommitted());
+        attribute("peakCommitted", arena.maxCommitted());
+        attribute("reserved", arena.totalReserved());
+        json.attributeArray("types", [&] {
+            for (const lang::ArenaTypeStats &stats : arena.getTypeStats()) {
+                json.object([&] {
+                    json.attribute("name", stats.name);
+                    attribute("count", stats.count);
+                    attribute("bytes", stats.bytes);
+                });
+            }
+        });
+    });
+}
+
+/// @brief Reports the statistics selected by --stats in the format selected
+/// by --stats-format, all in a single object for JSON
+void reportCompilerStats(llvm::raw_ostream &os,
+                         const lang::SymbolTable &symbols,
+                         const lang::Arena &arena) {
+    const auto &compilerStats = getCompilerStats();
+    if (compilerStats.empty()) {
+        return;
+    }
+
+    switch (compilerStatsFormat) {
+    case CompilerStatsFormat::Text:
+        for (const CompilerStats stats : compilerStats) {
+            switch (stats) {
+            case CompilerStats::Symbols:
+                reportSymbolStats(os, symbols);
+                break;
+            case CompilerStats::Arena:
+                reportArenaStats(os, arena);
+                break;
+            }
+        }
+        break;
+    case CompilerStatsFormat::JSON: {
+        llvm::json::OStream json(os);
+        json.object([&] {
+            for (const CompilerStats stats : compilerStats) {
+                switch (stats) {
+                case CompilerStats::Symbols:
+                    reportSymbolStats(json, symbols);
+                    break;
+                case CompilerStats::Arena:
+                    reportArenaStats(json, arena);
+                    break;
+                }
+            }
+        });
+        os << '\n';
+        break;
+    }
+    }
+}
+
 template <typename T>
 void reportErrors(
     llvm::raw_ostream &os, CompilerErrorFormat format,
@@ -94,10 +328,11 @@ void reportErrors(
 } // namespace
 
 int main(int argc, char **argv) try {
+    getCompilerStats();
     llvm::cl::ParseCommandLineOptions(argc, argv, "Lang Compiler\n", nullptr,
                                       nullptr, true);
 
-    const auto file = llvm::MemoryBuffer::getFile(inputFilename);
+    const auto file = lang::InputBuffer::open(inputFilename);
 
     if (!file) {
         llvm::errs() << "Error: while opening file " << inputFilename << ": "
@@ -105,50 +340,137 @@ int main(int argc, char **argv) try {
         return EXIT_FAILURE;
     }
 
-    const lang::SourceFile source(inputFilename, file.get()->getBuffer());
+    const std::string_view buffer = file->getBuffer();
+
+    const lang::SourceFile source(inputFilename, buffer);
 
     // -------------------------------------------------------------------------
     // Lexing
     // -------------------------------------------------------------------------
 
-    lang::Lexer lexer(file.get()->getBuffer());
-    const auto lexResult = lexer.lexAll();
+    // NOTE: The arena is created upfront, so that the statistics can report
+    // it from every exit. It takes no memory until the first allocation.
+    lang::SymbolTable symbols;
+    lang::Arena arena(
+        lang::Arena::getInitialSize(buffer.size(), arenaBackend),
+        arenaBackend);
+    if (llvm::is_contained(getCompilerStats(), CompilerStats::Arena)) {
+        arena.enableTypeStats();
+    }
+    const auto reportStats = llvm::make_scope_exit([&symbols, &arena] {
+        reportCompilerStats(llvm::errs(), symbols, arena);
+    });
+
+    // NOTE: The input buffer is followed by NUL padding, which lets the lexer
+    // scan without checking for the end of the buffer.
+    static_assert(lang::InputBuffer::padding >= lang::scanPadding);
+    lang::Lexer lexer(symbols, buffer, lexerScanISA, true);
+
+    // NOTE: With a single lexing and parsing thread and eager bodies the
+    // parser pulls its tokens from the lexer. Otherwise the whole buffer is
+    // lexed upfront into a TokenBuffer.
+    std::optional<lang::LexResult> lexResult;
+    if (loadAST.empty() &&
+        (lexerThreads > 1 || parserThreads > 1 || lazyBodies)) {
+        lexResult = lexer.lexAllParallel(lexerThreads);
+    }
 
-    if (compilerEmitAction == CompilerEmitAction::Lex) {
-        for (const auto &token : lexResult.tokens) {
-            llvm::outs() << token.toString() << '\n';
+    if (compilerEmitAction == CompilerEmitAction::Lex ||
+        compilerUntilStage == CompilerUntilStage::Lex) {
+        bool empty = true;
+        const auto onToken = [&empty](const lang::Token &token) {
+            empty = false;
+            if (compilerEmitAction == CompilerEmitAction::Lex) {
+                llvm::outs() << token.toString() << '\n';
+            }
+        };
+
+        if (lexResult) {
+            for (std::size_t i = 0; i < lexResult->tokens.size(); ++i) {
+                onToken(lexResult->tokens[i]);
+            }
+        } else {
+            while (const auto token = lexer.next()) {
+                onToken(*token);
+            }
         }
-    }
 
-    if (lexResult.hasErrors()) {
-        reportErrors(llvm::errs(), compilerErrorFormat, source,
-                     lexResult.errors);
-        return EXIT_FAILURE;
-    }
+        const auto &lexErrors =
+            lexResult ? lexResult->errors : lexer.getErrors();
+        if (!lexErrors.empty()) {
+            reportErrors(llvm::errs(), compilerErrorFormat, source, lexErrors);
+            return EXIT_FAILURE;
+        }
 
-    if (lexResult.tokens.empty()) {
-        llvm::errs() << "Error: empty file provided\n";
-        return EXIT_FAILURE;
-    }
+        if (empty) {
+            llvm::errs() << "Error: empty file provided\n";
+            return EXIT_FAILURE;
+        }
 
-    if (compilerUntilStage == CompilerUntilStage::Lex) {
-        return EXIT_SUCCESS;
+        if (compilerUntilStage == CompilerUntilStage::Lex) {
+            return EXIT_SUCCESS;
+        }
+
+        if (!lexResult) {
+            symbols = lang::SymbolTable();
+            lexer = lang::Lexer(symbols, buffer, lexerScanISA, true);
+        }
     }
 
     // -------------------------------------------------------------------------
     // Parsing
     // -------------------------------------------------------------------------
 
-    lang::Arena arena(lang::kiloBytes(32));
+    // NOTE: When the parser pulls its tokens from the lexer, lexing errors are
+    // only known once parsing is done. They take precedence over parsing
+    // errors, as the latter are likely a consequence of the former.
+
     lang::ASTPrinter astPrinter(llvm::outs());
 
     lang::TypeContext typeCtx(arena);
 
-    lang::Parser parser(arena, typeCtx, lexResult.tokens);
-    const auto parseResult = parser.parseModuleAST();
+    // NOTE: A loaded image stands for the parsed module, so that the input
+    // file is neither lexed nor parsed
+    std::optional<lang::ASTImage> astImage;
+    if (!loadAST.empty()) {
+        auto image =
+            lang::ASTImage::load(loadAST, buffer, arena, typeCtx, symbols);
+        if (!image) {
+            llvm::errs() << "Error: while loading AST file " << loadAST
+                         << ": " << llvm::toString(image.takeError()) << '\n';
+            return EXIT_FAILURE;
+        }
+        astImage = std::move(*image);
+    }
+
+    const bool empty =
+        !astImage &&
+        (lexResult ? lexResult->tokens.empty() && lexResult->errors.empty()
+                   : lexer.peek() == nullptr && !lexer.hasErrors());
+    if (empty) {
+        llvm::errs() << "Error: empty file provided\n";
+        return EXIT_FAILURE;
+    }
+
+    lang::Parser parser = lexResult
+                              ? lang::Parser(arena, typeCtx, lexResult->tokens)
+                              : lang::Parser(arena, typeCtx, lexer);
+    if (lazyBodies) {
+        parser.setDeferBodies(true);
+    }
+    const auto parseResult =
+        astImage    ? lang::ParseResult(&astImage->getModule(), {})
+        : lexResult ? parser.parseModuleASTParallel(parserThreads)
+                    : parser.parseModuleAST();
 
     DEBUG("%lu allocation(s) with %lu bytes", arena.totalAllocations(),
-          arena.totalAllocated());
+          arena.totalCommitted());
+
+    const auto &lexErrors = lexResult ? lexResult->errors : lexer.getErrors();
+    if (!lexErrors.empty()) {
+        reportErrors(llvm::errs(), compilerErrorFormat, source, lexErrors);
+        return EXIT_FAILURE;
+    }
 
     if (compilerEmitAction == CompilerEmitAction::Src) {
         // TODO: Implement
@@ -166,6 +488,36 @@ int main(int argc, char **argv) try {
         return EXIT_FAILURE;
     }
 
+    // NOTE: Deferred bodies are parsed by the first pass that visits them,
+    // which is the AST printer or the CFA, so their errors are reported right
+    // after those.
+    const auto reportDeferredErrors = [&] {
+        const auto errors = parser.takeDeferredErrors();
+        if (!errors.empty()) {
+            reportErrors(llvm::errs(), compilerErrorFormat, source, errors);
+        }
+        return !errors.empty();
+    };
+
+    if (compilerEmitAction == CompilerEmitAction::ASTBin) {
+        lang::ASTWriter writer;
+        const std::string image =
+            writer.writeModuleAST(*parseResult.module, symbols);
+        if (reportDeferredErrors()) {
+            return EXIT_FAILURE;
+        }
+        // NOTE: The output is flushed before the file is stamped, as writing
+        // to it afterwards would change the time of the file again
+        llvm::outs() << image;
+        llvm::outs().flush();
+        std::fflush(stdout);
+        lang::ASTWriter::stampFile(STDOUT_FILENO, image);
+    }
+
+    if (reportDeferredErrors()) {
+        return EXIT_FAILURE;
+    }
+
     if (compilerUntilStage == CompilerUntilStage::AST) {
         return EXIT_SUCCESS;
     }
@@ -174,9 +526,22 @@ int main(int argc, char **argv) try {
     // Control Flow Analysis
     // -------------------------------------------------------------------------
 
+    // NOTE: With --fused-sema the three passes run upfront in a single walk,
+    // and their results are reported as if they ran one after another
+    std::optional<lang::SemaResult> semaResult;
+    if (fusedSema) {
+        lang::Sema sema(typeCtx);
+        semaResult = sema.analyzeModuleAST(*parseResult.module);
+    }
+
     lang::CFA controlFlowAnalyzer;
     const auto cfaResult =
-        controlFlowAnalyzer.analyzeModuleAST(*parseResult.module);
+        semaResult ? std::move(semaResult->cfa)
+                   : controlFlowAnalyzer.analyzeModuleAST(*parseResult.module);
+
+    if (reportDeferredErrors()) {
+        return EXIT_FAILURE;
+    }
 
     if (cfaResult.hasErrors()) {
         reportErrors(llvm::errs(), compilerErrorFormat, source,
@@ -189,9 +554,11 @@ int main(int argc, char **argv) try {
     // -------------------------------------------------------------------------
 
     lang::Resolver resolver;
-    const auto resolveResult = resolver.resolveModuleAST(*parseResult.module);
+    const auto resolveResult =
+        semaResult ? std::move(semaResult->resolve)
+                   : resolver.resolveModuleAST(*parseResult.module);
 
-    if (compilerEmitAction == CompilerEmitAction::AST) {
+    if (compilerEmitAction == CompilerEmitAction::AST && !semaResult) {
         llvm::outs() << "Resolved AST:\n";
         astPrinter.visit(*parseResult.module);
     }
@@ -207,8 +574,17 @@ int main(int argc, char **argv) try {
     // -------------------------------------------------------------------------
 
     lang::TypeChecker typeChecker(typeCtx);
-    const auto typeCheckerResult =
-        typeChecker.analyzeModuleAST(*parseResult.module);
+    const auto typeCheckerResult = [&] {
+        if (semaResult) {
+            return std::move(semaResult->typeChecker);
+        }
+        if (!flatAST) {
+            return typeChecker.analyzeModuleAST(*parseResult.module);
+        }
+        lang::ASTFlattener flattener;
+        lang::FlatAST flat = flattener.flattenModuleAST(*parseResult.module);
+        return typeChecker.analyzeFlatAST(flat);
+    }();
 
     DEBUG("%lu custom type(s) created", typeCtx.getNumTypes());
 
@@ -0,0 +1,181 @@
+// Stress test of the arenas of an ArenaGroup: 32 threads start together and
+// build linked lists in arenas of their own, rolling back some allocations on
+// the way, and the group merges the arenas into a parent. Checks that every
+// list is intact after the merge and after the workers and the parent
+// allocate again, and that the parent reports the same statistics as a
+// single arena that made every allocation on one thread.
+//
+// Usage: ArenaGroupTest [number of list nodes per thread]
+
+#include "Alloc/ArenaGroup.h"
+#include "Alloc/ArenaRef.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t numThreads = 32;
+
+/// @brief Node of a list, followed by an array of up to 15 words
+struct ListNode {
+    std::uint64_t value;
+    lang::ArenaRef<ListNode> next;
+    lang::ArenaRef<std::uint32_t> words;
+    std::uint32_t numWords;
+};
+
+std::uint64_t nextRandom(std::uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/// @brief Builds a list of the given number of nodes from the given seed,
+/// and allocates and rolls back a few nodes every 64 nodes
+ListNode *buildList(lang::Arena &arena, std::uint64_t seed,
+                    std::size_t count) {
+    std::uint64_t state = seed * 0x9e3779b97f4a7c15 + 1;
+    ListNode *head = nullptr;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i % 64 == 63) {
+            const lang::Arena::Mark mark = arena.mark();
+            for (std::uint64_t j = nextRandom(state) % 8; j != 0; --j) {
+                arena.alloc<ListNode>(ListNode{j, head, nullptr, 0});
+            }
+            arena.rollback(mark);
+        }
+        const std::uint64_t value = nextRandom(state);
+        const auto numWords = static_cast<std::uint32_t>(value % 16);
+        std::uint32_t *words = arena.allocArray<std::uint32_t>(numWords);
+        for (std::uint32_t j = 0; j < numWords; ++j) {
+            words[j] = static_cast<std::uint32_t>(value >> j);
+        }
+        head = arena.alloc<ListNode>(ListNode{value, head, words, numWords});
+    }
+    return head;
+}
+
+/// @brief Checks that the given list is the one that buildList builds from
+/// the given seed
+bool checkList(const ListNode *head, std::uint64_t seed, std::size_t count) {
+    std::vector<std::uint64_t> values;
+    values.reserve(count);
+    std::uint64_t state = seed * 0x9e3779b97f4a7c15 + 1;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i % 64 == 63) {
+            nextRandom(state);
+        }
+        values.push_back(nextRandom(state));
+    }
+
+    for (auto it = values.rbegin(); it != values.rend(); ++it) {
+        if (head == nullptr || head->value != *it ||
+            head->numWords != *it % 16) {
+            return false;
+        }
+        for (std::uint32_t j = 0; j < head->numWords; ++j) {
+            if (head->words[j] != static_cast<std::uint32_t>(*it >> j)) {
+                return false;
+            }
+        }
+        head = head->next;
+    }
+    return head == nullptr;
+}
+
+bool haveSameStats(const lang::Arena &lhs, const lang::Arena &rhs) {
+    const std::vector<lang::ArenaTypeStats> lhsTypes = lhs.getTypeStats();
+    const std::vector<lang::ArenaTypeStats> rhsTypes = rhs.getTypeStats();
+    return lhs.totalAllocations() == rhs.totalAllocations() &&
+           lhs.totalRequested() == rhs.totalRequested() &&
+           lhs.totalRolledBack() == rhs.totalRolledBack() &&
+           std::equal(lhsTypes.begin(), lhsTypes.end(), rhsTypes.begin(),
+                      rhsTypes.end(),
+                      [](const lang::ArenaTypeStats &l,
+                         const lang::ArenaTypeStats &r) {
+                          return l.name == r.name && l.count == r.count &&
+                                 l.bytes == r.bytes;
+                      });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count =
+        argc < 2 ? 20000 : std::strtoull(argv[1], nullptr, 10);
+
+    lang::Arena parent(lang::kiloBytes(32));
+    parent.enableTypeStats();
+    std::vector<ListNode *> heads(numThreads, nullptr);
+    std::vector<ListNode *> moreHeads(numThreads, nullptr);
+    bool ok = true;
+    {
+        // NOTE: The workers start from the smallest blocks, so that they all
+        // take new blocks from the ArenaSpace while the others allocate
+        lang::ArenaGroup group(parent, numThreads, lang::Arena::minBlockSize);
+        const auto runWorkers = [&](std::vector<ListNode *> &lists,
+                                    std::uint64_t seed) {
+            std::atomic<std::size_t> numReady = 0;
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (std::size_t i = 0; i < numThreads; ++i) {
+                threads.emplace_back([&, i] {
+                    ++numReady;
+                    while (numReady != numThreads) {
+                        std::this_thread::yield();
+                    }
+                    lists[i] = buildList(group.getWorker(i), seed + i, count);
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        };
+
+        runWorkers(heads, 0);
+        group.merge();
+
+        // NOTE: The workers and the parent must not allocate over the
+        // objects merged already
+        runWorkers(moreHeads, numThreads);
+        ListNode *parentHead = buildList(parent, 2 * numThreads, count);
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            ok &= checkList(heads[i], i, count);
+            ok &= checkList(moreHeads[i], numThreads + i, count);
+        }
+        ok &= checkList(parentHead, 2 * numThreads, count);
+    }
+
+    lang::Arena single(lang::kiloBytes(32));
+    single.enableTypeStats();
+    for (std::size_t i = 0; i < 2 * numThreads + 1; ++i) {
+        buildList(single, i, count);
+    }
+
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        ok &= checkList(heads[i], i, count);
+        ok &= checkList(moreHeads[i], numThreads + i, count);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "error: a list was overwritten\n");
+        return EXIT_FAILURE;
+    }
+    if (!haveSameStats(parent, single)) {
+        std::fprintf(stderr, "error: the merged arena does not match a "
+                             "single arena\n");
+        return EXIT_FAILURE;
+    }
+    if (parent.totalRolledBack() == 0) {
+        std::fprintf(stderr, "error: no allocation was rolled back\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+// Checks that an arena with a reserved backend allocates again from a range
+// recycled by a rollback with more pages committed than the allocation needs,
+// keeps those pages committed, and decommits all of them on reset.
+//
+// Usage: ArenaRollbackTest
+
+#include "Alloc/Arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool checkRollback(lang::ArenaBackend backend) {
+    lang::Arena arena(lang::megaBytes(16), backend);
+    const lang::Arena::Mark mark = arena.mark();
+    arena.allocArray<char>(lang::megaBytes(5));
+    const std::size_t committed = arena.totalCommitted();
+    arena.rollback(mark);
+    char *data = arena.allocArray<char>(16);
+    std::memset(data, 0, 16);
+    if (arena.totalCommitted() != committed) {
+        return false;
+    }
+    arena.reset();
+    return arena.totalCommitted() == 0;
+}
+
+} // namespace
+
+int main() {
+    const struct {
+        const char *name;
+        lang::ArenaBackend backend;
+    } configs[] = {
+        {"reserved", lang::ArenaBackend::Reserved},
+        {"reserved, huge pages", lang::ArenaBackend::ReservedHugePages},
+    };
+
+    for (const auto &config : configs) {
+        if (!checkRollback(config.backend)) {
+            std::fprintf(stderr, "error: %s: a rolled back range lost its "
+                                 "committed pages\n",
+                         config.name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// Checks that the ArenaSpace hands out the space of freed blocks and released
+// ranges again, whatever the sizes asked for afterwards: blocks of a new size
+// on every round add up to many times the space, and must not run out of it.
+// Also checks that freed blocks are decommitted, that a smaller block reuses
+// a larger free one, and that running out of space throws
+// ArenaSpaceExhausted.
+//
+// Usage: ArenaSpaceTest
+
+#include "Alloc/Arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using lang::ArenaSpace;
+
+/// @brief Allocates and frees blocks and ranges of growing sizes, as the
+/// arenas of many compilations in a row do, which together take 16 times the
+/// space
+bool checkReuse() try {
+    std::size_t total = 0;
+    for (std::size_t i = 0; total < 16 * ArenaSpace::reservedSize; ++i) {
+        const std::size_t blockSize =
+            lang::megaBytes(4) + i * ArenaSpace::pageSize;
+        std::byte *block = ArenaSpace::allocBlock(blockSize);
+        block[0] = std::byte(1);
+        block[blockSize - 1] = std::byte(1);
+
+        const std::size_t rangeSize =
+            lang::megaBytes(64) + i % 64 * ArenaSpace::hugePageSize;
+        std::byte *range = ArenaSpace::reserveRange(rangeSize);
+        ArenaSpace::commitRange(range, ArenaSpace::hugePageSize, false);
+        range[0] = std::byte(1);
+
+        ArenaSpace::freeBlock(block, blockSize);
+        ArenaSpace::releaseRange(range, rangeSize);
+        total += blockSize + rangeSize;
+    }
+    return true;
+} catch (const lang::ArenaSpaceExhausted &) {
+    return false;
+}
+
+/// @brief Checks that a block freed behind a live one is decommitted, and
+/// that a smaller block is taken from it
+bool checkFreeBlock() {
+    const std::size_t size = lang::megaBytes(64);
+    std::byte *large = ArenaSpace::allocBlock(size);
+    std::byte *live = ArenaSpace::allocBlock(ArenaSpace::pageSize);
+    std::memset(large, 0xff, size);
+    ArenaSpace::freeBlock(large, size);
+
+    std::byte *small = ArenaSpace::allocBlock(lang::megaBytes(16));
+    const bool ok = small == large && small[0] == std::byte(0) &&
+                    small[lang::megaBytes(16) - 1] == std::byte(0);
+    ArenaSpace::freeBlock(small, lang::megaBytes(16));
+    ArenaSpace::freeBlock(live, ArenaSpace::pageSize);
+    return ok;
+}
+
+/// @brief Checks that reserving more ranges than the space holds throws
+/// ArenaSpaceExhausted, and that the space is usable again once they are
+/// released
+bool checkExhausted() {
+    const std::size_t size = lang::gigaBytes(1);
+    std::vector<std::byte *> ranges;
+    bool thrown = false;
+    try {
+        for (int i = 0; i < 8; ++i) {
+            ranges.push_back(ArenaSpace::reserveRange(size));
+        }
+    } catch (const lang::ArenaSpaceExhausted &) {
+        thrown = true;
+    }
+    for (std::byte *range : ranges) {
+        ArenaSpace::releaseRange(range, size);
+    }
+    std::byte *range = ArenaSpace::reserveRange(size);
+    ArenaSpace::releaseRange(range, size);
+    return thrown && ranges.size() < 4;
+}
+
+} // namespace
+
+int main() {
+    if (!checkReuse()) {
+        std::fprintf(stderr, "error: freed blocks and released ranges were not "
+                             "reused\n");
+        return EXIT_FAILURE;
+    }
+    if (!checkFreeBlock()) {
+        std::fprintf(stderr, "error: a freed block was not decommitted and "
+                             "reused\n");
+        return EXIT_FAILURE;
+    }
+    if (!checkExhausted()) {
+        std::fprintf(stderr, "error: running out of space did not throw "
+                             "ArenaSpaceExhausted\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
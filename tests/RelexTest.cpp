@@ -0,0 +1,143 @@
+// Checks incremental relexing against lexing from scratch over randomized
+// chains of edits to the given files, with and without comments. Every chain
+// starts from a file and relexes each edited buffer from the result of the
+// previous one, with edits that merge, split or start tokens.
+//
+// Usage: RelexTest <file>...
+
+#include "Lex/Lexer.h"
+#include "Support/InputBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int numRounds = 500;
+
+/// @brief Compares two results lexed with different symbol tables, whose
+/// symbols are compared by name
+bool sameResults(const lang::LexResult &lhs,
+                 const lang::SymbolTable &lhsSymbols,
+                 const lang::LexResult &rhs,
+                 const lang::SymbolTable &rhsSymbols) {
+    if (lhs.tokens.size() != rhs.tokens.size() ||
+        lhs.errors.size() != rhs.errors.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.tokens.size(); ++i) {
+        if (lhs.tokens.getKind(i) != rhs.tokens.getKind(i) ||
+            lhs.tokens.getOffset(i) != rhs.tokens.getOffset(i) ||
+            lhs.tokens.getLength(i) != rhs.tokens.getLength(i)) {
+            return false;
+        }
+        const lang::Symbol lhsSymbol = lhs.tokens.getSymbol(i);
+        const lang::Symbol rhsSymbol = rhs.tokens.getSymbol(i);
+        if (lhsSymbol.isValid() != rhsSymbol.isValid() ||
+            (lhsSymbol.isValid() && lhsSymbols.getName(lhsSymbol) !=
+                                        rhsSymbols.getName(rhsSymbol))) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < lhs.errors.size(); ++i) {
+        if (lhs.errors[i].kind != rhs.errors[i].kind ||
+            lhs.errors[i].span.data() - lhs.tokens.getBuffer().data() !=
+                rhs.errors[i].span.data() - rhs.tokens.getBuffer().data() ||
+            lhs.errors[i].span.size() != rhs.errors[i].span.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Generates up to four sorted, non overlapping edits of up to four
+/// characters drawn from characters that merge, split or start tokens
+std::vector<lang::TextEdit> randomEdits(std::mt19937 &rng, std::size_t size,
+                                        std::vector<std::string> &texts) {
+    static constexpr std::string_view alphabet = "ab19._=/ \n$&|!<>(){};:";
+    const auto pick = [&](std::size_t bound) {
+        return std::uniform_int_distribution<std::size_t>(0, bound)(rng);
+    };
+
+    std::vector<std::size_t> offsets(1 + pick(3));
+    for (auto &offset : offsets) {
+        offset = pick(size);
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    texts.assign(offsets.size(), "");
+    std::vector<lang::TextEdit> edits;
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        const std::size_t offset = std::max(offsets[i], pos);
+        const std::size_t removed = std::min(pick(4), size - offset);
+        for (std::size_t n = pick(4); n != 0; --n) {
+            texts[i] += alphabet[pick(alphabet.size() - 1)];
+        }
+        edits.push_back({offset, removed, texts[i]});
+        pos = offset + removed;
+    }
+    return edits;
+}
+
+/// @brief Relexes a chain of random edits to the given source, and returns
+/// the round in which relexing first differs from lexing from scratch, or
+/// -1 if it never does
+int checkRelex(std::string src, std::mt19937 &rng, bool includeComments) {
+    std::vector<std::string> texts;
+    lang::SymbolTable symbols;
+    lang::LexResult result =
+        lang::Lexer(symbols, src).lexAll(includeComments);
+    for (int round = 0; round < numRounds; ++round) {
+        const auto edits = randomEdits(rng, src.size(), texts);
+        std::string edited = lang::applyTextEdits(src, edits);
+        lang::LexResult relexed = lang::Lexer(symbols, edited).relex(
+            std::move(result), edits, includeComments);
+        lang::SymbolTable expectedSymbols;
+        const lang::LexResult expected =
+            lang::Lexer(expectedSymbols, edited).lexAll(includeComments);
+        if (!sameResults(relexed, symbols, expected, expectedSymbols)) {
+            return round;
+        }
+        src = std::move(edited);
+        result = std::move(relexed);
+    }
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 rng(42);
+    for (int i = 1; i < argc; ++i) {
+        const auto file = lang::InputBuffer::open(argv[i]);
+        if (!file) {
+            std::fprintf(stderr, "error: while opening file %s: %s\n",
+                         argv[i], file.getError().message().c_str());
+            return EXIT_FAILURE;
+        }
+        for (const bool includeComments : {false, true}) {
+            const int round = checkRelex(std::string(file->getBuffer()), rng,
+                                         includeComments);
+            if (round != -1) {
+                std::fprintf(stderr,
+                             "error: %s: relexing differs from lexing from "
+                             "scratch in round %d%s\n",
+                             argv[i], round,
+                             includeComments ? " with comments" : "");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
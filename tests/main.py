@@ -142,6 +142,435 @@ def test_error_05() -> None:
     assert error[0]["loc"] == "samples/error/05.lang:2:5"
 
 
+def test_input_too_large(tmp_path) -> None:
+    # Token offsets are 32-bit, so a sparse file one byte past 4 GiB is
+    # rejected without being read
+    file = tmp_path / "large.lang"
+    with open(file, "wb") as f:
+        f.truncate(2**32)
+
+    res = compile_program(str(file), "--emit=lex", "--until=lex")
+
+    assert res.returncode == 1
+    assert "File too large" in res.stderr
+
+
+def test_lex_simd() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        expected = compile_program(
+            file, "--emit=lex", "--until=lex", "--lex-simd=scalar"
+        )
+
+        for isa in ["sse2", "avx2"]:
+            res = compile_program(
+                file, "--emit=lex", "--until=lex", f"--lex-simd={isa}"
+            )
+
+            assert res.returncode == expected.returncode
+            assert res.stdout == expected.stdout
+            assert res.stderr == expected.stderr
+
+
+def test_lex_threads() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        expected = compile_program(file, "--emit=lex", "--until=lex")
+
+        for threads in [2, 3, 16]:
+            res = compile_program(
+                file, "--emit=lex", "--until=lex", f"--lex-threads={threads}"
+            )
+
+            assert res.returncode == expected.returncode
+            assert res.stdout == expected.stdout
+            assert res.stderr == expected.stderr
+
+
+def test_relex() -> None:
+    import glob
+
+    res = run_test_program("RelexTest", *sorted(glob.glob("samples/*/*.lang")))
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_parse_threads() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        expected = compile_program(file, "--emit=ast", "--until=ast")
+
+        for threads in [2, 3, 16]:
+            res = compile_program(
+                file, "--emit=ast", "--until=ast", f"--parse-threads={threads}"
+            )
+
+            assert res.returncode == expected.returncode
+            assert without_debug(res.stdout) == without_debug(expected.stdout)
+            assert res.stderr == expected.stderr
+
+
+def test_lazy_bodies() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        expected = compile_program(file, "--emit=llvm")
+        res = compile_program(file, "--emit=llvm", "--lazy-bodies")
+
+        assert res.returncode == expected.returncode
+        assert without_debug(res.stdout) == without_debug(expected.stdout)
+        assert res.stderr == expected.stderr
+
+    # The body of the only function is invalid, but never parsed
+    res = compile_program("samples/error/03.lang", "--until=ast", "--lazy-bodies")
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_flat_ast() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        for opts in [["--emit=ast", "--until=sema"], ["--emit=llvm"]]:
+            expected = compile_program(file, *opts)
+            res = compile_program(file, *opts, "--flat-ast")
+
+            assert res.returncode == expected.returncode
+            assert without_addresses(res.stdout) == without_addresses(
+                expected.stdout
+            )
+            assert res.stderr == expected.stderr
+
+
+def test_fused_sema() -> None:
+    import glob
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        for opts in [["--error-format=json"], ["--emit=llvm"]]:
+            expected = compile_program(file, *opts)
+            res = compile_program(file, *opts, "--fused-sema")
+
+            assert res.returncode == expected.returncode
+            assert without_debug(res.stdout) == without_debug(expected.stdout)
+            assert res.stderr == expected.stderr
+
+
+def test_ast_image(tmp_path) -> None:
+    import glob
+    import subprocess
+
+    for file in sorted(glob.glob("samples/valid/*.lang")):
+        image = tmp_path / "image.ast"
+        with open(image, "wb") as f:
+            res = subprocess.run(
+                ["./build/compiler", file, "--emit=ast-bin", "--until=ast"],
+                stdout=f,
+                stderr=subprocess.PIPE,
+            )
+
+        assert res.returncode == 0
+        assert not res.stderr
+
+        for opts in [["--emit=ast"], ["--emit=llvm"]]:
+            expected = compile_program(file, *opts)
+            res = compile_program(file, *opts, f"--load-ast={image}")
+
+            assert res.returncode == expected.returncode
+            assert without_addresses(without_debug(res.stdout)) == (
+                without_addresses(without_debug(expected.stdout))
+            )
+            assert res.stderr == expected.stderr
+
+    # The image of the last file is out of date with every other file
+    res = compile_program("samples/valid/01.lang", f"--load-ast={image}")
+
+    assert res.returncode == 1
+    assert "input file" in res.stderr
+
+    res = compile_program("samples/valid/01.lang", "--load-ast=samples/valid/01.lang")
+
+    assert res.returncode == 1
+    assert "not an AST image" in res.stderr
+
+    # A truncated image, and images with a byte of their header, of their
+    # nodes or of their tables flipped. The nodes follow the first page of
+    # 4096 bytes, and the tables follow the nodes, starting with the
+    # positions of the references.
+    import os
+    import struct
+
+    data = image.read_bytes()
+    (nodes_size,) = struct.unpack_from("<I", data, 44)
+    (num_node_refs,) = struct.unpack_from("<I", data, 60)
+    tables = 4096 + nodes_size
+    (first_ref,) = struct.unpack_from("<I", data, tables)
+    broken = tmp_path / "broken.ast"
+    broken.write_bytes(data[: 4096 + nodes_size // 2])
+    res = compile_program(file, f"--load-ast={broken}")
+
+    assert res.returncode == 1
+    assert "malformed AST image" in res.stderr
+
+    for offset, mask in [
+        (40, 0x5A),
+        (48, 0x5A),
+        (4096 + first_ref + 2, 0x10),
+        (4096 + first_ref - 4, 0x5A),
+        (tables, 0x5A),
+        (tables + 4 * num_node_refs, 0x5A),
+    ]:
+        corrupted = bytearray(data)
+        corrupted[offset] ^= mask
+        broken.write_bytes(bytes(corrupted))
+        res = compile_program(file, f"--load-ast={broken}")
+
+        assert res.returncode == 1
+        assert "malformed AST image" in res.stderr
+
+    # The file of an image gets the time at which the image was written, and
+    # its nodes are only hashed on load once the file is written again. An
+    # image whose file was touched since still loads.
+    (write_time,) = struct.unpack_from("<q", data, 96)
+
+    assert image.stat().st_mtime_ns == write_time
+
+    os.utime(image)
+    expected = compile_program(file, "--emit=ast")
+    res = compile_program(file, "--emit=ast", f"--load-ast={image}")
+
+    assert res.returncode == expected.returncode
+    assert without_addresses(without_debug(res.stdout)) == (
+        without_addresses(without_debug(expected.stdout))
+    )
+    assert res.stderr == expected.stderr
+
+
+def test_deep_nesting(tmp_path) -> None:
+    depth = 50000
+    stmts = [
+        "x = " + "(" * depth + "a" + ")" * depth + ";",
+        "x = " + "-" * depth + "a;",
+        "x = a" + " + (a" * depth + ")" * depth + ";",
+        "{ " * depth + "x = a;" + " }" * depth,
+        "if x < a { " * depth + "x = a;" + " }" * depth,
+        "while x < a { " * depth + "break;" + " }" * depth,
+        "if x < a { x = a; }" + " else if x < a { x = a; }" * depth,
+    ]
+    file = tmp_path / "deep.lang"
+    file.write_text(
+        "fn main(a: number): number {\n    var x = a;\n"
+        + "".join(f"    {stmt}\n" for stmt in stmts)
+        + "    return x;\n}\n"
+    )
+
+    res = compile_program(str(file), "--until=sema")
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_stdin() -> None:
+    import glob
+    import subprocess
+
+    for file in sorted(glob.glob("samples/*/*.lang")):
+        expected = compile_program(file, "--emit=lex", "--until=lex")
+
+        with open(file) as f:
+            res = subprocess.run(
+                ["./build/compiler", "-", "--emit=lex", "--until=lex"],
+                stdin=f,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.PIPE,
+                text=True,
+            )
+
+        assert res.returncode == expected.returncode
+        assert res.stdout == expected.stdout
+        assert res.stderr == expected.stderr.replace(file, "-")
+
+
+def test_stats_symbols() -> None:
+    expected = compile_program("samples/valid/04.lang")
+    res = compile_program("samples/valid/04.lang", "--stats=symbols")
+
+    assert res.returncode == expected.returncode
+    assert res.stdout == expected.stdout
+    assert res.stderr.startswith("Symbols: ")
+    assert "hit(s)" in res.stderr
+
+
+def test_stats_arena() -> None:
+    expected = compile_program("samples/valid/04.lang")
+    res = compile_program("samples/valid/04.lang", "--stats=arena")
+
+    assert res.returncode == expected.returncode
+    assert res.stdout == expected.stdout
+    assert res.stderr.startswith("Arena: ")
+    assert "lang::FunctionDeclAST: 1 allocation(s)" in res.stderr
+
+    res = compile_program(
+        "samples/valid/04.lang", "--stats=arena,symbols", "--stats-format=json"
+    )
+    stats = parse_json(res.stderr)
+
+    assert stats["symbols"]["symbols"] > 0
+    arena = stats["arena"]
+    assert arena["requested"] + arena["rolledBack"] == sum(
+        t["bytes"] for t in arena["types"]
+    )
+    assert arena["peakCommitted"] >= arena["committed"] > 0
+    assert any(t["name"] == "lang::FunctionDeclAST" for t in arena["types"])
+
+
+def test_stats_arena_rollback(tmp_path) -> None:
+    file = tmp_path / "rollback.lang"
+    file.write_text(
+        "fn f(a: number): number {\n"
+        "    let x = (a + 1;\n"
+        "}\n"
+        "fn g(): void {\n"
+        "    let y = 1 + 2;\n"
+        "}\n"
+    )
+    res = compile_program(
+        str(file), "--until=ast", "--stats=arena", "--stats-format=json"
+    )
+    arena = parse_json(res.stderr.splitlines()[-1])["arena"]
+
+    assert res.returncode != 0
+    assert arena["rolledBack"] > 0
+    assert arena["requested"] + arena["rolledBack"] == sum(
+        t["bytes"] for t in arena["types"]
+    )
+
+
+def test_stats_arena_rollback_reserve(tmp_path) -> None:
+    # The statement that fails takes more than a commit step of 2 MiB of the
+    # reserved range, which is sized after the input, and g then allocates
+    # again from the pages that the rollback kept committed
+    file = tmp_path / "rollback.lang"
+    file.write_text(
+        "// " + "x" * 2**20 + "\n"
+        "fn f(a: number): number {\n"
+        "    let x = (" + "a + " * 40000 + "a;\n"
+        "    let z = a + 2;\n"
+        "    return z;\n"
+        "}\n"
+        "fn g(a: number): number {\n"
+        "    let y = " + "a + " * 20000 + "a;\n"
+        "    return y;\n"
+        "}\n"
+    )
+    res = compile_program(
+        str(file),
+        "--until=ast",
+        "--arena=reserve",
+        "--stats=arena",
+        "--stats-format=json",
+    )
+    arena = parse_json(res.stderr.splitlines()[-1])["arena"]
+
+    step = 2 * 2**20
+    assert res.returncode == 1
+    assert "Unexpected token" in res.stderr
+    assert "bad_alloc" not in res.stderr
+    assert arena["rolledBack"] > step
+    assert arena["requested"] > step // 2
+    # Only the pages of the peak are committed, as g reuses those of f
+    assert arena["committed"] == arena["peakCommitted"] <= arena["reserved"]
+    assert arena["committed"] == -(-arena["peakRequested"] // step) * step
+
+
+def test_arena_rollback() -> None:
+    res = run_test_program("ArenaRollbackTest")
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_arena_space() -> None:
+    res = run_test_program("ArenaSpaceTest")
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_stats_arena_parse_threads(tmp_path) -> None:
+    file = tmp_path / "threads.lang"
+    file.write_text(
+        "".join(
+            f"fn f{i}(a: number): number {{\n"
+            f"    let x = a * {i} + 1;\n"
+            f"    return x;\n"
+            "}\n"
+            for i in range(200)
+        )
+    )
+    expected = compile_program(
+        str(file), "--until=ast", "--stats=arena", "--stats-format=json"
+    )
+    res = compile_program(
+        str(file),
+        "--until=ast",
+        "--stats=arena",
+        "--stats-format=json",
+        "--parse-threads=32",
+    )
+    arena = parse_json(res.stderr.splitlines()[-1])["arena"]
+    expected_arena = parse_json(expected.stderr.splitlines()[-1])["arena"]
+
+    assert res.returncode == expected.returncode == 0
+    for key in ["allocations", "requested", "rolledBack", "types"]:
+        assert arena[key] == expected_arena[key]
+
+
+def test_arena_group() -> None:
+    res = run_test_program("ArenaGroupTest")
+
+    assert res.returncode == 0
+    assert not res.stderr
+
+
+def test_unannotated_param(tmp_path) -> None:
+    file = tmp_path / "unannotated.lang"
+    file.write_text(
+        "fn f(a): number {\n"
+        "    return 1;\n"
+        "}\n"
+        "fn main(): void {\n"
+        "    let x: number = f(1);\n"
+        "    let y = f;\n"
+        "}\n"
+    )
+
+    for opts in [[], ["--flat-ast"], ["--fused-sema"]]:
+        res = compile_program(str(file), "--emit=ast", "--until=sema", *opts)
+
+        assert res.returncode == 0
+        assert "Type-checked AST:" in res.stdout
+        assert "LocalStmtAST: let a\n" in res.stdout
+
+
+def test_number_literal_range(tmp_path) -> None:
+    zeros = "0" * 400
+    file = tmp_path / "range.lang"
+    file.write_text(
+        f"fn tiny(): number {{\n    return 0.{zeros}1;\n}}\n"
+        f"fn huge(): number {{\n    return 1{zeros};\n}}\n"
+    )
+
+    res = compile_program(str(file), "--emit=llvm")
+
+    assert "ret double 0.000000e+00\n" in res.stdout
+    assert "ret double 0x7FF0000000000000\n" in res.stdout
+
+
 from subprocess import CompletedProcess
 
 
@@ -155,7 +584,27 @@ def parse_json(s: str) -> dict:
         assert False
 
 
-def compile_program(file: str, opts: str = "") -> CompletedProcess[str]:
+def without_debug(s: str) -> str:
+    """
+    Remove the debug output, which reports allocation statistics that depend
+    on how the module was parsed, from the given standard output.
+    """
+    return "".join(
+        line for line in s.splitlines(keepends=True) if not line.startswith("[/")
+    )
+
+
+def without_addresses(s: str) -> str:
+    """
+    Replace the addresses of the declarations that identifiers resolve to,
+    which change from run to run, in the given AST dump.
+    """
+    import re
+
+    return re.sub(r"0x[0-9a-f]+", "ADDR", s)
+
+
+def compile_program(file: str, *opts: str) -> CompletedProcess[str]:
     import subprocess
 
     """
@@ -163,13 +612,35 @@ def compile_program(file: str, opts: str = "") -> CompletedProcess[str]:
 
     Args:
         program (str): The program to compile.
+        opts (str): Additional command line options.
 
     Returns:
         CompletedProcess: The result of the compilation process.
     """
     # Open process with pipes for stdout and stderr
     return subprocess.run(
-        ["./build/compiler", file, opts],
+        ["./build/compiler", file, *opts],
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+
+def run_test_program(name: str, *args: str) -> CompletedProcess[str]:
+    import subprocess
+
+    """
+    Run the given test executable, built from tests/, and return the output.
+
+    Args:
+        name (str): The name of the test executable.
+        args (str): Additional command line arguments.
+
+    Returns:
+        CompletedProcess: The result of the test process.
+    """
+    return subprocess.run(
+        [f"./build/tests/{name}", *args],
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE,
         text=True,